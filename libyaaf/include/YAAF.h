@@ -50,10 +50,9 @@
  * resulting in less data copies, easier multi-threaded access and an
  * overall improved performance.
  *
- * @note: In the current version the file lookup is done in log2n time, by
- * comparing the file name to the archive entries, which have been sorted
- * before hand. Future work would include storing a hashmap with the archive
- * to speed lookup.
+ * @note: Archives created with yaafcl store a prebuilt lookup index, files
+ * are looked up directly in the mapped archive. Archives without the index
+ * fall back to a hashmap built when the archive is opened.
  */
 
 #if defined (__cplusplus)
@@ -92,12 +91,122 @@ typedef struct YAAF_Allocator
 typedef struct
 {
     time_t lastModification;
-    uint32_t sizeCompressed;
-    uint32_t sizeUncompressed;
+    uint64_t sizeCompressed;
+    uint64_t sizeUncompressed;
     const void* extra;
     uint16_t extraSize;
 } YAAF_FileInfo;
 
+/**
+ * Validation performed when opening an archive.
+ *
+ * YAAF_VALIDATION_FULL verifies the manifest entry list and lookup index hashes
+ * and checks every entry when the archive is opened.
+ * YAAF_VALIDATION_HEADER only checks the manifest and lookup index headers.
+ * The entries are trusted, use only with archives from a trusted source.
+ * YAAF_VALIDATION_DEFERRED only checks the headers when the archive is opened
+ * and checks each entry the first time it is looked up. This is the default,
+ * archives with a lookup index then open in constant time. Use
+ * YAAF_ArchiveCheck() to verify the entry list and index hashes.
+ *
+ * @note Archives without a lookup index always check all the entries when
+ * opened, since these are required to build the lookup map.
+ * @note Directory lookups binary search the entries by name. Full validation
+ * sorts the entries when they are not stored in order, the other levels trust
+ * the order of the entries of archives with a lookup index and directory
+ * lookups then miss files if they are not sorted. YAAF_ArchiveCheck() reports
+ * such archives.
+ */
+typedef enum
+{
+    YAAF_VALIDATION_FULL = 0,
+    YAAF_VALIDATION_HEADER,
+    YAAF_VALIDATION_DEFERRED
+} YAAF_Validation;
+
+/**
+ * Access pattern hints for the archive data, passed on to the OS.
+ */
+typedef enum
+{
+    YAAF_ADVICE_NORMAL = 0,
+    YAAF_ADVICE_SEQUENTIAL,
+    YAAF_ADVICE_RANDOM,
+    YAAF_ADVICE_WILLNEED,
+    YAAF_ADVICE_DONTNEED
+} YAAF_Advice;
+
+/**
+ * Mapping policy of an archive, combine the flags in
+ * YAAF_ArchiveOptions.mapFlags.
+ *
+ * YAAF_MAP_POPULATE reads the whole archive into the page cache when opened.
+ * YAAF_MAP_HUGEPAGES asks for transparent huge pages (Linux only).
+ * YAAF_MAP_LOCK_MANIFEST locks the manifest in memory.
+ * YAAF_MAP_LOCK_ALL locks the whole archive in memory.
+ * YAAF_MAP_PRELOAD copies the archive into anonymous memory instead of
+ * mapping the file.
+ * YAAF_MAP_PREAD does not map the archive. The manifest is read into memory
+ * when opened and file data is read with pread() as it is needed. I/O errors
+ * are then reported as failures instead of signals. The other flags are
+ * ignored.
+ * YAAF_MAP_WINDOWED maps only windows of 64MB of the archive as files are
+ * read, at most four at a time, to bound the address space in use on 32 bit
+ * systems. The manifest is read into memory as with YAAF_MAP_PREAD. The other
+ * flags are ignored.
+ * YAAF_MAP_DIRECT reads the archive with direct I/O (O_DIRECT), bypassing the
+ * OS cache. Instead the archive data is cached in aligned chunks by the
+ * archive, up to YAAF_ArchiveOptions.directCacheSize bytes. The manifest is
+ * read into memory as with YAAF_MAP_PREAD. The other flags are ignored. Falls
+ * back to regular reads when the file system does not support direct I/O.
+ *
+ * @note Locking fails when it exceeds the process' limit of locked memory.
+ */
+typedef enum
+{
+    YAAF_MAP_POPULATE = 1 << 0,
+    YAAF_MAP_HUGEPAGES = 1 << 1,
+    YAAF_MAP_LOCK_MANIFEST = 1 << 2,
+    YAAF_MAP_LOCK_ALL = 1 << 3,
+    YAAF_MAP_PRELOAD = 1 << 4,
+    YAAF_MAP_PREAD = 1 << 5,
+    YAAF_MAP_WINDOWED = 1 << 6,
+    YAAF_MAP_DIRECT = 1 << 7
+} YAAF_MapFlags;
+
+/**
+ * YAAF_ArchiveOptions holds the options used to open an archive. Always
+ * initialize the struct with YAAF_ArchiveOptionsInit() before use.
+ *
+ * mapFlags is a combination of YAAF_MapFlags.
+ * advice is applied to the whole archive when it is opened. readahead is the
+ * number of blocks files opened from the archive request ahead of a
+ * sequential read, 0 disables it.
+ * directCacheSize is the size in bytes of the chunk cache with
+ * YAAF_MAP_DIRECT.
+ * blockCacheSize is the memory budget in bytes of a cache of decompressed
+ * blocks shared by all the files opened from the archive, 0 disables it.
+ * Files opened at the same time then only decompress a block once.
+ * filePoolSize is the number of destroyed files kept with their buffers to be
+ * reused by the next files opened, 0 disables it. With a pool all the files
+ * must be destroyed before the archive is closed.
+ * verifyOnRead, when non zero, checks each block against its stored hash the
+ * first time it is read from the archive. Corrupted blocks then fail the read
+ * instead of returning bad data. The archive remembers the verified blocks,
+ * at the cost of one bit per block.
+ */
+typedef struct
+{
+    YAAF_Validation validation;
+    YAAF_Advice advice;
+    uint32_t readahead;
+    uint32_t mapFlags;
+    uint64_t directCacheSize;
+    uint64_t blockCacheSize;
+    uint32_t filePoolSize;
+    uint32_t verifyOnRead;
+} YAAF_ArchiveOptions;
+
 /**
  * YAAF_Archive holds all the information regarding the archive.
  * It is provided as a forwad declaration in order to handle future abstractions
@@ -114,6 +223,81 @@ typedef struct YAAF_Archive YAAF_Archive;
 struct YAAF_File;
 typedef struct YAAF_File YAAF_File;
 
+/**
+ * YAAF_Dir is a handle to a directory in the archive, used to look up files
+ * relative to the directory.
+ */
+struct YAAF_Dir;
+typedef struct YAAF_Dir YAAF_Dir;
+
+/**
+ * YAAF_EntryId identifies a file in an archive, it is the index of the file in
+ * the manifest and stays valid until the archive is closed. Retrieve it with
+ * YAAF_ArchiveResolve() to skip the name lookup on every open.
+ */
+typedef uint32_t YAAF_EntryId;
+#define YAAF_ENTRY_ID_INVALID ((YAAF_EntryId)0xFFFFFFFF)
+
+/**
+ * YAAF_ThreadPool is a set of worker threads used to decode blocks in
+ * parallel.
+ */
+struct YAAF_ThreadPool;
+typedef struct YAAF_ThreadPool YAAF_ThreadPool;
+
+/**
+ * YAAF_ReadRequest is a handle to an asynchronous read.
+ */
+struct YAAF_ReadRequest;
+typedef struct YAAF_ReadRequest YAAF_ReadRequest;
+
+/**
+ * State of an asynchronous read.
+ */
+typedef enum
+{
+    YAAF_READ_PENDING = 0,
+    YAAF_READ_DONE,
+    YAAF_READ_FAILED,
+    YAAF_READ_CANCELLED
+} YAAF_ReadStatus;
+
+/**
+ * Called on the worker thread when an asynchronous read completes, fails or
+ * is cancelled. On failure YAAF_GetError() holds the reason. The request must
+ * not be waited on or released from inside its callback, YAAF_ReadWait() and
+ * YAAF_ReadRelease() wait for the callback to return.
+ * @param bytesRead Number of bytes written into the buffer.
+ */
+typedef void (*YAAF_ReadCallback)(YAAF_ReadRequest* pRequest,
+                                  YAAF_ReadStatus status,
+                                  uint64_t bytesRead,
+                                  void* pUser);
+
+/**
+ * Verification performed by YAAF_ArchiveCheckEx().
+ *
+ * YAAF_CHECK_FULL verifies the hash of every block, then decompresses the
+ * blocks to verify the hash of every file.
+ * YAAF_CHECK_BLOCKS verifies the manifest, the layout of the blocks and the
+ * hash of every block as stored, without decompressing. Use it to detect
+ * transfer or storage errors quickly.
+ */
+typedef enum
+{
+    YAAF_CHECK_FULL = 0,
+    YAAF_CHECK_BLOCKS
+} YAAF_CheckLevel;
+
+/**
+ * Called by YAAF_ArchiveCheckEx() for every corrupted file, in the order of
+ * the files in the archive.
+ * @param error The reason the check failed.
+ */
+typedef void (*YAAF_CheckCallback)(const char* file,
+                                   const char* error,
+                                   void* pUser);
+
 /**
  * YAAF archives use the slasch character as a path separator. Note also that
  * there is no root separator. If , for instance, in the root of the archive
@@ -158,11 +342,25 @@ YAAF_EXPORT const char* YAAF_CALL YAAF_GetError();
 /* YAAF Arhcive API */
 
 /**
- * Open an archive at a given path.
+ * Open an archive at a given path, with YAAF_VALIDATION_DEFERRED.
  * @return NULL on failure, otherwise a pointer to the loaded archive.
  */
 YAAF_EXPORT YAAF_Archive* YAAF_CALL YAAF_ArchiveOpen(const char* path);
 
+/**
+ * Initialize the archive options with the default values, which match the
+ * behaviour of YAAF_ArchiveOpen().
+ */
+YAAF_EXPORT void YAAF_CALL YAAF_ArchiveOptionsInit(YAAF_ArchiveOptions* pOptions);
+
+/**
+ * Open an archive at a given path with the given options.
+ * @param pOptions Options to use, pass NULL to use the default options.
+ * @return NULL on failure, otherwise a pointer to the loaded archive.
+ */
+YAAF_EXPORT YAAF_Archive* YAAF_CALL YAAF_ArchiveOpenEx(const char* path,
+                                                       const YAAF_ArchiveOptions* pOptions);
+
 /**
  * Open an archive already loaded into memory.
  * @param freeOnClose Set to 1 if YAAF can free ptr when a call to
@@ -208,6 +406,21 @@ YAAF_EXPORT void YAAF_CALL YAAF_ArchiveFreeList(const char** pList);
 YAAF_EXPORT int YAAF_CALL YAAF_ArchiveFileInfo(YAAF_Archive* pArchive,
                                                const char* filePath,
                                                YAAF_FileInfo* pInfo);
+
+/**
+ * Retrieve information for a file in the archive by its id.
+ * @return YAAF_FAIL if the id is not valid, YAAF_SUCCESS otherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_ArchiveFileInfoById(YAAF_Archive* pArchive,
+                                                   const YAAF_EntryId id,
+                                                   YAAF_FileInfo* pInfo);
+
+/**
+ * Look up the id of a file in the archive.
+ * @return YAAF_ENTRY_ID_INVALID if the file was not found, the id otherwise.
+ */
+YAAF_EXPORT YAAF_EntryId YAAF_CALL YAAF_ArchiveResolve(const YAAF_Archive* pArchive,
+                                                       const char* file);
 /**
  * Check whether a file exists or not in the archive.
  * @return YAAF_FAIL if the files was not found, YAAF_SUCCESS otherwise.
@@ -217,13 +430,31 @@ YAAF_EXPORT int YAAF_CALL YAAF_ArchiveContains(const YAAF_Archive* pArchive,
 
 /**
  * Check the archive's contents and see if they match the stored hashes.
- * For each entry this will check the hash for the compressed blocks as well
- * as the uncompressed data.
+ * This verifies the manifest entry list and the lookup index, then for each
+ * entry the hash for the compressed blocks as well as the uncompressed data.
  * @note This is a slow operation, every file needs to be checked individually.
+ * The files are checked in parallel on the library's default thread pool,
+ * which is created on first use with a thread per CPU and kept until
+ * YAAF_Shutdown(). Use YAAF_ArchiveCheckEx() to check on a pool of your own.
  * @return YAAF_SUCCESS if everthing checks out, YAAF_FAIL otherwise.
  */
 YAAF_EXPORT int YAAF_CALL YAAF_ArchiveCheck(const YAAF_Archive* pArchive);
 
+/**
+ * Check the archive with the given level, with the files spread over the
+ * threads of pPool in the order they are stored. The check does not stop at
+ * the first corrupted file, callback is invoked on the calling thread for
+ * each of them once all the files are checked.
+ * @param pPool Pool to check on, NULL for the library's default pool.
+ * @param callback Optional, called for each corrupted file.
+ * @return YAAF_SUCCESS if everthing checks out, YAAF_FAIL otherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_ArchiveCheckEx(const YAAF_Archive* pArchive,
+                                              const YAAF_CheckLevel level,
+                                              YAAF_ThreadPool* pPool,
+                                              YAAF_CheckCallback callback,
+                                              void* pUser);
+
 /**
  * Check wether the file in the archive's matches the stored hashes.
  * @return YAAF_SUCCESS if everthing checks out, YAAF_FAIL otherwise or if
@@ -232,6 +463,65 @@ YAAF_EXPORT int YAAF_CALL YAAF_ArchiveCheck(const YAAF_Archive* pArchive);
 YAAF_EXPORT int YAAF_CALL YAAF_ArchiveCheckFile(const YAAF_Archive* pArchive,
                                                 const char* file);
 
+/**
+ * Read a whole file from the archive into pBuffer, without opening a File
+ * stream. Use YAAF_ArchiveFileInfo() to retrieve the required buffer size.
+ * @param size Size of pBuffer, must be at least the uncompressed file size.
+ * @return YAAF_FAIL if the file was not found, the buffer is too small or on
+ * failure. YAAF_SUCCESS otherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_ArchiveReadFile(const YAAF_Archive* pArchive,
+                                               const char* file,
+                                               void* pBuffer,
+                                               const uint64_t size);
+
+/**
+ * Read a whole file from the archive by its id, see YAAF_ArchiveReadFile().
+ * @return YAAF_FAIL if the id is not valid, the buffer is too small or on
+ * failure. YAAF_SUCCESS otherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_ArchiveReadFileById(const YAAF_Archive* pArchive,
+                                                   const YAAF_EntryId id,
+                                                   void* pBuffer,
+                                                   const uint64_t size);
+
+/**
+ * Pass an access pattern hint for the whole archive to the OS.
+ * @return YAAF_FAIL on failure. YAAF_SUCCESS ohtherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_ArchiveAdvise(const YAAF_Archive* pArchive,
+                                             const YAAF_Advice advice);
+
+/* YAAF Dir API */
+
+/**
+ * Open a directory in the archive. Use "." to open the root of the archive.
+ * @return NULL if the directory was not found or on failure.
+ */
+YAAF_EXPORT YAAF_Dir* YAAF_CALL YAAF_DirOpen(const YAAF_Archive* pArchive,
+                                             const char* dir);
+
+/**
+ * Check whether a file exists in the directory. The file path is relative to
+ * the directory.
+ * @return YAAF_FAIL if the files was not found, YAAF_SUCCESS otherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_DirContains(const YAAF_Dir* pDir,
+                                           const char* file);
+
+/**
+ * Open a File stream for a file in the directory. The file path is relative to
+ * the directory.
+ * @return NULL if file was not found or on failure.
+ */
+YAAF_EXPORT YAAF_File* YAAF_CALL YAAF_DirFileOpen(const YAAF_Dir* pDir,
+                                                  const char* file);
+
+/**
+ * Close the directory handle.
+ */
+YAAF_EXPORT void YAAF_CALL YAAF_DirClose(YAAF_Dir* pDir);
+
 /* YAAF File API */
 
 /**
@@ -241,6 +531,29 @@ YAAF_EXPORT int YAAF_CALL YAAF_ArchiveCheckFile(const YAAF_Archive* pArchive,
 YAAF_EXPORT YAAF_File* YAAF_CALL YAAF_FileOpen(YAAF_Archive* pArchive,
                                                const char* filePath);
 
+/**
+ * Open a File stream for a file in the archive by its id.
+ * @return NULL if the id is not valid or on failure.
+ */
+YAAF_EXPORT YAAF_File* YAAF_CALL YAAF_FileOpenById(YAAF_Archive* pArchive,
+                                                   const YAAF_EntryId id);
+
+/**
+ * @return The size in bytes of the storage required by YAAF_FileOpenInPlace().
+ */
+YAAF_EXPORT size_t YAAF_CALL YAAF_FileStorageSize(void);
+
+/**
+ * Open a File stream for a file in the archive in memory provided by the
+ * caller. pStorage must be aligned to 8 bytes and storageSize must be at
+ * least YAAF_FileStorageSize(). YAAF_FileDestroy() does not free pStorage.
+ * @return NULL if file was not found or on failure.
+ */
+YAAF_EXPORT YAAF_File* YAAF_CALL YAAF_FileOpenInPlace(YAAF_Archive* pArchive,
+                                                      const char* filePath,
+                                                      void* pStorage,
+                                                      const size_t storageSize);
+
 /**
  * Read up to size bytes into pBuffer.
  * @return Number of bytes read from the file.
@@ -249,6 +562,42 @@ YAAF_EXPORT uint32_t YAAF_CALL YAAF_FileRead(YAAF_File* pFile,
                                              void* pBuffer,
                                              const uint32_t size);
 
+/**
+ * Read the whole file into pBuffer, regardless of the current position. The
+ * blocks are decoded straight into pBuffer. Afterwards the file is at EOF.
+ * @param pBuffer Buffer large enough to hold YAAF_FileSize() bytes.
+ * @return YAAF_FAIL on failure. YAAF_SUCCESS ohtherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_FileReadAll(YAAF_File* pFile,
+                                           void* pBuffer);
+
+/**
+ * Get the data from the current position up to the end of the current block
+ * without copying it. The data is either the decompressed block or points
+ * directly into the archive for blocks stored without compression. The file
+ * position advances past the returned data.
+ * @param pPtr Receives a pointer to the data, valid until the next call on
+ * pFile.
+ * @param pSize Receives the size of the data, 0 on EOF.
+ * @return YAAF_FAIL on failure. YAAF_SUCCESS ohtherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_FileNextBlock(YAAF_File* pFile,
+                                             const void** pPtr,
+                                             uint32_t* pSize);
+
+/**
+ * Read up to size bytes into pBuffer, decoding the blocks in the range
+ * concurrently into their place in pBuffer. When pBuffer is NULL the data is
+ * skipped like with YAAF_FileRead(), without going parallel.
+ * @param pPool Thread pool to use, NULL for the library's default pool.
+ * @return Number of bytes read from the file. On failure, the bytes delivered
+ * before the error, the file position is only advanced by those.
+ */
+YAAF_EXPORT uint64_t YAAF_CALL YAAF_FileReadParallel(YAAF_File* pFile,
+                                                     void* pBuffer,
+                                                     const uint64_t size,
+                                                     YAAF_ThreadPool* pPool);
+
 /**
  * Seek to a position in the file stream. This function behaves the same ways
  * as libc's fseek().
@@ -256,9 +605,23 @@ YAAF_EXPORT uint32_t YAAF_CALL YAAF_FileRead(YAAF_File* pFile,
  * @return YAAF_FAIL on failure. YAAF_SUCCESS ohtherwise.
  */
 YAAF_EXPORT int YAAF_CALL YAAF_FileSeek(YAAF_File* pFile,
-                                        int offset,
+                                        int64_t offset,
                                         int flags);
 
+/**
+ * Pass an access pattern hint for the compressed data of the file to the OS.
+ * @return YAAF_FAIL on failure. YAAF_SUCCESS ohtherwise.
+ */
+YAAF_EXPORT int YAAF_CALL YAAF_FileAdvise(YAAF_File* pFile,
+                                          const YAAF_Advice advice);
+
+/**
+ * Set the number of blocks requested ahead of a sequential read, 0 disables
+ * it. The default comes from the archive's options.
+ */
+YAAF_EXPORT void YAAF_CALL YAAF_FileSetReadahead(YAAF_File* pFile,
+                                                 const uint32_t nBlocks);
+
 /**
  * Check whether we have reached the end of the file.
  * @return 1 on EOF, 0 otherwise.
@@ -268,18 +631,91 @@ YAAF_EXPORT int YAAF_CALL YAAF_FileEOF(const YAAF_File* pFile);
 /**
  * Get the current position in the file.
  */
-YAAF_EXPORT uint32_t YAAF_CALL YAAF_FileTell(const YAAF_File* pFile);
+YAAF_EXPORT uint64_t YAAF_CALL YAAF_FileTell(const YAAF_File* pFile);
 
 /**
  * Get the file size
  */
-YAAF_EXPORT uint32_t YAAF_CALL YAAF_FileSize(const YAAF_File* pFile);
+YAAF_EXPORT uint64_t YAAF_CALL YAAF_FileSize(const YAAF_File* pFile);
 
 /**
  * Close the file stream.
  */
 YAAF_EXPORT void YAAF_CALL YAAF_FileDestroy(YAAF_File* pFile);
 
+/* YAAF Async Read API */
+
+/**
+ * Read up to size bytes starting at offset of a file in the archive on a
+ * worker thread. The archive and pBuffer need to stay valid until the request
+ * has completed. The file is looked up before the request is queued.
+ * @param callback Optional completion callback.
+ * @param pPool Thread pool to use, NULL for the library's default pool.
+ * @return NULL on failure or if the file was not found. The request must be
+ * released with YAAF_ReadRelease().
+ */
+YAAF_EXPORT YAAF_ReadRequest* YAAF_CALL YAAF_ReadAsync(YAAF_Archive* pArchive,
+                                                       const char* filePath,
+                                                       const uint64_t offset,
+                                                       const uint64_t size,
+                                                       void* pBuffer,
+                                                       YAAF_ReadCallback callback,
+                                                       void* pUser,
+                                                       YAAF_ThreadPool* pPool);
+
+/**
+ * Same as YAAF_ReadAsync() for a file identified by its YAAF_EntryId. The id
+ * is checked by the worker, an invalid id fails the read.
+ */
+YAAF_EXPORT YAAF_ReadRequest* YAAF_CALL YAAF_ReadAsyncById(YAAF_Archive* pArchive,
+                                                           const YAAF_EntryId id,
+                                                           const uint64_t offset,
+                                                           const uint64_t size,
+                                                           void* pBuffer,
+                                                           YAAF_ReadCallback callback,
+                                                           void* pUser,
+                                                           YAAF_ThreadPool* pPool);
+
+/**
+ * Request the cancellation of the read. A read that has already started
+ * stops at the next block.
+ */
+YAAF_EXPORT void YAAF_CALL YAAF_ReadCancel(YAAF_ReadRequest* pRequest);
+
+/**
+ * Get the state of the read without blocking. The completion callback may
+ * still be running when the read is reported as finished.
+ */
+YAAF_EXPORT YAAF_ReadStatus YAAF_CALL YAAF_ReadPoll(YAAF_ReadRequest* pRequest);
+
+/**
+ * Wait for the read to complete. The calling thread helps with the queued
+ * work while waiting. On failure YAAF_GetError() returns the error of the
+ * read.
+ * @param pBytesRead Optional, receives the number of bytes read.
+ */
+YAAF_EXPORT YAAF_ReadStatus YAAF_CALL YAAF_ReadWait(YAAF_ReadRequest* pRequest,
+                                                    uint64_t* pBytesRead);
+
+/**
+ * Wait for the read to complete and release the request.
+ */
+YAAF_EXPORT void YAAF_CALL YAAF_ReadRelease(YAAF_ReadRequest* pRequest);
+
+/* YAAF Thread Pool API */
+
+/**
+ * Create a thread pool.
+ * @param nThreads Number of worker threads, 0 for one per CPU.
+ * @return NULL on failure.
+ */
+YAAF_EXPORT YAAF_ThreadPool* YAAF_CALL YAAF_ThreadPoolCreate(const uint32_t nThreads);
+
+/**
+ * Destroy the thread pool. It must not be in use.
+ */
+YAAF_EXPORT void YAAF_CALL YAAF_ThreadPoolDestroy(YAAF_ThreadPool* pPool);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -41,8 +41,8 @@ extern "C" {
 /* --- Version ------------------------------------------------------------- */
 
 #define YAAF_VERSION_MAJOR 1
-#define YAAF_VERSION_MINOR 1
-#define YAAF_VERSION_PATCH 3
+#define YAAF_VERSION_MINOR 3
+#define YAAF_VERSION_PATCH 0
 
 #define YAAF_VERSION_MK(MA,MI, REV) (MA * 100 * 100) + (MI * 100) + REV
 #define YAAF_VERSION YAAF_VERSION_MK(YAAF_VERSION_MAJOR,YAAF_VERSION_MINOR,\
@@ -33,19 +33,17 @@
 #include "YAAF_Archive.h"
 #include "YAAF_File.h"
 #include "YAAF_Hash.h"
+#include "YAAF_Thread.h"
 
 
 /* Aux functions */
 int YAAF_ArchiveParse(YAAF_Archive* pArchive);
 
-uint32_t YAAF_ArchiveLocateFile(const YAAF_Archive* pArchive,
-                                const char* file);
-
 YAAF_FORCE_INLINE const char*
 YAAF_ManifestEntryName(const YAAF_ManifestEntry* pEntry)
 {
     const char* ptr = (const char*)pEntry;
-    ptr += sizeof(struct YAAF_ManifestEntry);
+    ptr += YAAF_ManifestEntryHeaderSize(pEntry);
     return ptr + pEntry->extraLen;
 }
 
@@ -53,28 +51,627 @@ YAAF_FORCE_INLINE const void*
 YAAF_ManifestEntryExtra(const YAAF_ManifestEntry* pEntry)
 {
     const char* ptr = (const char*)pEntry;
-    return ptr + sizeof(struct YAAF_ManifestEntry);
+    return ptr + YAAF_ManifestEntryHeaderSize(pEntry);
+}
+
+YAAF_FORCE_INLINE const YAAF_ManifestEntry*
+YAAF_ManifestEntryNext(const YAAF_ManifestEntry* pEntry)
+{
+    const char* ptr = (const char*)pEntry;
+    ptr += YAAF_ManifestEntryHeaderSize(pEntry);
+    return (const YAAF_ManifestEntry*)(ptr + pEntry->extraLen + pEntry->nameLen);
+}
+
+static int
+YAAF_ArchiveValidateEntry(const YAAF_Archive* pArchive,
+                          const YAAF_ManifestEntry* pEntry)
+{
+    const size_t entry_offset = (size_t)((const char*)pEntry - (const char*)pArchive->pEntries);
+    const size_t entries_size = pArchive->pManifest->manifestEntriesSize;
+    const uint64_t data_size = pArchive->entriesOffset;
+    uint64_t data_offset, data_end;
+
+    /* validate entry bounds */
+    if (entry_offset + sizeof(struct YAAF_ManifestEntry) > entries_size ||
+            entry_offset + YAAF_ManifestEntryHeaderSize(pEntry) + pEntry->extraLen
+            + pEntry->nameLen > entries_size || pEntry->nameLen == 0)
+    {
+        YAAF_SetError("Manifest Entry out of bounds");
+        return YAAF_FAIL;
+    }
+
+    /* validate file data bounds, including the end of blocks marker */
+    data_offset = YAAF_ManifestEntryOffset(pEntry);
+    data_end = data_offset + sizeof(YAAF_FileHeader) + sizeof(YAAF_BlockHeader) +
+            YAAF_ManifestEntrySizeCompressed(pEntry);
+    if (data_offset >= data_size || data_end > data_size || data_end < data_offset)
+    {
+        YAAF_SetError("Manifest Entry data out of bounds");
+        return YAAF_FAIL;
+    }
+
+    /* validate entry magic */
+    if (pEntry->magic != YAAF_MANIFEST_ENTRY_MAGIC)
+    {
+        YAAF_SetError("Invalid Manifest Entry");
+        return YAAF_FAIL;
+    }
+
+    /* check compression */
+    if (!(pEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK))
+    {
+        YAAF_SetError("Unsupported compression");
+        return YAAF_FAIL;
+    }
+
+    /* names are always null terminated */
+    if (YAAF_ManifestEntryName(pEntry)[pEntry->nameLen - 1] != '\0')
+    {
+        YAAF_SetError("Invalid Manifest Entry name");
+        return YAAF_FAIL;
+    }
+
+    return YAAF_SUCCESS;
+}
+
+static uint32_t
+YAAF_ArchiveNameHash(const YAAF_Archive* pArchive,
+                     const char* file,
+                     const size_t len)
+{
+    if (!(pArchive->flags & YAAF_ARCHIVE_FLAG_NAME_HASH_V2))
+    {
+        return YAAF_OnceAtATimeHashNoCase(file);
+    }
+    return (pArchive->flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) ?
+                YAAF_NameHashExact(file, len) : YAAF_NameHash(file, len);
+}
+
+/* Name comparisons follow the case sensitivity of the archive */
+static int
+YAAF_ArchiveNameCompare(const YAAF_Archive* pArchive,
+                        const char* name1,
+                        const char* name2)
+{
+    return (pArchive->flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) ?
+                strcmp(name1, name2) : YAAF_StrCompareNoCase(name1, name2);
+}
+
+/* Get the manifest entry of an id, without validating it */
+static const YAAF_ManifestEntry*
+YAAF_ArchiveEntryPtr(const YAAF_Archive* pArchive,
+                     const YAAF_EntryId id)
+{
+    uint32_t offset;
+
+    if (pArchive->pIndex)
+    {
+        /* the entry table is not aligned in the mapping */
+        memcpy(&offset, YAAF_CONST_PTR_OFFSET(pArchive->pIndexEntries, id * sizeof(uint32_t)),
+               sizeof(offset));
+        offset = YAAF_LITTLE_E32(offset);
+    }
+    else
+    {
+        offset = pArchive->pEntryOffsets[id];
+    }
+    return (const YAAF_ManifestEntry*) YAAF_CONST_PTR_OFFSET(pArchive->pEntries, offset);
+}
+
+/* Entries not checked at open time are checked on their first lookup and
+ * marked in the pValidated bitmap */
+static int
+YAAF_ArchiveValidateId(const YAAF_Archive* pArchive,
+                       const YAAF_EntryId id,
+                       const YAAF_ManifestEntry* pEntry)
+{
+    uint32_t* p_word;
+    uint32_t mask;
+
+    /* entries are trusted with header only validation */
+    if (pArchive->options.validation == YAAF_VALIDATION_HEADER || pArchive->entriesValidated)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    p_word = &pArchive->pValidated[id / 32];
+    mask = 1u << (id % 32);
+    if (YAAF_AtomicLoad32(p_word) & mask)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    if (YAAF_ArchiveValidateEntry(pArchive, pEntry) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+    YAAF_AtomicOr32(p_word, mask);
+    return YAAF_SUCCESS;
+}
+
+static YAAF_EntryId
+YAAF_ArchiveIndexFind(const YAAF_Archive* pArchive,
+                      const char* file)
+{
+    const size_t len = strlen(file);
+    const uint32_t hash = YAAF_ArchiveNameHash(pArchive, file, len);
+    const uint32_t mask = pArchive->pIndex->nSlots - 1;
+    uint32_t i;
+
+    for (i = 0; i < pArchive->pIndex->nSlots; ++i)
+    {
+        const YAAF_IndexSlot* p_slot = &pArchive->pIndexSlots[(hash + i) & mask];
+
+        if (p_slot->entry == YAAF_INDEX_SLOT_EMPTY)
+        {
+            /* No key found when the slot is empty */
+            break;
+        }
+
+        if (p_slot->nameHash == hash && p_slot->entry < pArchive->pManifest->nEntries)
+        {
+            const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryPtr(pArchive, p_slot->entry);
+
+            if (YAAF_ArchiveValidateId(pArchive, p_slot->entry, p_entry) != YAAF_SUCCESS)
+            {
+                break;
+            }
+
+            /* the name length includes the terminator */
+            if (p_entry->nameLen == len + 1 &&
+                    ((pArchive->flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) ?
+                         memcmp(file, YAAF_ManifestEntryName(p_entry), len) == 0 :
+                         YAAF_StrEqualNoCaseN(file, YAAF_ManifestEntryName(p_entry), len)))
+            {
+                return p_slot->entry;
+            }
+        }
+    }
+    return YAAF_ENTRY_ID_INVALID;
+}
+
+static int
+YAAF_ArchiveWalkEntry(const YAAF_Archive* pArchive,
+                      const YAAF_ManifestEntry* pEntry)
+{
+    /* entries not checked at open time need to be checked while walking */
+    if (pArchive->entriesValidated)
+    {
+        return YAAF_SUCCESS;
+    }
+    return YAAF_ArchiveValidateEntry(pArchive, pEntry);
+}
+
+static const YAAF_ManifestEntry*
+YAAF_ArchiveEntryById(const YAAF_Archive* pArchive,
+                      const YAAF_EntryId id)
+{
+    const YAAF_ManifestEntry* p_entry;
+
+    if (id >= pArchive->pManifest->nEntries)
+    {
+        YAAF_SetError("Invalid entry id");
+        return NULL;
+    }
+
+    p_entry = YAAF_ArchiveEntryPtr(pArchive, id);
+    if (YAAF_ArchiveValidateId(pArchive, id, p_entry) != YAAF_SUCCESS)
+    {
+        return NULL;
+    }
+    return p_entry;
+}
+
+static int
+YAAF_ManifestEntryCompareFnc(const void* p1,
+                             const void* p2)
+{
+    return YAAF_StrCompareNoCase(YAAF_ManifestEntryName(((const YAAF_SortedEntry*)p1)->pEntry),
+                                 YAAF_ManifestEntryName(((const YAAF_SortedEntry*)p2)->pEntry));
+}
+
+static int
+YAAF_ManifestEntryCompareExactFnc(const void* p1,
+                                  const void* p2)
+{
+    return strcmp(YAAF_ManifestEntryName(((const YAAF_SortedEntry*)p1)->pEntry),
+                  YAAF_ManifestEntryName(((const YAAF_SortedEntry*)p2)->pEntry));
+}
+
+static int
+YAAF_ArchiveSortEntries(YAAF_Archive* pArchive)
+{
+    uint32_t i;
+
+    if (!pArchive->pSortedEntries)
+    {
+        pArchive->pSortedEntries = (YAAF_SortedEntry*)
+                YAAF_malloc(sizeof(YAAF_SortedEntry) * pArchive->pManifest->nEntries);
+        if (!pArchive->pSortedEntries)
+        {
+            YAAF_SetError("Failed to allocate memory for entry table");
+            return YAAF_FAIL;
+        }
+
+        for (i = 0; i < pArchive->pManifest->nEntries; ++i)
+        {
+            pArchive->pSortedEntries[i].pEntry = YAAF_ArchiveEntryPtr(pArchive, i);
+            pArchive->pSortedEntries[i].id = i;
+        }
+    }
+
+    qsort(pArchive->pSortedEntries, pArchive->pManifest->nEntries,
+          sizeof(YAAF_SortedEntry),
+          (pArchive->flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) ?
+              YAAF_ManifestEntryCompareExactFnc : YAAF_ManifestEntryCompareFnc);
+    return YAAF_SUCCESS;
+}
+
+static const YAAF_ManifestEntry*
+YAAF_ArchiveEntryAt(const YAAF_Archive* pArchive,
+                    const uint32_t i)
+{
+    const YAAF_ManifestEntry* p_entry;
+
+    if (pArchive->pSortedEntries)
+    {
+        return pArchive->pSortedEntries[i].pEntry;
+    }
+
+    p_entry = YAAF_ArchiveEntryPtr(pArchive, i);
+    if (YAAF_ArchiveValidateId(pArchive, i, p_entry) != YAAF_SUCCESS)
+    {
+        return NULL;
+    }
+    return p_entry;
+}
+
+/* Compare the start of name against dir, followed by a separator if addSep is set */
+static int
+YAAF_ArchivePrefixCompare(const YAAF_Archive* pArchive,
+                          const char* name,
+                          const char* dir,
+                          const size_t dirLen,
+                          const int addSep)
+{
+    int result = (pArchive->flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) ?
+                strncmp(name, dir, dirLen) : YAAF_StrNCompareNoCase(name, dir, dirLen);
+    if (result != 0 || !addSep)
+    {
+        return result;
+    }
+    return (int)(unsigned char)name[dirLen] - (int)YAAF_ARCHIVE_SEP_CHR;
+}
+
+/* Binary search for the first entry in [first, last) whose name does not
+ * compare lower (or higher when upper is set) than the given prefix */
+static int
+YAAF_ArchivePrefixBound(const YAAF_Archive* pArchive,
+                        uint32_t first,
+                        uint32_t last,
+                        const char* dir,
+                        const size_t dirLen,
+                        const int addSep,
+                        const int upper,
+                        uint32_t* pResult)
+{
+    while (first < last)
+    {
+        const uint32_t mid = first + (last - first) / 2;
+        const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryAt(pArchive, mid);
+        int cmp;
+
+        if (!p_entry)
+        {
+            return YAAF_FAIL;
+        }
+
+        cmp = YAAF_ArchivePrefixCompare(pArchive, YAAF_ManifestEntryName(p_entry), dir, dirLen, addSep);
+        if (cmp < 0 || (upper && cmp == 0))
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+    *pResult = first;
+    return YAAF_SUCCESS;
+}
+
+static int
+YAAF_ArchiveDirRange(const YAAF_Archive* pArchive,
+                     const char* dir,
+                     YAAF_Dir* pDir)
+{
+    const size_t dir_len = strlen(dir);
+    int add_sep;
+
+    pDir->pArchive = pArchive;
+    pDir->first = 0;
+    pDir->last = pArchive->pManifest->nEntries;
+    pDir->prefixLen = 0;
+
+    /* the root contains all the entries */
+    if (dir_len == 0 || strcmp(dir, ".") == 0)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    add_sep = dir[dir_len - 1] != YAAF_ARCHIVE_SEP_CHR;
+    if (YAAF_ArchivePrefixBound(pArchive, 0, pDir->last, dir, dir_len, add_sep, 0, &pDir->first) != YAAF_SUCCESS ||
+            YAAF_ArchivePrefixBound(pArchive, pDir->first, pDir->last, dir, dir_len, add_sep, 1, &pDir->last) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+    pDir->prefixLen = (uint32_t)dir_len + (add_sep ? 1 : 0);
+    return YAAF_SUCCESS;
+}
+
+/* Find the index of the next file in the root directory, skipping over the
+ * entries of each sub directory */
+static int
+YAAF_ArchiveNextRootFile(const YAAF_Archive* pArchive,
+                         uint32_t* pIndex)
+{
+    uint32_t i = *pIndex;
+
+    while (i < pArchive->pManifest->nEntries)
+    {
+        const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryAt(pArchive, i);
+        const char* name;
+        const char* sep;
+
+        if (!p_entry)
+        {
+            return YAAF_FAIL;
+        }
+
+        name = YAAF_ManifestEntryName(p_entry);
+        sep = strchr(name, YAAF_ARCHIVE_SEP_CHR);
+        if (!sep)
+        {
+            break;
+        }
+
+        if (YAAF_ArchivePrefixBound(pArchive, i + 1, pArchive->pManifest->nEntries,
+                                    name, (size_t)(sep - name) + 1, 0, 1, &i) != YAAF_SUCCESS)
+        {
+            return YAAF_FAIL;
+        }
+    }
+    *pIndex = i;
+    return YAAF_SUCCESS;
+}
+
+static YAAF_EntryId
+YAAF_ArchiveDirFindId(const YAAF_Dir* pDir,
+                      const char* file)
+{
+    uint32_t first = pDir->first, last = pDir->last;
+
+    while (first < last)
+    {
+        const uint32_t mid = first + (last - first) / 2;
+        const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryAt(pDir->pArchive, mid);
+        int cmp;
+
+        if (!p_entry)
+        {
+            return YAAF_ENTRY_ID_INVALID;
+        }
+
+        cmp = YAAF_ArchiveNameCompare(pDir->pArchive, YAAF_ManifestEntryName(p_entry) + pDir->prefixLen, file);
+        if (cmp == 0)
+        {
+            /* the position is the id unless the entries had to be sorted */
+            return (pDir->pArchive->pSortedEntries) ? pDir->pArchive->pSortedEntries[mid].id : mid;
+        }
+        else if (cmp < 0)
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+    YAAF_SetError("File not found");
+    return YAAF_ENTRY_ID_INVALID;
+}
+
+static YAAF_EntryId
+YAAF_ArchiveFindId(const YAAF_Archive* pArchive,
+                   const char* file)
+{
+    const uint32_t* p_offset;
+
+    if (pArchive->pIndex)
+    {
+        return YAAF_ArchiveIndexFind(pArchive, file);
+    }
+
+    /* the map points at the offset of the entry in pEntryOffsets */
+    p_offset = (const uint32_t*) YAAF_HashMapGetWithHash(&pArchive->entries,
+                                                         YAAF_ArchiveNameHash(pArchive, file, strlen(file)),
+                                                         file);
+    return (p_offset) ? (YAAF_EntryId)(p_offset - pArchive->pEntryOffsets) : YAAF_ENTRY_ID_INVALID;
+}
+
+static const YAAF_ManifestEntry*
+YAAF_ArchiveFindEntry(const YAAF_Archive* pArchive,
+                      const char* file)
+{
+    const YAAF_EntryId id = YAAF_ArchiveFindId(pArchive, file);
+
+    /* entries found by name have already been validated */
+    return (id != YAAF_ENTRY_ID_INVALID) ? YAAF_ArchiveEntryPtr(pArchive, id) : NULL;
+}
+
+static YAAF_Archive*
+YAAF_ArchiveAlloc(const YAAF_ArchiveOptions* pOptions)
+{
+    YAAF_Archive* p_archive = (YAAF_Archive*) YAAF_calloc(1,sizeof(YAAF_Archive));
+    if (!p_archive)
+    {
+        YAAF_SetError("Failed to allocate memory for archive");
+        return NULL;
+    }
+    p_archive->pManifest = NULL;
+    YAAF_HashMapInitNoAlloc(&p_archive->entries);
+    if (pOptions)
+    {
+        p_archive->options = *pOptions;
+    }
+    else
+    {
+        YAAF_ArchiveOptionsInit(&p_archive->options);
+    }
+    return p_archive;
+}
+
+void
+YAAF_ArchiveOptionsInit(YAAF_ArchiveOptions* pOptions)
+{
+    memset(pOptions, 0, sizeof(YAAF_ArchiveOptions));
+    pOptions->validation = YAAF_VALIDATION_DEFERRED;
+    pOptions->advice = YAAF_ADVICE_NORMAL;
+    pOptions->readahead = YAAF_DEFAULT_READAHEAD;
+    pOptions->mapFlags = 0;
+    pOptions->directCacheSize = YAAF_DEFAULT_DIRECT_CACHE_SIZE;
+    pOptions->blockCacheSize = 0;
+    pOptions->filePoolSize = 0;
+    pOptions->verifyOnRead = 0;
+}
+
+/* Number the blocks of all the entries for the bitmap of verified blocks,
+ * the first block of each entry is found by its id */
+static int
+YAAF_ArchiveVerifyInit(YAAF_Archive* pArchive)
+{
+    const uint32_t n_entries = pArchive->pManifest->nEntries;
+    uint64_t n_blocks = 0;
+    uint32_t i;
+
+    pArchive->pVerifyFirst = (uint64_t*) YAAF_malloc(sizeof(uint64_t) * (n_entries + 1));
+    if (!pArchive->pVerifyFirst)
+    {
+        YAAF_SetError("Failed to allocate memory for verified blocks");
+        return YAAF_FAIL;
+    }
+
+    for (i = 0; i < n_entries; ++i)
+    {
+        const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryById(pArchive, i);
+        if (!p_entry)
+        {
+            return YAAF_FAIL;
+        }
+        pArchive->pVerifyFirst[i] = n_blocks;
+        n_blocks += (YAAF_ManifestEntrySizeUncompressed(p_entry) + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
+    }
+
+    pArchive->pVerified = (uint32_t*) YAAF_calloc((size_t)(n_blocks / 32 + 1), sizeof(uint32_t));
+    if (!pArchive->pVerified)
+    {
+        YAAF_SetError("Failed to allocate memory for verified blocks");
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+/* Locate the blocks of the entry in the bitmap of verified blocks */
+static void
+YAAF_ArchiveEntryVerify(const YAAF_Archive* pArchive,
+                        const YAAF_EntryId id,
+                        const YAAF_ManifestEntry* pEntry,
+                        YAAF_FileVerify* pVerify)
+{
+    memset(pVerify, 0, sizeof(YAAF_FileVerify));
+    if (pArchive->pVerified)
+    {
+        pVerify->pVerified = pArchive->pVerified;
+        pVerify->first = pArchive->pVerifyFirst[id];
+        pVerify->nBlocks = (YAAF_ManifestEntrySizeUncompressed(pEntry) + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
+        pVerify->hashAlgorithm = pArchive->hashAlgorithm;
+    }
+}
+
+/* Lock the lookup index, the entries and the manifest at the end of the
+ * archive */
+static int
+YAAF_ArchiveLockManifest(const YAAF_Archive* pArchive)
+{
+    const uint64_t offset = (pArchive->pIndex) ?
+                pArchive->entriesOffset - sizeof(YAAF_IndexHeader) - pArchive->pIndex->indexSize :
+                pArchive->entriesOffset;
+    return YAAF_MemFileLock(&pArchive->memFile, offset, pArchive->memFile.size - offset);
 }
 
 YAAF_Archive*
 YAAF_ArchiveOpen(const char* path)
+{
+    return YAAF_ArchiveOpenEx(path, NULL);
+}
+
+YAAF_Archive*
+YAAF_ArchiveOpenEx(const char* path,
+                   const YAAF_ArchiveOptions* pOptions)
 {
     YAAF_Archive* p_archive = NULL;
     if (path)
     {
-        p_archive = (YAAF_Archive*) YAAF_calloc(1,sizeof(YAAF_Archive));
-        p_archive->pManifest = NULL;
-        YAAF_HashMapInitNoAlloc(&p_archive->entries);
+        p_archive = YAAF_ArchiveAlloc(pOptions);
+        if (!p_archive)
+        {
+            return NULL;
+        }
+
+        if (YAAF_MemFileOpenEx(&p_archive->memFile, path, p_archive->options.mapFlags,
+                               p_archive->options.directCacheSize) == YAAF_FAIL)
+        {
+            YAAF_free(p_archive);
+            return NULL;
+        }
+
+        if (YAAF_ArchiveParse(p_archive) ||
+                ((p_archive->options.mapFlags & YAAF_MAP_LOCK_MANIFEST) &&
+                 YAAF_ArchiveLockManifest(p_archive) != YAAF_SUCCESS))
+        {
+            YAAF_ArchiveClose(p_archive);
+            return NULL;
+        }
+
+        if (p_archive->options.blockCacheSize)
+        {
+            p_archive->pBlockCache = YAAF_BlockCacheCreate(p_archive->options.blockCacheSize);
+            if (!p_archive->pBlockCache)
+            {
+                YAAF_ArchiveClose(p_archive);
+                return NULL;
+            }
+        }
 
-        if (YAAF_MemFileOpen(&p_archive->memFile, path) == YAAF_FAIL)
+        if (p_archive->options.verifyOnRead && YAAF_ArchiveVerifyInit(p_archive) != YAAF_SUCCESS)
         {
+            YAAF_ArchiveClose(p_archive);
             return NULL;
         }
 
-        if (YAAF_ArchiveParse(p_archive))
+        if (p_archive->options.filePoolSize)
         {
-            YAAF_ArchiveClose(p_archive);
-            p_archive = NULL;
+            p_archive->pFilePool = YAAF_FilePoolCreate(p_archive->options.filePoolSize);
+            if (!p_archive->pFilePool)
+            {
+                YAAF_ArchiveClose(p_archive);
+                return NULL;
+            }
+        }
+
+        if (p_archive->options.advice != YAAF_ADVICE_NORMAL)
+        {
+            YAAF_ArchiveAdvise(p_archive, p_archive->options.advice);
         }
     }
     return p_archive;
@@ -88,13 +685,16 @@ YAAF_ArchiveOpenInMemory(const void* ptr,
     YAAF_Archive* p_archive = NULL;
     if (ptr && size)
     {
-        p_archive = (YAAF_Archive*) YAAF_calloc(1,sizeof(YAAF_Archive));
-        p_archive->pManifest = NULL;
-        YAAF_HashMapInitNoAlloc(&p_archive->entries);
+        p_archive = YAAF_ArchiveAlloc(NULL);
+        if (!p_archive)
+        {
+            return NULL;
+        }
 
         if (YAAF_MemFileFromMemory(&p_archive->memFile, ptr,
                                    size, (freeOnClose) ? YAAF_MEMFILE_CLOSE_FREE : YAAF_MEMFILE_CLOSE_WTHFREE) == YAAF_FAIL)
         {
+            YAAF_free(p_archive);
             return NULL;
         }
 
@@ -117,6 +717,31 @@ YAAF_ArchiveClose(YAAF_Archive* pArchive)
     if (pArchive)
     {
         YAAF_HashMapDestroy(&pArchive->entries);
+        YAAF_free((void*)pArchive->pSortedEntries);
+        if (pArchive->pEntryOffsets)
+        {
+            YAAF_free(pArchive->pEntryOffsets);
+        }
+        if (pArchive->pValidated)
+        {
+            YAAF_free(pArchive->pValidated);
+        }
+        if (pArchive->pBlockCache)
+        {
+            YAAF_BlockCacheDestroy(pArchive->pBlockCache);
+        }
+        if (pArchive->pFilePool)
+        {
+            YAAF_FilePoolDestroy(pArchive->pFilePool);
+        }
+        if (pArchive->pVerified)
+        {
+            YAAF_free(pArchive->pVerified);
+        }
+        if (pArchive->pVerifyFirst)
+        {
+            YAAF_free(pArchive->pVerifyFirst);
+        }
         YAAF_MemFileClose(&pArchive->memFile);
         YAAF_free(pArchive);
     }
@@ -128,14 +753,17 @@ YAAF_ArchiveListAll(const YAAF_Archive* pArchive)
     const char ** p_result = (const char**)YAAF_malloc(sizeof(char*) * (pArchive->pManifest->nEntries + 1));
     if (p_result)
     {
-        const YAAF_HashMapEntry* it, *it_end;
-        uint32_t i = 0;
-        it_end = YAAF_HashMapItEnd(&pArchive->entries);
-        for(it = YAAF_HashMapItBegin(&pArchive->entries);
-            it != it_end; YAAF_HashMapItNext(&pArchive->entries, &it), ++i)
+        const YAAF_ManifestEntry* p_manifest_entry = (const YAAF_ManifestEntry*) pArchive->pEntries;
+        uint32_t i;
+        for(i = 0; i < pArchive->pManifest->nEntries; ++i)
         {
-            const YAAF_ManifestEntry* p_manifest_entry = (const YAAF_ManifestEntry*) YAAF_HashMapItGet(it);
+            if (YAAF_ArchiveWalkEntry(pArchive, p_manifest_entry) != YAAF_SUCCESS)
+            {
+                YAAF_free((void*)p_result);
+                return NULL;
+            }
             p_result[i] = YAAF_ManifestEntryName(p_manifest_entry);
+            p_manifest_entry = YAAF_ManifestEntryNext(p_manifest_entry);
         }
         p_result[i] = NULL;
     }
@@ -150,51 +778,75 @@ const char**
 YAAF_ArchiveListDir(const YAAF_Archive* pArchive,
                     const char* dir)
 {
-    const char ** p_result = (const char**)YAAF_malloc(sizeof(char*) * (pArchive->pManifest->nEntries + 1));
-    size_t dir_len = strlen(dir);
-    if (p_result)
+    const char ** p_result = NULL;
+    const size_t dir_len = strlen(dir);
+    uint32_t i, result_i = 0, n_results = 0;
+    YAAF_Dir dir_range;
+
+    if (YAAF_ArchiveDirRange(pArchive, dir, &dir_range) != YAAF_SUCCESS)
     {
-        const YAAF_HashMapEntry* it, *it_end;
-        uint32_t result_i = 0;
-        it_end = YAAF_HashMapItEnd(&pArchive->entries);
+        return NULL;
+    }
 
-        if (strcmp(dir,".") != 0)
+    if (dir_range.prefixLen)
+    {
+        /* list all the entries in the directory range */
+        p_result = (const char**)YAAF_malloc(sizeof(char*) * (dir_range.last - dir_range.first + 1));
+        if (!p_result)
         {
-            for(it = YAAF_HashMapItBegin(&pArchive->entries);
-                it != it_end; YAAF_HashMapItNext(&pArchive->entries, &it))
-            {
-                const YAAF_ManifestEntry* p_manifest_entry = (const YAAF_ManifestEntry*) YAAF_HashMapItGet(it);
-                const char* entry_name = YAAF_ManifestEntryName(p_manifest_entry);
-
-                if (strncmp(entry_name, dir, dir_len) == 0 &&
-                        (entry_name[dir_len] == YAAF_ARCHIVE_SEP_CHR || dir[dir_len - 1] == YAAF_ARCHIVE_SEP_CHR))
-                {
-                    p_result[result_i] = entry_name;
-                    ++result_i;
-                }
-            }
+            YAAF_SetError("Failed to allocate memory for list");
+            return NULL;
         }
-        else
+
+        for(i = dir_range.first; i < dir_range.last; ++i)
         {
-            for(it = YAAF_HashMapItBegin(&pArchive->entries);
-                it != it_end; YAAF_HashMapItNext(&pArchive->entries, &it))
+            const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryAt(pArchive, i);
+            const char* entry_name;
+
+            if (!p_entry)
+            {
+                YAAF_free((void*)p_result);
+                return NULL;
+            }
+
+            /* the range is case insensitive, the directory match is not */
+            entry_name = YAAF_ManifestEntryName(p_entry);
+            if (strncmp(entry_name, dir, dir_len) == 0)
             {
-                const YAAF_ManifestEntry* p_manifest_entry = (const YAAF_ManifestEntry*) YAAF_HashMapItGet(it);
-                const char* entry_name = YAAF_ManifestEntryName(p_manifest_entry);
-
-                if (!YAAF_StrContainsChr(entry_name, YAAF_ARCHIVE_SEP_CHR))
-                {
-                    p_result[result_i] = entry_name;
-                    ++result_i;
-                }
+                p_result[result_i] = entry_name;
+                ++result_i;
             }
         }
-        p_result[result_i] = NULL;
     }
     else
     {
-        YAAF_SetError("Failed to allocate memory for list");
+        /* count the files in the root, then collect them */
+        for (i = 0; YAAF_ArchiveNextRootFile(pArchive, &i) == YAAF_SUCCESS &&
+             i < pArchive->pManifest->nEntries; ++i)
+        {
+            ++n_results;
+        }
+
+        if (i < pArchive->pManifest->nEntries)
+        {
+            return NULL;
+        }
+
+        p_result = (const char**)YAAF_malloc(sizeof(char*) * (n_results + 1));
+        if (!p_result)
+        {
+            YAAF_SetError("Failed to allocate memory for list");
+            return NULL;
+        }
+
+        for (i = 0; YAAF_ArchiveNextRootFile(pArchive, &i) == YAAF_SUCCESS &&
+             i < pArchive->pManifest->nEntries; ++i)
+        {
+            p_result[result_i] = YAAF_ManifestEntryName(YAAF_ArchiveEntryAt(pArchive, i));
+            ++result_i;
+        }
     }
+    p_result[result_i] = NULL;
     return p_result;
 }
 
@@ -203,188 +855,608 @@ YAAF_ArchiveFreeList(const char** pList)
 {
     if (pList)
     {
-        YAAF_free((void*)pList);
+        YAAF_free((void*)pList);
+    }
+}
+
+int
+YAAF_ArchiveContains(const YAAF_Archive* pArchive,
+                     const char* file)
+{
+    YAAF_ASSERT(pArchive);
+    return YAAF_ArchiveFindEntry(pArchive, file) != NULL ? YAAF_SUCCESS : YAAF_FAIL;
+}
+
+static int
+YAAF_ArchiveParseIndex(YAAF_Archive* pArchive,
+                       const size_t entriesOffset)
+{
+    const YAAF_IndexHeader* p_index;
+    size_t tables_size;
+
+    if (entriesOffset < sizeof(YAAF_IndexHeader))
+    {
+        YAAF_SetError("Lookup index out of bounds");
+        return YAAF_FAIL;
+    }
+
+    p_index = (const YAAF_IndexHeader*) YAAF_MemFileRegion(&pArchive->memFile,
+                                                           entriesOffset - sizeof(YAAF_IndexHeader),
+                                                           sizeof(YAAF_IndexHeader));
+    if (!p_index)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* validate index header */
+    if (p_index->magic != YAAF_INDEX_MAGIC)
+    {
+        YAAF_SetError("Invalid lookup index magic");
+        return YAAF_FAIL;
+    }
+
+    /* slot count must be a power of 2 and able to hold all the entries */
+    if (p_index->nSlots < pArchive->pManifest->nEntries || p_index->nSlots == 0 ||
+            (p_index->nSlots & (p_index->nSlots - 1)) != 0)
+    {
+        YAAF_SetError("Invalid lookup index size");
+        return YAAF_FAIL;
+    }
+
+    tables_size = (size_t)pArchive->pManifest->nEntries * sizeof(uint32_t) +
+            (size_t)p_index->nSlots * sizeof(YAAF_IndexSlot);
+
+    if (tables_size != p_index->indexSize ||
+            entriesOffset - sizeof(YAAF_IndexHeader) < tables_size)
+    {
+        YAAF_SetError("Lookup index out of bounds");
+        return YAAF_FAIL;
+    }
+
+    pArchive->pIndexEntries = YAAF_MemFileRegion(&pArchive->memFile,
+                                                 entriesOffset - sizeof(YAAF_IndexHeader) - tables_size,
+                                                 tables_size);
+    if (!pArchive->pIndexEntries)
+    {
+        return YAAF_FAIL;
+    }
+    pArchive->pIndexSlots = (const YAAF_IndexSlot*) YAAF_CONST_PTR_OFFSET(pArchive->pIndexEntries,
+                                                                          pArchive->pManifest->nEntries * sizeof(uint32_t));
+
+    /* check index hash */
+    if (pArchive->options.validation == YAAF_VALIDATION_FULL &&
+            p_index->indexHash != YAAF_Hash(pArchive->pIndexEntries, p_index->indexSize, 0))
+    {
+        YAAF_SetError("Lookup index corrupted");
+        return YAAF_FAIL;
+    }
+
+    pArchive->pIndex = p_index;
+    return YAAF_SUCCESS;
+}
+
+int
+YAAF_ArchiveParse(YAAF_Archive* pArchive)
+{
+    size_t manifest_offset = 0;
+    size_t entries_offset = 0;
+    const YAAF_ManifestEntry* p_manif_entry = NULL;
+    const YAAF_ManifestEntry* p_prev_entry = NULL;
+    int sorted = 1;
+    uint32_t i;
+
+    if (pArchive->memFile.size < sizeof(YAAF_Manifest))
+    {
+        YAAF_SetError("Archive too small");
+        return YAAF_FAIL;
+    }
+
+    manifest_offset = pArchive->memFile.size - sizeof(YAAF_Manifest);
+    pArchive->pManifest = ( const YAAF_Manifest*) YAAF_MemFileRegion(&pArchive->memFile, manifest_offset,
+                                                                      sizeof(YAAF_Manifest));
+    if (!pArchive->pManifest)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* Validate manifest */
+    if (pArchive->pManifest->magic != YAAF_MANIFEST_MAGIC)
+    {
+        YAAF_SetError("Invalid Manifest magic");
+        return YAAF_FAIL;
+    }
+
+    /* Check version */
+    if (YAAF_LAST_VALID_VERSION > pArchive->pManifest->versionRequired ||
+            pArchive->pManifest->versionRequired > YAAF_VERSION)
+    {
+        YAAF_SetError("Current version is not compatible with the archive");
+        return YAAF_FAIL;
+    }
+
+    /* flags are only reliable in recent archives */
+    pArchive->flags = (pArchive->pManifest->versionBuilt >= YAAF_MANIFEST_FLAGS_VERSION) ?
+                pArchive->pManifest->flags : 0;
+    pArchive->hashAlgorithm = (pArchive->flags & YAAF_ARCHIVE_FLAG_HASH_XXH64) ?
+                YAAF_HASH_XXH64 : YAAF_HASH_XXH32;
+
+    /* Go to the manifest entry start */
+    if (pArchive->pManifest->manifestEntriesSize > manifest_offset)
+    {
+        YAAF_SetError("Manifest Entry list out of bounds");
+        return YAAF_FAIL;
+    }
+    entries_offset = manifest_offset - pArchive->pManifest->manifestEntriesSize;
+    pArchive->entriesOffset = entries_offset;
+    pArchive->pEntries = YAAF_MemFileRegion(&pArchive->memFile, entries_offset,
+                                            pArchive->pManifest->manifestEntriesSize);
+    if (!pArchive->pEntries)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* check entries hash */
+    if (pArchive->options.validation == YAAF_VALIDATION_FULL &&
+            pArchive->pManifest->entriesHash != YAAF_Hash(pArchive->pEntries, pArchive->pManifest->manifestEntriesSize, 0))
+    {
+        YAAF_SetError("Manifest Entry list corrupted");
+        return YAAF_FAIL;
+    }
+
+    /* use the stored lookup index when available */
+    if (pArchive->flags & YAAF_ARCHIVE_FLAG_LOOKUP_INDEX)
+    {
+        if (YAAF_ArchiveParseIndex(pArchive, entries_offset) != YAAF_SUCCESS)
+        {
+            return YAAF_FAIL;
+        }
+    }
+    else
+    {
+        YAAF_HashMapInit(&pArchive->entries, pArchive->pManifest->nEntries);
+        pArchive->entries.caseSensitive = (pArchive->flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) != 0;
+    }
+
+    /* with the lookup index, entries are only required when looked up and
+     * are checked at that time unless they are trusted */
+    if (pArchive->pIndex && pArchive->options.validation != YAAF_VALIDATION_FULL)
+    {
+        if (pArchive->options.validation != YAAF_VALIDATION_HEADER)
+        {
+            pArchive->pValidated = (uint32_t*) YAAF_calloc(pArchive->pManifest->nEntries / 32 + 1,
+                                                           sizeof(uint32_t));
+            if (!pArchive->pValidated)
+            {
+                YAAF_SetError("Failed to allocate memory for validated entries");
+                return YAAF_FAIL;
+            }
+        }
+        return YAAF_SUCCESS;
+    }
+
+    /* without the index, keep a table of the entries in order and the
+     * offsets of the entries the index would have held */
+    if (!pArchive->pIndex && pArchive->pManifest->nEntries)
+    {
+        pArchive->pSortedEntries = (YAAF_SortedEntry*)
+                YAAF_malloc(sizeof(YAAF_SortedEntry) * pArchive->pManifest->nEntries);
+        pArchive->pEntryOffsets = (uint32_t*)
+                YAAF_malloc(sizeof(uint32_t) * pArchive->pManifest->nEntries);
+        if (!pArchive->pSortedEntries || !pArchive->pEntryOffsets)
+        {
+            YAAF_SetError("Failed to allocate memory for entry table");
+            return YAAF_FAIL;
+        }
+    }
+
+    /* Validate entries */
+    p_manif_entry = (const YAAF_ManifestEntry*) pArchive->pEntries;
+    for (i = 0; i < pArchive->pManifest->nEntries; ++i)
+    {
+        if (YAAF_ArchiveValidateEntry(pArchive, p_manif_entry) != YAAF_SUCCESS)
+        {
+            return YAAF_FAIL;
+        }
+
+        if (pArchive->pIndex)
+        {
+            /* the index entry table follows the order of the entries */
+            if (YAAF_ArchiveEntryPtr(pArchive, i) != p_manif_entry)
+            {
+                YAAF_SetError("Lookup index does not match the manifest entries");
+                return YAAF_FAIL;
+            }
+        }
+        else
+        {
+            /* register entry */
+            pArchive->pEntryOffsets[i] = (uint32_t)((const char*)p_manif_entry - (const char*)pArchive->pEntries);
+            if (YAAF_HashMapPutWithHash(&pArchive->entries,
+                                        p_manif_entry->nameHash,
+                                        YAAF_ManifestEntryName(p_manif_entry),
+                                        &pArchive->pEntryOffsets[i]) != YAAF_SUCCESS)
+            {
+                YAAF_SetError("Could not insert archive entry into lookup map");
+                return YAAF_FAIL;
+            }
+            pArchive->pSortedEntries[i].pEntry = p_manif_entry;
+            pArchive->pSortedEntries[i].id = i;
+        }
+
+        if (p_prev_entry && YAAF_ArchiveNameCompare(pArchive, YAAF_ManifestEntryName(p_prev_entry),
+                                                    YAAF_ManifestEntryName(p_manif_entry)) > 0)
+        {
+            sorted = 0;
+        }
+        p_prev_entry = p_manif_entry;
+
+        /* calculate offset for the next entry */
+        p_manif_entry = YAAF_ManifestEntryNext(p_manif_entry);
+    }
+    pArchive->entriesValidated = 1;
+
+    /* directory lookups rely on the entries being sorted, yaafcl writes them
+     * in order but other writers may not */
+    if (!sorted && YAAF_ArchiveSortEntries(pArchive) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* Everything succeeded */
+    return YAAF_SUCCESS;
+}
+
+/* Files are created in pStorage when provided, otherwise taken from the file
+ * pool of the archive if it has one */
+static YAAF_File*
+YAAF_ArchiveFileCreate(const YAAF_Archive* pArchive,
+                       const YAAF_EntryId id,
+                       void* pStorage,
+                       const size_t storageSize)
+{
+    const YAAF_ManifestEntry* pEntry = YAAF_ArchiveEntryPtr(pArchive, id);
+    YAAF_File* p_file;
+    if (pStorage)
+    {
+        p_file = YAAF_FileCreateInPlace(&pArchive->memFile, pEntry, pStorage, storageSize);
+    }
+    else if (pArchive->pFilePool)
+    {
+        p_file = YAAF_FileCreatePooled(pArchive->pFilePool, &pArchive->memFile, pEntry);
+    }
+    else
+    {
+        p_file = YAAF_FileCreate(&pArchive->memFile, pEntry);
+    }
+
+    if (p_file)
+    {
+        YAAF_FileSetReadahead(p_file, pArchive->options.readahead);
+        p_file->data.pBlockCache = pArchive->pBlockCache;
+        YAAF_ArchiveEntryVerify(pArchive, id, pEntry, &p_file->data.verify);
+    }
+    return p_file;
+}
+
+YAAF_File*
+YAAF_FileOpen(YAAF_Archive* pArchive,
+              const char* filePath)
+{
+
+    YAAF_EntryId id;
+
+    /* locate file in archive */
+    id = YAAF_ArchiveFindId(pArchive, filePath);
+    /* Open the file */
+    return  (id != YAAF_ENTRY_ID_INVALID) ? YAAF_ArchiveFileCreate(pArchive, id, NULL, 0): NULL;
+}
+
+YAAF_EntryId
+YAAF_ArchiveResolve(const YAAF_Archive* pArchive,
+                    const char* file)
+{
+    const YAAF_EntryId id = YAAF_ArchiveFindId(pArchive, file);
+    if (id == YAAF_ENTRY_ID_INVALID)
+    {
+        YAAF_SetError("File not found");
+    }
+    return id;
+}
+
+YAAF_File*
+YAAF_FileOpenById(YAAF_Archive* pArchive,
+                  const YAAF_EntryId id)
+{
+    return (YAAF_ArchiveEntryById(pArchive, id)) ? YAAF_ArchiveFileCreate(pArchive, id, NULL, 0) : NULL;
+}
+
+size_t
+YAAF_FileStorageSize(void)
+{
+    return sizeof(YAAF_File);
+}
+
+YAAF_File*
+YAAF_FileOpenInPlace(YAAF_Archive* pArchive,
+                     const char* filePath,
+                     void* pStorage,
+                     const size_t storageSize)
+{
+    YAAF_EntryId id;
+
+    if (!pStorage)
+    {
+        YAAF_SetError("[YAAF File] No storage provided");
+        return NULL;
+    }
+
+    id = YAAF_ArchiveFindId(pArchive, filePath);
+    return (id != YAAF_ENTRY_ID_INVALID) ? YAAF_ArchiveFileCreate(pArchive, id, pStorage, storageSize) : NULL;
+}
+
+static void
+YAAF_ArchiveEntryInfo(const YAAF_ManifestEntry* p_entry,
+                      YAAF_FileInfo* pInfo)
+{
+    pInfo->lastModification = YAAF_ArchiveTimeToTime(&p_entry->lastModDateTime);
+    pInfo->sizeCompressed = YAAF_ManifestEntrySizeCompressed(p_entry);
+    pInfo->sizeUncompressed = YAAF_ManifestEntrySizeUncompressed(p_entry);
+
+    if (p_entry->extraLen)
+    {
+        pInfo->extraSize = p_entry->extraLen;
+        pInfo->extra = YAAF_ManifestEntryExtra(p_entry);
+    }
+    else
+    {
+        pInfo->extraSize = 0;
+        pInfo->extra = NULL;
     }
 }
 
 int
-YAAF_ArchiveContains(const YAAF_Archive* pArchive,
-                     const char* file)
-{
-    YAAF_ASSERT(pArchive);
-    return YAAF_HashMapGet(&pArchive->entries,file) != NULL ? YAAF_SUCCESS : YAAF_FAIL;
-}
-
-int
-YAAF_ArchiveParse(YAAF_Archive* pArchive)
+YAAF_ArchiveFileInfo(YAAF_Archive* pArchive,
+                     const char* filePath,
+                     YAAF_FileInfo* pInfo)
 {
-    size_t manifest_offset = 0;
-    size_t entries_offset = 0;
-    size_t cur_offset = 0;
-    const void* tmp_ptr = NULL;
-    uint32_t i;
-
-    manifest_offset = pArchive->memFile.size - sizeof(YAAF_Manifest);
-    pArchive->pManifest = ( const YAAF_Manifest*) YAAF_PTR_OFFSET(pArchive->memFile.ptr, manifest_offset);
+    const YAAF_ManifestEntry* p_entry = NULL;
 
-    /* Validate manifest */
-    if (pArchive->pManifest->magic != YAAF_MANIFEST_MAGIC)
+    /* locate file in archive */
+    p_entry = YAAF_ArchiveFindEntry(pArchive, filePath);
+    if (!p_entry)
     {
-        YAAF_SetError("Invalid Manifest magic");
         return YAAF_FAIL;
     }
 
-    /* Check version */
-    if (YAAF_LAST_VALID_VERSION > pArchive->pManifest->versionRequired)
+    /* copy info */
+    YAAF_ArchiveEntryInfo(p_entry, pInfo);
+    return YAAF_SUCCESS;
+}
+
+int
+YAAF_ArchiveFileInfoById(YAAF_Archive* pArchive,
+                         const YAAF_EntryId id,
+                         YAAF_FileInfo* pInfo)
+{
+    const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryById(pArchive, id);
+    if (!p_entry)
     {
-        YAAF_SetError("Current version is not compatible with the archive");
         return YAAF_FAIL;
     }
 
-    /* Go to the manifest entry start */
-    entries_offset = manifest_offset - pArchive->pManifest->manifestEntriesSize;
-    tmp_ptr = (const YAAF_ManifestEntry*) YAAF_CONST_PTR_OFFSET(pArchive->memFile.ptr, entries_offset);
+    YAAF_ArchiveEntryInfo(p_entry, pInfo);
+    return YAAF_SUCCESS;
+}
 
-    /* check entries hash */
-    if (pArchive->pManifest->entriesHash != YAAF_Hash(tmp_ptr, pArchive->pManifest->manifestEntriesSize, 0))
+static int
+YAAF_ArchiveReadEntry(const YAAF_Archive* pArchive,
+                      const YAAF_EntryId id,
+                      void* pBuffer,
+                      const uint64_t size)
+{
+    const YAAF_ManifestEntry* p_entry = YAAF_ArchiveEntryPtr(pArchive, id);
+    YAAF_FileVerify verify;
+
+    if (size < YAAF_ManifestEntrySizeUncompressed(p_entry))
     {
-        YAAF_SetError("Manifest Entry list corrupted");
+        YAAF_SetError("Buffer too small for file");
         return YAAF_FAIL;
     }
 
-    YAAF_HashMapInit(&pArchive->entries, pArchive->pManifest->nEntries);
-
-    /* Validate entries */
-    for (i = 0; i < pArchive->pManifest->nEntries; ++i)
+    /* the whole file is about to be read */
+    if (pArchive->options.readahead)
     {
-        const YAAF_ManifestEntry* pManifEntry = (const YAAF_ManifestEntry*) YAAF_CONST_PTR_OFFSET(tmp_ptr, cur_offset);
-
-        /* validate entry magic */
-        if (pManifEntry->magic != YAAF_MANIFEST_ENTRY_MAGIC)
-        {
-            YAAF_SetError("Invalid Manifest Entry");
-            return YAAF_FAIL;
-        }
-
-        /* check compression */
-        if (!(pManifEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK))
-        {
-            YAAF_SetError("Unsupported compression");
-            return YAAF_FAIL;
-        }
-
-        /* register entry */
-
-        if (YAAF_HashMapPutWithHash(&pArchive->entries,
-                                    pManifEntry->nameHash,
-                                    YAAF_ManifestEntryName(pManifEntry),
-                                    pManifEntry) != YAAF_SUCCESS)
-        {
-            YAAF_SetError("Could not insert archive entry into lookup map");
-            return YAAF_FAIL;
-        }
-
-        /* calculate offset for the next entry */
-        cur_offset += sizeof(struct YAAF_ManifestEntry) + pManifEntry->nameLen +
-                pManifEntry->extraLen;
+        YAAF_MemFileAdvise(&pArchive->memFile, YAAF_ManifestEntryOffset(p_entry),
+                           sizeof(YAAF_FileHeader) + YAAF_ManifestEntrySizeCompressed(p_entry),
+                           YAAF_ADVICE_WILLNEED);
     }
-
-    /* Everything succeeded */
-    return YAAF_SUCCESS;
+    YAAF_ArchiveEntryVerify(pArchive, id, p_entry, &verify);
+    return YAAF_FileDecodeEntry(&pArchive->memFile, pArchive->pBlockCache, &verify, p_entry, pBuffer);
 }
 
-YAAF_File*
-YAAF_FileOpen(YAAF_Archive* pArchive,
-              const char* filePath)
+int
+YAAF_ArchiveReadFile(const YAAF_Archive* pArchive,
+                     const char* file,
+                     void* pBuffer,
+                     const uint64_t size)
 {
+    const YAAF_EntryId id = YAAF_ArchiveFindId(pArchive, file);
+    return (id != YAAF_ENTRY_ID_INVALID) ? YAAF_ArchiveReadEntry(pArchive, id, pBuffer, size) : YAAF_FAIL;
+}
 
-    const YAAF_ManifestEntry* p_entry = NULL;
-
-    /* locate file in archive */
-    p_entry = YAAF_HashMapGet(&pArchive->entries, filePath);
-    /* Open the file */
-    return  (p_entry) ? YAAF_FileCreate(pArchive->memFile.ptr, p_entry): NULL;
+int
+YAAF_ArchiveReadFileById(const YAAF_Archive* pArchive,
+                         const YAAF_EntryId id,
+                         void* pBuffer,
+                         const uint64_t size)
+{
+    return (YAAF_ArchiveEntryById(pArchive, id)) ? YAAF_ArchiveReadEntry(pArchive, id, pBuffer, size) : YAAF_FAIL;
 }
 
 int
-YAAF_ArchiveFileInfo(YAAF_Archive* pArchive,
-                     const char* filePath,
-                     YAAF_FileInfo* pInfo)
+YAAF_ArchiveAdvise(const YAAF_Archive* pArchive,
+                   const YAAF_Advice advice)
 {
-    const YAAF_ManifestEntry* p_entry = NULL;
+    return YAAF_MemFileAdvise(&pArchive->memFile, 0, pArchive->memFile.size, advice);
+}
 
-    /* locate file in archive */
-    p_entry = YAAF_HashMapGet(&pArchive->entries, filePath);
-    if (!p_entry)
+/* Offset of a block relative to the start of the file data, from the block
+ * offset table stored after the end of blocks marker */
+static int
+YAAF_ArchiveBlockTableGet(const YAAF_Archive* pArchive,
+                          const YAAF_ManifestEntry* pEntry,
+                          const uint64_t block,
+                          uint64_t* pOffset)
+{
+    const int is_64 = (pEntry->flags & YAAF_ENTRY_FLAG_64_BIT) != 0;
+    const size_t entry_size = (is_64) ? sizeof(uint64_t) : sizeof(uint32_t);
+    const uint64_t table_offset = YAAF_ManifestEntryOffset(pEntry) + sizeof(YAAF_FileHeader) +
+            YAAF_ManifestEntrySizeCompressed(pEntry) + sizeof(YAAF_BlockHeader);
+    uint64_t value = 0;
+    const void* ptr = NULL;
+
+    if (table_offset + (block + 1) * entry_size > pArchive->entriesOffset ||
+            YAAF_MemFileRead(&pArchive->memFile, table_offset + block * entry_size, entry_size,
+                             &value, &ptr) != YAAF_SUCCESS)
     {
+        YAAF_SetError("Block offset table out of bounds");
         return YAAF_FAIL;
     }
 
-    /* copy info */
-    pInfo->lastModification = YAAF_ArchiveTimeToTime(&p_entry->lastModDateTime);
-    pInfo->sizeCompressed = p_entry->sizeCompressed;
-    pInfo->sizeUncompressed = p_entry->sizeUncompressed;
-
-    if (p_entry->extraLen)
+    if (is_64)
     {
-        pInfo->extraSize = p_entry->extraLen;
-        pInfo->extra = YAAF_ManifestEntryExtra(p_entry);
+        uint64_t value64;
+        memcpy(&value64, ptr, sizeof(value64));
+        *pOffset = YAAF_LITTLE_E64(value64);
     }
     else
     {
-        pInfo->extraSize = 0;
-        pInfo->extra = NULL;
+        uint32_t value32;
+        memcpy(&value32, ptr, sizeof(value32));
+        *pOffset = YAAF_LITTLE_E32(value32);
     }
-
     return YAAF_SUCCESS;
 }
 
+/* pBlockBuffer receives the decompressed blocks, YAAF_BLOCK_SIZE bytes, it is
+ * not used with YAAF_CHECK_BLOCKS */
 static int
 YAAF_ArchiveCheckEntry(const YAAF_Archive* pArchive,
-                       const YAAF_ManifestEntry* pEntry)
+                       const YAAF_ManifestEntry* pEntry,
+                       const YAAF_CheckLevel level,
+                       char* pBlockBuffer)
 {
     int result = YAAF_SUCCESS;
-    uint32_t offset = pEntry->offset + sizeof(YAAF_FileHeader);
-    const void* ptr = YAAF_CONST_PTR_OFFSET(pArchive->memFile.ptr, offset);
-    uint32_t hash_block, hash_uncompressed;
+    const uint64_t data_offset = YAAF_ManifestEntryOffset(pEntry) + sizeof(YAAF_FileHeader);
+    const uint64_t size_compressed = YAAF_ManifestEntrySizeCompressed(pEntry);
+    const uint64_t n_blocks_expected = (YAAF_ManifestEntrySizeUncompressed(pEntry) + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
+    uint64_t offset = data_offset;
+    uint64_t n_blocks = 0;
+    const void* ptr = NULL;
+    uint32_t hash_block;
+    uint64_t hash_uncompressed, hash_expected;
     YAAF_HashState_t hash_state;
-    const YAAF_BlockHeader* block_header = (const YAAF_BlockHeader*)ptr;
+    YAAF_BlockHeader block_header;
     YAAF_Decompressor dc;
-    char tmp_buffer[YAAF_BLOCK_SIZE];
+    char* p_read_buffer = NULL;
+
+    /* blocks are read into memory when the archive is not mapped */
+    if (!pArchive->memFile.ptr)
+    {
+        p_read_buffer = (char*) YAAF_malloc(YAAF_BLOCK_CACHE_SIZE_WR);
+        if (!p_read_buffer)
+        {
+            YAAF_SetError("Failed to allocate memory for block");
+            return YAAF_FAIL;
+        }
+    }
 
     /* create decompressor */
     if (YAAF_DecompressorCreate(&dc, pEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK) == YAAF_FAIL)
     {
         YAAF_SetError("Failed to create decompressor");
+        if (p_read_buffer)
+        {
+            YAAF_free(p_read_buffer);
+        }
         return YAAF_FAIL;
     }
 
-    YAAF_HashStateReset(&hash_state, 0);
+    YAAF_HashStateReset(&hash_state, pArchive->hashAlgorithm, 0);
 
-    while(block_header->size != 0)
+    for (;;)
     {
-        uint32_t block_size = YAAF_BLOCK_SIZE_GET(block_header->size);
+        uint32_t block_size;
         uint32_t uncompressed_size = 0;
 
+        if (YAAF_MemFileRead(&pArchive->memFile, offset, sizeof(YAAF_BlockHeader),
+                             &block_header, &ptr) != YAAF_SUCCESS)
+        {
+            result = YAAF_FAIL;
+            break;
+        }
+        memcpy(&block_header, ptr, sizeof(YAAF_BlockHeader));
+
+        if (block_header.size == 0)
+        {
+            break;
+        }
+
+        block_size = YAAF_BLOCK_SIZE_GET(block_header.size);
+        if (block_size > YAAF_BLOCK_CACHE_SIZE_WR ||
+                offset - data_offset + sizeof(YAAF_BlockHeader) + block_size > size_compressed)
+        {
+            YAAF_SetError("Block out of bounds");
+            result = YAAF_FAIL;
+            break;
+        }
+
+        /* the offset table has to point at each block */
+        if (pEntry->flags & YAAF_ENTRY_FLAG_BLOCK_TABLE)
+        {
+            uint64_t table_offset;
+
+            if (n_blocks >= n_blocks_expected ||
+                    YAAF_ArchiveBlockTableGet(pArchive, pEntry, n_blocks, &table_offset) != YAAF_SUCCESS ||
+                    table_offset != offset - data_offset)
+            {
+                YAAF_SetError("Invalid block offset table");
+                result = YAAF_FAIL;
+                break;
+            }
+        }
+        ++n_blocks;
 
         offset += sizeof(YAAF_BlockHeader);
-        ptr = YAAF_CONST_PTR_OFFSET(pArchive->memFile.ptr, offset);
+        if (YAAF_MemFileRead(&pArchive->memFile, offset, block_size,
+                             p_read_buffer, &ptr) != YAAF_SUCCESS)
+        {
+            result = YAAF_FAIL;
+            break;
+        }
 
         /* hash block */
-        hash_block = YAAF_Hash(ptr, block_size, 0);
+        hash_block = (uint32_t)YAAF_HashEx(pArchive->hashAlgorithm, ptr, block_size, 0);
 
         /* check hash */
-        if (hash_block != block_header->hash)
+        if (hash_block != block_header.hash)
         {
             YAAF_SetError("Block hash does not match");
             result = YAAF_FAIL;
             break;
         }
 
+        /* the block check does not decompress */
+        if (level == YAAF_CHECK_BLOCKS)
+        {
+            offset += block_size;
+            continue;
+        }
+
         /* if block hash matches, check uncompressed */
-        if (YAAF_BLOCK_SIZE_COMPRESSED(block_header->size))
+        if (YAAF_BLOCK_SIZE_COMPRESSED(block_header.size))
         {
-            if (YAAF_DecompressBlock(&dc, ptr, block_size, tmp_buffer, YAAF_BLOCK_SIZE,
+            if (YAAF_DecompressBlock(&dc, ptr, block_size, pBlockBuffer, YAAF_BLOCK_SIZE,
                                      &uncompressed_size) != YAAF_COMPRESSION_OK)
             {
                 YAAF_SetError("Failed to decompress block");
@@ -393,7 +1465,7 @@ YAAF_ArchiveCheckEntry(const YAAF_Archive* pArchive,
             }
 
             /* update uncompressed hash */
-            if (YAAF_HashStateUpdate(&hash_state, tmp_buffer, uncompressed_size) != YAAF_SUCCESS)
+            if (YAAF_HashStateUpdate(&hash_state, pBlockBuffer, uncompressed_size) != YAAF_SUCCESS)
             {
                 YAAF_SetError("Failed to update uncompressed hash");
                 result = YAAF_FAIL;
@@ -411,37 +1483,257 @@ YAAF_ArchiveCheckEntry(const YAAF_Archive* pArchive,
             }
         }
 
-        /* update ptr */
+        /* next block */
         offset += block_size;
-        ptr = YAAF_CONST_PTR_OFFSET(pArchive->memFile.ptr, offset);
-        block_header = (const YAAF_BlockHeader*)ptr;
     }
 
+    /* the blocks have to add up to the sizes in the manifest */
+    if (result == YAAF_SUCCESS &&
+            (offset - data_offset != size_compressed || n_blocks != n_blocks_expected))
+    {
+        YAAF_SetError("Blocks do not match the Manifest Entry sizes");
+        result = YAAF_FAIL;
+    }
+
+    /* only XXH64 archives store the upper half of the file hash */
     hash_uncompressed = YAAF_HashStateDigest(&hash_state);
+    hash_expected = (pArchive->hashAlgorithm == YAAF_HASH_XXH64) ?
+                YAAF_ManifestEntryFileHash(pEntry) : pEntry->fileHash;
 
-    if (hash_uncompressed != pEntry->fileHash)
+    if (result == YAAF_SUCCESS && level != YAAF_CHECK_BLOCKS &&
+            hash_uncompressed != hash_expected)
     {
         YAAF_SetError("Uncompressed hash does not match");
         result = YAAF_FAIL;
     }
 
     YAAF_DecompressorDestroy(&dc);
+    if (p_read_buffer)
+    {
+        YAAF_free(p_read_buffer);
+    }
     return result;
 }
 
+/* Entries handed out to the check tasks in the order of their data */
+typedef struct
+{
+    const YAAF_Archive* pArchive;
+    const YAAF_ManifestEntry** pEntries;
+    const char** pErrors;
+    YAAF_CheckLevel level;
+    uint32_t nEntries;
+    uint32_t next;
+    YAAF_Mutex mutex;
+} YAAF_ArchiveCheckState;
+
+static int
+YAAF_ManifestEntryCompareOffsetFnc(const void* p1,
+                                   const void* p2)
+{
+    const uint64_t offset1 = YAAF_ManifestEntryOffset(*(const YAAF_ManifestEntry**)p1);
+    const uint64_t offset2 = YAAF_ManifestEntryOffset(*(const YAAF_ManifestEntry**)p2);
+    return (offset1 < offset2) ? -1 : (offset1 > offset2);
+}
+
+static void
+YAAF_ArchiveCheckTaskRun(void* pArg)
+{
+    YAAF_ArchiveCheckState* p_state = (YAAF_ArchiveCheckState*) pArg;
+    char* p_block_buffer = NULL;
+
+    /* pool threads run on the default stack, the block is kept on the heap */
+    if (p_state->level != YAAF_CHECK_BLOCKS)
+    {
+        p_block_buffer = (char*) YAAF_malloc(YAAF_BLOCK_SIZE);
+    }
+
+    for (;;)
+    {
+        uint32_t i;
+
+        YAAF_MutexLock(&p_state->mutex);
+        i = p_state->next++;
+        YAAF_MutexUnlock(&p_state->mutex);
+        if (i >= p_state->nEntries)
+        {
+            break;
+        }
+
+        if (p_state->level != YAAF_CHECK_BLOCKS && !p_block_buffer)
+        {
+            p_state->pErrors[i] = "Failed to allocate memory for block";
+        }
+        else if (YAAF_ArchiveCheckEntry(p_state->pArchive, p_state->pEntries[i], p_state->level,
+                                        p_block_buffer) != YAAF_SUCCESS)
+        {
+            p_state->pErrors[i] = (YAAF_GetError()) ? YAAF_GetError() : "Check failed";
+        }
+    }
+
+    if (p_block_buffer)
+    {
+        YAAF_free(p_block_buffer);
+    }
+}
+
 int
 YAAF_ArchiveCheck(const YAAF_Archive* pArchive)
 {
-    int result = YAAF_SUCCESS;
-    const YAAF_HashMapEntry* it, *it_end;
+    return YAAF_ArchiveCheckEx(pArchive, YAAF_CHECK_FULL, NULL, NULL, NULL);
+}
+
+int
+YAAF_ArchiveCheckEx(const YAAF_Archive* pArchive,
+                    const YAAF_CheckLevel level,
+                    YAAF_ThreadPool* pPool,
+                    YAAF_CheckCallback callback,
+                    void* pUser)
+{
+    int result = YAAF_FAIL;
+    const YAAF_ManifestEntry* p_entry = (const YAAF_ManifestEntry*) pArchive->pEntries;
+    YAAF_ArchiveCheckState state;
+    YAAF_Task* p_tasks = NULL;
+    YAAF_TaskGroup group;
+    const char* p_first_error = NULL;
+    uint32_t i, n_tasks = 0;
+
+    /* check the lookup index */
+    if (pArchive->pIndex &&
+            pArchive->pIndex->indexHash != YAAF_Hash(pArchive->pIndexEntries, pArchive->pIndex->indexSize, 0))
+    {
+        YAAF_SetError("Lookup index corrupted");
+        return YAAF_FAIL;
+    }
+
+    /* check the entries, which may not have been validated at open time */
+    if (pArchive->pManifest->entriesHash != YAAF_Hash(pArchive->pEntries, pArchive->pManifest->manifestEntriesSize, 0))
+    {
+        YAAF_SetError("Manifest Entry list corrupted");
+        return YAAF_FAIL;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.pArchive = pArchive;
+    state.level = level;
+    state.nEntries = pArchive->pManifest->nEntries;
+    if (YAAF_MutexInit(&state.mutex) != YAAF_SUCCESS)
+    {
+        YAAF_SetError("Failed to create check mutex");
+        return YAAF_FAIL;
+    }
+
+    state.pEntries = (const YAAF_ManifestEntry**) YAAF_malloc(sizeof(YAAF_ManifestEntry*) * (state.nEntries + 1));
+    state.pErrors = (const char**) YAAF_calloc(state.nEntries + 1, sizeof(char*));
+    if (!state.pEntries || !state.pErrors)
+    {
+        YAAF_SetError("Failed to allocate memory for check");
+        goto cleanup;
+    }
+
+    /* the entries are walked in the order of their data, so that the reads
+     * of the tasks follow each other through the archive */
+    for(i = 0; i < state.nEntries; ++i)
+    {
+        if (YAAF_ArchiveValidateEntry(pArchive, p_entry) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+
+        /* archives with the index are only walked when opened with full
+         * validation, the entry table is checked here for the other levels.
+         * Unsorted entries are only an error when they were not sorted when
+         * the archive was opened. */
+        if (pArchive->pIndex)
+        {
+            if (YAAF_ArchiveEntryPtr(pArchive, i) != p_entry)
+            {
+                YAAF_SetError("Lookup index does not match the manifest entries");
+                goto cleanup;
+            }
+
+            if (i && !pArchive->pSortedEntries &&
+                    YAAF_ArchiveNameCompare(pArchive, YAAF_ManifestEntryName(state.pEntries[i - 1]),
+                                             YAAF_ManifestEntryName(p_entry)) > 0)
+            {
+                YAAF_SetError("Manifest entries are not sorted");
+                goto cleanup;
+            }
+        }
+        state.pEntries[i] = p_entry;
+        p_entry = YAAF_ManifestEntryNext(p_entry);
+    }
+    qsort((void*)state.pEntries, state.nEntries, sizeof(YAAF_ManifestEntry*),
+          YAAF_ManifestEntryCompareOffsetFnc);
+
+    if (!pPool)
+    {
+        pPool = YAAF_ThreadPoolGetDefault();
+    }
+
+    if (pPool && state.nEntries > 1)
+    {
+        n_tasks = YAAF_ThreadPoolSize(pPool);
+        if (state.nEntries < n_tasks)
+        {
+            n_tasks = state.nEntries;
+        }
+        p_tasks = (YAAF_Task*) YAAF_calloc(n_tasks, sizeof(YAAF_Task));
+        if (!p_tasks)
+        {
+            YAAF_SetError("Failed to allocate memory for check");
+            goto cleanup;
+        }
+
+        group.nPending = 0;
+        for (i = 0; i < n_tasks; ++i)
+        {
+            p_tasks[i].fnc = YAAF_ArchiveCheckTaskRun;
+            p_tasks[i].pArg = &state;
+            YAAF_ThreadPoolSubmit(pPool, &group, &p_tasks[i]);
+        }
+        YAAF_ThreadPoolWait(pPool, &group);
+    }
+    else
+    {
+        YAAF_ArchiveCheckTaskRun(&state);
+    }
+
+    result = YAAF_SUCCESS;
+    for(i = 0; i < state.nEntries; ++i)
+    {
+        if (state.pErrors[i])
+        {
+            if (!p_first_error)
+            {
+                p_first_error = state.pErrors[i];
+            }
+            if (callback)
+            {
+                callback(YAAF_ManifestEntryName(state.pEntries[i]), state.pErrors[i], pUser);
+            }
+            result = YAAF_FAIL;
+        }
+    }
 
-    it_end = YAAF_HashMapItEnd(&pArchive->entries);
+    if (p_first_error)
+    {
+        YAAF_SetError(p_first_error);
+    }
 
-    for(it = YAAF_HashMapItBegin(&pArchive->entries);
-        it != it_end && result == YAAF_SUCCESS;
-        YAAF_HashMapItNext(&pArchive->entries, &it))
+cleanup:
+    YAAF_MutexDestroy(&state.mutex);
+    if (state.pEntries)
+    {
+        YAAF_free((void*)state.pEntries);
+    }
+    if (state.pErrors)
+    {
+        YAAF_free((void*)state.pErrors);
+    }
+    if (p_tasks)
     {
-        result = YAAF_ArchiveCheckEntry(pArchive, YAAF_HashMapItGet(it));
+        YAAF_free(p_tasks);
     }
     return result;
 }
@@ -451,12 +1743,67 @@ YAAF_ArchiveCheckFile(const YAAF_Archive* pArchive,
                       const char* file)
 {
     int result = YAAF_FAIL;
-    const YAAF_ManifestEntry* p_entry = YAAF_HashMapGet(&pArchive->entries, file);
+    const YAAF_ManifestEntry* p_entry = YAAF_ArchiveFindEntry(pArchive, file);
+    char* p_block_buffer;
 
     if (p_entry)
     {
-        result = YAAF_ArchiveCheckEntry(pArchive, p_entry);
+        p_block_buffer = (char*) YAAF_malloc(YAAF_BLOCK_SIZE);
+        if (!p_block_buffer)
+        {
+            YAAF_SetError("Failed to allocate memory for block");
+            return YAAF_FAIL;
+        }
+        result = YAAF_ArchiveCheckEntry(pArchive, p_entry, YAAF_CHECK_FULL, p_block_buffer);
+        YAAF_free(p_block_buffer);
     }
     return result;
 }
 
+YAAF_Dir*
+YAAF_DirOpen(const YAAF_Archive* pArchive,
+             const char* dir)
+{
+    YAAF_Dir* p_dir = (YAAF_Dir*) YAAF_malloc(sizeof(YAAF_Dir));
+    if (!p_dir)
+    {
+        YAAF_SetError("Failed to allocate memory for directory");
+        return NULL;
+    }
+
+    if (YAAF_ArchiveDirRange(pArchive, dir, p_dir) != YAAF_SUCCESS)
+    {
+        YAAF_free(p_dir);
+        return NULL;
+    }
+
+    if (p_dir->prefixLen && p_dir->first == p_dir->last)
+    {
+        YAAF_SetError("Directory not found");
+        YAAF_free(p_dir);
+        return NULL;
+    }
+    return p_dir;
+}
+
+int
+YAAF_DirContains(const YAAF_Dir* pDir,
+                 const char* file)
+{
+    YAAF_ASSERT(pDir);
+    return YAAF_ArchiveDirFindId(pDir, file) != YAAF_ENTRY_ID_INVALID ? YAAF_SUCCESS : YAAF_FAIL;
+}
+
+YAAF_File*
+YAAF_DirFileOpen(const YAAF_Dir* pDir,
+                 const char* file)
+{
+    const YAAF_EntryId id = YAAF_ArchiveDirFindId(pDir, file);
+    return (id != YAAF_ENTRY_ID_INVALID) ? YAAF_ArchiveFileCreate(pDir->pArchive, id, NULL, 0) : NULL;
+}
+
+void
+YAAF_DirClose(YAAF_Dir* pDir)
+{
+    YAAF_free(pDir);
+}
@@ -36,6 +36,9 @@
 #include "YAAF_Internal.h"
 #include "YAAF_HashMap.h"
 #include "YAAF_MemFile.h"
+#include "YAAF_BlockCache.h"
+
+struct YAAF_FilePool;
 
 /*
  * YAAF Archive layout
@@ -50,10 +53,15 @@
  *    [ Data of Block 0  ]
  *       ...
  * [ End of File 0 Blocks   ] 8 bytes - all 0
+ * [ Block Offset Table 0   ] 4 or 8 bytes per block - optional
  * [ YAAF_FileHeader N      ]
  * [ YAAF File Data N       ]
  *.....
+ * [ YAAF Index Entry Table ] 4 bytes per entry  - optional
+ * [ YAAF Index Slot Table  ] 8 bytes per slot   - optional
+ * [ YAAF Index Header      ]                    - optional
  * [ YAAF Manifest Entry 0  ]
+ * [ YAAF Entry Ext64 0     ] 64 bit entries only
  * [ YAAF File Name 0       ]
  * [ YAAF File Extra 0      ]
  * ...
@@ -62,12 +70,48 @@
  * [ YAAF File Extra N      ]
  *
  * [ YAAF Manifest          ]
+ *
+ * The block offset table is present when the manifest entry has the
+ * YAAF_ENTRY_FLAG_BLOCK_TABLE flag set. It holds the offset of each block
+ * header relative to the end of the YAAF_FileHeader, allowing seeks to jump
+ * straight to the requested block. The offsets are 8 bytes wide for 64 bit
+ * entries.
+ *
+ * 64 bit archives (YAAF_ARCHIVE_FLAG_64_BIT) store entries with the
+ * YAAF_ENTRY_FLAG_64_BIT flag set. These entries are followed by a
+ * YAAF_ManifestEntryExt64 holding the upper 32 bits of the offset and sizes.
+ *
+ * Archives with YAAF_ARCHIVE_FLAG_HASH_XXH64 set hash blocks and files with
+ * XXH64 instead of XXH32. The block headers store the lower 32 bits of the
+ * hash and the upper 32 bits of the file hash are kept in the
+ * YAAF_ManifestEntryExt64, which is why these archives are always 64 bit.
+ *
+ * The lookup index is present when YAAF_ARCHIVE_FLAG_LOOKUP_INDEX is set and
+ * is located right before the manifest entries so that older versions can
+ * still find the manifest entries. The entry table holds the offset of each
+ * manifest entry relative to the first manifest entry. The slot table is an
+ * open addressing hash table (linear probing, power of 2 size) mapping the
+ * name hash of an entry to its position in the entry table.
+ *
+ * The name hash of the manifest entries and the lookup index is
+ * YAAF_NameHash() when YAAF_ARCHIVE_FLAG_NAME_HASH_V2 is set and
+ * YAAF_OnceAtATimeHashNoCase() otherwise.
+ *
+ * Archives with YAAF_ARCHIVE_FLAG_CASE_SENSITIVE set compare names byte for
+ * byte and sort them with strcmp(). Their name hash is YAAF_NameHashExact()
+ * when YAAF_ARCHIVE_FLAG_NAME_HASH_V2 is set.
  */
 
 #define YAAF_MANIFEST_MAGIC (0x9fb18cbf)
 #define YAAF_MANIFEST_ENTRY_MAGIC (0x137647f6)
 #define YAAF_FILE_HEADER_MAGIC (0xa0116f80)
-#define YAAF_ARCHIVE_FILE_NOT_FOUND 0xFFFFFFFF
+#define YAAF_INDEX_MAGIC (0x5e1d3a71)
+#define YAAF_INDEX_SLOT_EMPTY 0xFFFFFFFF
+
+/* Archives built before this version did not initialize the manifest flags */
+#define YAAF_MANIFEST_FLAGS_VERSION YAAF_VERSION_MK(1,2,0)
+/* First version able to read YAAF_ARCHIVE_FLAG_NAME_HASH_V2 archives */
+#define YAAF_NAME_HASH_V2_VERSION YAAF_VERSION_MK(1,3,0)
 
 
 /* YAAF Entry flags */
@@ -75,7 +119,19 @@
 enum
 {
     YAAF_ARCHIVE_FLAG_32_BIT = 1 << 0,
-    YAAF_ARCHIVE_FLAG_64_BIT = 1 << 1
+    YAAF_ARCHIVE_FLAG_64_BIT = 1 << 1,
+    YAAF_ARCHIVE_FLAG_LOOKUP_INDEX = 1 << 2,
+    YAAF_ARCHIVE_FLAG_HASH_XXH64 = 1 << 3,
+    YAAF_ARCHIVE_FLAG_NAME_HASH_V2 = 1 << 4,
+    YAAF_ARCHIVE_FLAG_CASE_SENSITIVE = 1 << 5
+};
+
+/* YAAF Manifest Entry flags, the lower 8 bits hold the compression */
+
+enum
+{
+    YAAF_ENTRY_FLAG_BLOCK_TABLE = 1 << 8,
+    YAAF_ENTRY_FLAG_64_BIT = 1 << 9
 };
 
 
@@ -109,17 +165,116 @@ typedef struct YAAF_ManifestEntry
   uint16_t unused;
 } YAAF_ManifestEntry;
 
+typedef struct YAAF_ManifestEntryExt64
+{
+  uint32_t offsetHigh;
+  uint32_t sizeCompressedHigh;
+  uint32_t sizeUncompressedHigh;
+  uint32_t fileHashHigh;
+} YAAF_ManifestEntryExt64;
+
 typedef struct YAAF_FileHeader
 {
   uint32_t magic;
 } YAAF_FileHeader;
+
+typedef struct YAAF_IndexHeader
+{
+  uint32_t magic;
+  uint32_t nSlots;
+  uint32_t indexSize;
+  uint32_t indexHash;
+} YAAF_IndexHeader;
+
+typedef struct YAAF_IndexSlot
+{
+  uint32_t nameHash;
+  uint32_t entry;
+} YAAF_IndexSlot;
 #pragma pack(pop)
 
+YAAF_FORCE_INLINE const YAAF_ManifestEntryExt64*
+YAAF_ManifestEntryExt(const YAAF_ManifestEntry* pEntry)
+{
+    return (pEntry->flags & YAAF_ENTRY_FLAG_64_BIT) ?
+                (const YAAF_ManifestEntryExt64*)(pEntry + 1) : NULL;
+}
+
+YAAF_FORCE_INLINE size_t
+YAAF_ManifestEntryHeaderSize(const YAAF_ManifestEntry* pEntry)
+{
+    return sizeof(struct YAAF_ManifestEntry) +
+            ((pEntry->flags & YAAF_ENTRY_FLAG_64_BIT) ? sizeof(YAAF_ManifestEntryExt64) : 0);
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_ManifestEntryOffset(const YAAF_ManifestEntry* pEntry)
+{
+    const YAAF_ManifestEntryExt64* p_ext = YAAF_ManifestEntryExt(pEntry);
+    return (p_ext) ? ((uint64_t)p_ext->offsetHigh << 32) | pEntry->offset : pEntry->offset;
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_ManifestEntrySizeCompressed(const YAAF_ManifestEntry* pEntry)
+{
+    const YAAF_ManifestEntryExt64* p_ext = YAAF_ManifestEntryExt(pEntry);
+    return (p_ext) ? ((uint64_t)p_ext->sizeCompressedHigh << 32) | pEntry->sizeCompressed :
+                     pEntry->sizeCompressed;
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_ManifestEntrySizeUncompressed(const YAAF_ManifestEntry* pEntry)
+{
+    const YAAF_ManifestEntryExt64* p_ext = YAAF_ManifestEntryExt(pEntry);
+    return (p_ext) ? ((uint64_t)p_ext->sizeUncompressedHigh << 32) | pEntry->sizeUncompressed :
+                     pEntry->sizeUncompressed;
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_ManifestEntryFileHash(const YAAF_ManifestEntry* pEntry)
+{
+    const YAAF_ManifestEntryExt64* p_ext = YAAF_ManifestEntryExt(pEntry);
+    return (p_ext) ? ((uint64_t)p_ext->fileHashHigh << 32) | pEntry->fileHash :
+                     pEntry->fileHash;
+}
+
+/* An entry of the table of entries sorted by name, with its id */
+typedef struct YAAF_SortedEntry
+{
+  const YAAF_ManifestEntry* pEntry;
+  YAAF_EntryId id;
+} YAAF_SortedEntry;
+
 struct YAAF_Archive
 {
   YAAF_MemFile memFile;
   const YAAF_Manifest* pManifest;
+  const void* pEntries;
+  uint64_t entriesOffset;
+  uint32_t flags;
+  int hashAlgorithm;
+  const YAAF_IndexHeader* pIndex;
+  const void* pIndexEntries; /* offset of each entry, indexed by YAAF_EntryId, unaligned */
+  uint32_t* pEntryOffsets; /* offset of each entry of archives without the index */
+  const YAAF_IndexSlot* pIndexSlots;
   YAAF_HashMap entries;
+  YAAF_ArchiveOptions options;
+  int entriesValidated;
+  uint32_t* pValidated; /* bitmap of the entries validated on lookup */
+  YAAF_SortedEntry* pSortedEntries;
+  YAAF_BlockCache* pBlockCache;
+  struct YAAF_FilePool* pFilePool;
+  uint32_t* pVerified; /* bitmap of the blocks verified on read */
+  uint64_t* pVerifyFirst; /* bit of the first block of each entry, indexed by YAAF_EntryId */
+};
+
+/* A directory is the range of sorted entries sharing the directory prefix */
+struct YAAF_Dir
+{
+  const YAAF_Archive* pArchive;
+  uint32_t first;
+  uint32_t last;
+  uint32_t prefixLen;
 };
 
 
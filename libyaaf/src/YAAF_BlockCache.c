@@ -0,0 +1,316 @@
+/*
+ * YAAF - Yet Another Archive Format
+ * Copyright (C) 2014-2015, Leander Beernaert
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
+ */
+#include "YAAF_BlockCache.h"
+#include "YAAF_Internal.h"
+#include "YAAF_Thread.h"
+
+typedef struct YAAF_BlockCacheShard
+{
+    YAAF_Mutex mutex;
+    YAAF_BlockCacheEntry** pBuckets;
+    uint32_t nBuckets;
+    /* most recently used first */
+    YAAF_BlockCacheEntry* pHead;
+    YAAF_BlockCacheEntry* pTail;
+    uint64_t used;
+    uint64_t budget;
+} YAAF_BlockCacheShard;
+
+struct YAAF_BlockCache
+{
+    YAAF_BlockCacheShard shards[YAAF_BLOCK_CACHE_SHARDS];
+};
+
+/* Block offsets are multiples of small values. A multiply alone leaves the
+ * low bits used by the buckets as weak as the key, the MurmurHash3 finalizer
+ * spreads every key bit over both the low bits of the bucket and the high
+ * bits of the shard */
+static uint64_t
+YAAF_BlockCacheHash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static YAAF_BlockCacheShard*
+YAAF_BlockCacheShardGet(YAAF_BlockCache* pCache,
+                        const uint64_t hash)
+{
+    return &pCache->shards[(hash >> 60) % YAAF_BLOCK_CACHE_SHARDS];
+}
+
+static uint64_t
+YAAF_BlockCacheEntrySize(const YAAF_BlockCacheEntry* pEntry)
+{
+    return sizeof(YAAF_BlockCacheEntry) + pEntry->size;
+}
+
+YAAF_BlockCache*
+YAAF_BlockCacheCreate(const uint64_t budget)
+{
+    YAAF_BlockCache* p_cache = (YAAF_BlockCache*) YAAF_malloc(sizeof(YAAF_BlockCache));
+    const uint64_t shard_budget = budget / YAAF_BLOCK_CACHE_SHARDS;
+    uint32_t n_buckets = 16;
+    uint32_t i;
+
+    if (!p_cache)
+    {
+        YAAF_SetError("[YAAF BlockCache] Failed to allocate memory for cache");
+        return NULL;
+    }
+    memset(p_cache, 0, sizeof(YAAF_BlockCache));
+
+    /* about two buckets for every block that fits in the budget */
+    while ((uint64_t)n_buckets < (shard_budget / YAAF_BLOCK_SIZE) * 2 && n_buckets < (1u << 20))
+    {
+        n_buckets <<= 1;
+    }
+
+    for (i = 0; i < YAAF_BLOCK_CACHE_SHARDS; ++i)
+    {
+        YAAF_BlockCacheShard* p_shard = &p_cache->shards[i];
+        p_shard->budget = shard_budget;
+        p_shard->nBuckets = n_buckets;
+        p_shard->pBuckets = (YAAF_BlockCacheEntry**) YAAF_malloc(n_buckets * sizeof(YAAF_BlockCacheEntry*));
+        if (!p_shard->pBuckets || YAAF_MutexInit(&p_shard->mutex) != YAAF_SUCCESS)
+        {
+            YAAF_SetError("[YAAF BlockCache] Failed to create cache shard");
+            if (p_shard->pBuckets)
+            {
+                YAAF_free(p_shard->pBuckets);
+                p_shard->pBuckets = NULL;
+            }
+            YAAF_BlockCacheDestroy(p_cache);
+            return NULL;
+        }
+        memset(p_shard->pBuckets, 0, n_buckets * sizeof(YAAF_BlockCacheEntry*));
+    }
+    return p_cache;
+}
+
+void
+YAAF_BlockCacheDestroy(YAAF_BlockCache* pCache)
+{
+    uint32_t i;
+
+    for (i = 0; i < YAAF_BLOCK_CACHE_SHARDS; ++i)
+    {
+        YAAF_BlockCacheShard* p_shard = &pCache->shards[i];
+        YAAF_BlockCacheEntry* p_entry = p_shard->pHead;
+
+        /* shards after a failed creation were never initialized */
+        if (!p_shard->pBuckets)
+        {
+            break;
+        }
+
+        while (p_entry)
+        {
+            YAAF_BlockCacheEntry* p_next = p_entry->pNext;
+            YAAF_free(p_entry);
+            p_entry = p_next;
+        }
+        YAAF_free(p_shard->pBuckets);
+        YAAF_MutexDestroy(&p_shard->mutex);
+    }
+    YAAF_free(pCache);
+}
+
+static void
+YAAF_BlockCacheUnlinkLRU(YAAF_BlockCacheShard* pShard,
+                         YAAF_BlockCacheEntry* pEntry)
+{
+    if (pEntry->pPrev)
+    {
+        pEntry->pPrev->pNext = pEntry->pNext;
+    }
+    else
+    {
+        pShard->pHead = pEntry->pNext;
+    }
+
+    if (pEntry->pNext)
+    {
+        pEntry->pNext->pPrev = pEntry->pPrev;
+    }
+    else
+    {
+        pShard->pTail = pEntry->pPrev;
+    }
+    pEntry->pPrev = NULL;
+    pEntry->pNext = NULL;
+}
+
+static void
+YAAF_BlockCacheLinkLRU(YAAF_BlockCacheShard* pShard,
+                       YAAF_BlockCacheEntry* pEntry)
+{
+    pEntry->pPrev = NULL;
+    pEntry->pNext = pShard->pHead;
+    if (pShard->pHead)
+    {
+        pShard->pHead->pPrev = pEntry;
+    }
+    else
+    {
+        pShard->pTail = pEntry;
+    }
+    pShard->pHead = pEntry;
+}
+
+/* Remove the least recently used entries until the shard fits its budget.
+ * Entries still referenced are freed on their last release. */
+static void
+YAAF_BlockCacheEvict(YAAF_BlockCacheShard* pShard)
+{
+    while (pShard->used > pShard->budget && pShard->pTail)
+    {
+        YAAF_BlockCacheEntry* p_entry = pShard->pTail;
+        YAAF_BlockCacheEntry** pp_link = &pShard->pBuckets[YAAF_BlockCacheHash(p_entry->key) & (pShard->nBuckets - 1)];
+
+        while (*pp_link != p_entry)
+        {
+            pp_link = &(*pp_link)->pHashNext;
+        }
+        *pp_link = p_entry->pHashNext;
+
+        YAAF_BlockCacheUnlinkLRU(pShard, p_entry);
+        pShard->used -= YAAF_BlockCacheEntrySize(p_entry);
+        p_entry->cached = 0;
+        if (p_entry->nRefs == 0)
+        {
+            YAAF_free(p_entry);
+        }
+    }
+}
+
+const YAAF_BlockCacheEntry*
+YAAF_BlockCacheFind(YAAF_BlockCache* pCache,
+                    const uint64_t key)
+{
+    const uint64_t hash = YAAF_BlockCacheHash(key);
+    YAAF_BlockCacheShard* p_shard = YAAF_BlockCacheShardGet(pCache, hash);
+    YAAF_BlockCacheEntry* p_entry;
+
+    YAAF_MutexLock(&p_shard->mutex);
+    p_entry = p_shard->pBuckets[hash & (p_shard->nBuckets - 1)];
+    while (p_entry && p_entry->key != key)
+    {
+        p_entry = p_entry->pHashNext;
+    }
+
+    if (p_entry)
+    {
+        ++p_entry->nRefs;
+        if (p_shard->pHead != p_entry)
+        {
+            YAAF_BlockCacheUnlinkLRU(p_shard, p_entry);
+            YAAF_BlockCacheLinkLRU(p_shard, p_entry);
+        }
+    }
+    YAAF_MutexUnlock(&p_shard->mutex);
+    return p_entry;
+}
+
+const YAAF_BlockCacheEntry*
+YAAF_BlockCacheInsert(YAAF_BlockCache* pCache,
+                      const uint64_t key,
+                      const void* pData,
+                      const uint32_t size,
+                      const uint32_t blockSize)
+{
+    const uint64_t hash = YAAF_BlockCacheHash(key);
+    YAAF_BlockCacheShard* p_shard = YAAF_BlockCacheShardGet(pCache, hash);
+    YAAF_BlockCacheEntry* p_new;
+    YAAF_BlockCacheEntry* p_entry;
+
+    /* copy the data before taking the lock */
+    p_new = (YAAF_BlockCacheEntry*) YAAF_malloc(sizeof(YAAF_BlockCacheEntry) + size);
+    if (!p_new)
+    {
+        return NULL;
+    }
+    memset(p_new, 0, sizeof(YAAF_BlockCacheEntry));
+    p_new->key = key;
+    p_new->size = size;
+    p_new->blockSize = blockSize;
+    p_new->nRefs = 1;
+    p_new->cached = 1;
+    memcpy(p_new + 1, pData, size);
+
+    YAAF_MutexLock(&p_shard->mutex);
+    p_entry = p_shard->pBuckets[hash & (p_shard->nBuckets - 1)];
+    while (p_entry && p_entry->key != key)
+    {
+        p_entry = p_entry->pHashNext;
+    }
+
+    if (p_entry)
+    {
+        /* decoded by another thread in the meantime */
+        ++p_entry->nRefs;
+        YAAF_MutexUnlock(&p_shard->mutex);
+        YAAF_free(p_new);
+        return p_entry;
+    }
+
+    p_new->pHashNext = p_shard->pBuckets[hash & (p_shard->nBuckets - 1)];
+    p_shard->pBuckets[hash & (p_shard->nBuckets - 1)] = p_new;
+    YAAF_BlockCacheLinkLRU(p_shard, p_new);
+    p_shard->used += YAAF_BlockCacheEntrySize(p_new);
+    YAAF_BlockCacheEvict(p_shard);
+    YAAF_MutexUnlock(&p_shard->mutex);
+    return p_new;
+}
+
+void
+YAAF_BlockCacheRelease(YAAF_BlockCache* pCache,
+                       const YAAF_BlockCacheEntry* pEntry)
+{
+    YAAF_BlockCacheShard* p_shard = YAAF_BlockCacheShardGet(pCache, YAAF_BlockCacheHash(pEntry->key));
+    YAAF_BlockCacheEntry* p_entry = (YAAF_BlockCacheEntry*) pEntry;
+    int free_entry;
+
+    YAAF_MutexLock(&p_shard->mutex);
+    --p_entry->nRefs;
+    free_entry = (p_entry->nRefs == 0 && !p_entry->cached);
+    YAAF_MutexUnlock(&p_shard->mutex);
+
+    if (free_entry)
+    {
+        YAAF_free(p_entry);
+    }
+}
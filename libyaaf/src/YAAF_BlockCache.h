@@ -0,0 +1,82 @@
+/*
+ * YAAF - Yet Another Archive Format
+ * Copyright (C) 2014-2015, Leander Beernaert
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
+ */
+#ifndef __YAAF_BLOCKCACHE_H__
+#define __YAAF_BLOCKCACHE_H__
+
+#include "YAAF.h"
+
+/* Number of independently locked shards of the cache */
+#define YAAF_BLOCK_CACHE_SHARDS 16
+
+/* A decoded block, the data follows the entry. Entries are immutable once
+ * inserted and stay valid while referenced. */
+typedef struct YAAF_BlockCacheEntry
+{
+    struct YAAF_BlockCacheEntry* pHashNext;
+    struct YAAF_BlockCacheEntry* pPrev;
+    struct YAAF_BlockCacheEntry* pNext;
+    uint64_t key;
+    uint32_t size;
+    uint32_t blockSize;
+    uint32_t nRefs;
+    int cached;
+} YAAF_BlockCacheEntry;
+
+#define YAAF_BlockCacheEntryData(pEntry) ((const char*)((pEntry) + 1))
+
+struct YAAF_BlockCache;
+typedef struct YAAF_BlockCache YAAF_BlockCache;
+
+/* Create a cache holding up to budget bytes of decoded blocks */
+YAAF_BlockCache* YAAF_BlockCacheCreate(const uint64_t budget);
+
+/* All entries need to be released before destroying the cache */
+void YAAF_BlockCacheDestroy(YAAF_BlockCache* pCache);
+
+/* Get a referenced entry for the block at key, the offset of the block in
+ * the archive. Returns NULL if the block is not cached. */
+const YAAF_BlockCacheEntry* YAAF_BlockCacheFind(YAAF_BlockCache* pCache,
+                                                const uint64_t key);
+
+/* Add a copy of a decoded block, blockSize is the size of the block in the
+ * archive including its header. Returns the referenced entry for key, which
+ * may have been added by another thread, or NULL on failure. */
+const YAAF_BlockCacheEntry* YAAF_BlockCacheInsert(YAAF_BlockCache* pCache,
+                                                  const uint64_t key,
+                                                  const void* pData,
+                                                  const uint32_t size,
+                                                  const uint32_t blockSize);
+
+void YAAF_BlockCacheRelease(YAAF_BlockCache* pCache,
+                            const YAAF_BlockCacheEntry* pEntry);
+
+#endif
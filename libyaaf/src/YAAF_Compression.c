@@ -31,6 +31,7 @@
  */
 
 #include "YAAF_Compression.h"
+#include "YAAF_Hash.h"
 #include "YAAF_Internal.h"
 #include "YAAF_Compression_lz4.h"
 
@@ -38,6 +39,7 @@ int
 YAAF_CompressorCreate(YAAF_Compressor* pCompressor,
                       const int type)
 {
+    pCompressor->hashAlgorithm = YAAF_HASH_XXH32;
     switch(type)
     {
     case YAAF_COMPRESSION_LZ4_BIT:
@@ -93,8 +95,14 @@ YAAF_CompressBlock(YAAF_Compressor* pCompressor,
                    const uint32_t output_size,
                    YAAF_BlockHeader *compresResult)
 {
-    return pCompressor->compress(pCompressor->state, input, input_size,
-                                 output, output_size, compresResult);
+    const int result = pCompressor->compress(pCompressor->state, input, input_size,
+                                             output, output_size, compresResult);
+    if (result == YAAF_COMPRESSION_OK)
+    {
+        compresResult->hash = (uint32_t)YAAF_HashEx(pCompressor->hashAlgorithm, output,
+                                                     YAAF_BLOCK_SIZE_GET(compresResult->size), 0);
+    }
+    return result;
 }
 
 int
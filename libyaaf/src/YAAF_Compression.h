@@ -53,9 +53,12 @@ typedef struct
 }YAAF_BlockHeader;
 
 
+/* The compress function fills in the block size, YAAF_CompressBlock() the
+ * hash of the stored block with hashAlgorithm */
 typedef struct
 {
     void* state;
+    int hashAlgorithm;
     int (*compress)(void*,
                     const void*,
                     const uint32_t,
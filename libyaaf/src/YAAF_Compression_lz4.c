@@ -32,7 +32,6 @@
 #include "YAAF_Compression_lz4.h"
 #include "YAAF.h"
 #include "YAAF_Internal.h"
-#include "YAAF_Hash.h"
 #if defined(YAAF_USE_COMPRESSION_LZ4)
 
 #include "lz4.h"
@@ -70,14 +69,12 @@ static int YAAF_CompressLZ4(void* pState,
         /* no compression */
         memcpy(outbuffer, inbuffer, insize);
         pCompressResult->size = YAAF_BLOCK_SIZE_BUILD(0, insize);
-        pCompressResult->hash = YAAF_Hash(inbuffer, insize, 0);
         return YAAF_COMPRESSION_OK;
     }
     else
     {
 
         pCompressResult->size = YAAF_BLOCK_SIZE_BUILD(1, bytes_compressed);
-        pCompressResult->hash = YAAF_Hash(outbuffer, bytes_compressed, 0);
         return YAAF_COMPRESSION_OK;
     }
 }
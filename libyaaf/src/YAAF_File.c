@@ -34,82 +34,477 @@
 #include "YAAF_Archive.h"
 #include "YAAF_Internal.h"
 #include "YAAF_Archive.h"
+#include "YAAF_Thread.h"
+#include "YAAF_MemFile.h"
+#include "YAAF_BlockCache.h"
+#include "YAAF_Hash.h"
+
+/* Recycles the destroyed files of an archive together with their buffers */
+struct YAAF_FilePool
+{
+    YAAF_Mutex mutex;
+    YAAF_File* pFree;
+    uint32_t nFree;
+    uint32_t maxFree;
+};
+
+/* Set up pFile for the entry. The read buffer of a recycled file is kept, the
+ * storage and pool are set by the caller. */
+static int
+YAAF_FileInit(YAAF_File* pFile,
+              const struct YAAF_MemFile* pMemFile,
+              const struct YAAF_ManifestEntry * pManifestEntry)
+{
+    const YAAF_FileHeader* p_hdr = NULL;
+    YAAF_FileHeader hdr;
+    const uint64_t offset = YAAF_ManifestEntryOffset(pManifestEntry);
+    char* p_read_buffer = pFile->pReadBuffer;
+    const size_t read_buffer_size = pFile->readBufferSize;
+    char* p_cache_block = pFile->pCacheBlock;
+    const uint32_t cache_block_size = pFile->cacheBlockSize;
+
+    memset(pFile, 0, sizeof(YAAF_File));
+    pFile->pReadBuffer = p_read_buffer;
+    pFile->readBufferSize = read_buffer_size;
+    pFile->pCacheBlock = p_cache_block;
+    pFile->cacheBlockSize = cache_block_size;
+
+    /* Read file header */
+    if (YAAF_MemFileRead(pMemFile, offset, sizeof(YAAF_FileHeader), &hdr,
+                         (const void**)&p_hdr) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    if (YAAF_LITTLE_E32(p_hdr->magic) != YAAF_FILE_HEADER_MAGIC)
+    {
+        YAAF_SetError("[YAAF_FileCreate] File header magic mismatch");
+        return YAAF_FAIL;
+    }
+
+    pFile->data.pMemFile = pMemFile;
+    pFile->data.offset = offset + sizeof(YAAF_FileHeader);
+    pFile->data.ptr = (pMemFile->ptr) ? YAAF_CONST_PTR_OFFSET(pMemFile->ptr, pFile->data.offset) : NULL;
+    pFile->nBytesUncompressed = YAAF_ManifestEntrySizeUncompressed(pManifestEntry);
+    pFile->nBytesCompressed = YAAF_ManifestEntrySizeCompressed(pManifestEntry);
+    pFile->nBytesRead  = 0;
+
+    /* blocks are read into memory when the archive is not mapped, the buffer
+     * of a recycled file is kept if large enough */
+    if (!pFile->data.ptr)
+    {
+        const size_t read_size = YAAF_FILE_READ_BUFFER_SIZE_FOR(pFile->nBytesCompressed);
+        if (pFile->readBufferSize < read_size)
+        {
+            if (pFile->pReadBuffer)
+            {
+                YAAF_free(pFile->pReadBuffer);
+            }
+            pFile->readBufferSize = 0;
+            pFile->pReadBuffer = (char*) YAAF_malloc(read_size);
+            if (!pFile->pReadBuffer)
+            {
+                YAAF_SetError("[YAAF_FileCreate] Failed to allocate memory");
+                return YAAF_FAIL;
+            }
+            pFile->readBufferSize = read_size;
+        }
+    }
+
+    /* block offset table is stored after the end of blocks marker */
+    if (pManifestEntry->flags & YAAF_ENTRY_FLAG_BLOCK_TABLE)
+    {
+        size_t table_size;
+
+        pFile->nBlocks = (pFile->nBytesUncompressed + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
+        pFile->blockTable64 = (pManifestEntry->flags & YAAF_ENTRY_FLAG_64_BIT) != 0;
+        table_size = (size_t)pFile->nBlocks * ((pFile->blockTable64) ? sizeof(uint64_t) : sizeof(uint32_t));
+
+        if (!pFile->data.ptr)
+        {
+            pFile->pBlockTableBuffer = YAAF_malloc(table_size);
+            if (!pFile->pBlockTableBuffer)
+            {
+                YAAF_SetError("[YAAF_FileCreate] Failed to allocate memory");
+                return YAAF_FAIL;
+            }
+        }
+
+        if (YAAF_MemFileRead(pMemFile, pFile->data.offset + pFile->nBytesCompressed + sizeof(YAAF_BlockHeader),
+                             table_size, pFile->pBlockTableBuffer, &pFile->pBlockTable) != YAAF_SUCCESS)
+        {
+            goto error;
+        }
+    }
+
+    /* create decompressor */
+    pFile->compression = pManifestEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK;
+    if (YAAF_DecompressorCreate(&pFile->decompressor, pFile->compression)
+            != YAAF_SUCCESS)
+    {
+        goto error;
+    }
+    return YAAF_SUCCESS;
+
+error:
+    if (pFile->pBlockTableBuffer)
+    {
+        YAAF_free(pFile->pBlockTableBuffer);
+        pFile->pBlockTableBuffer = NULL;
+    }
+    return YAAF_FAIL;
+}
+
+/* Release everything but the storage and the read buffer */
+static void
+YAAF_FileFinish(YAAF_File* pFile)
+{
+    YAAF_MemFileRelease(pFile->data.pMemFile, &pFile->pWindow);
+    if (pFile->pCacheEntry)
+    {
+        YAAF_BlockCacheRelease(pFile->data.pBlockCache, pFile->pCacheEntry);
+        pFile->pCacheEntry = NULL;
+    }
+    YAAF_DecompressorDestroy(&pFile->decompressor);
+    if (pFile->pBlockTableBuffer)
+    {
+        YAAF_free(pFile->pBlockTableBuffer);
+        pFile->pBlockTableBuffer = NULL;
+    }
+}
+
+static void
+YAAF_FileFreeBuffers(YAAF_File* pFile)
+{
+    if (pFile->pReadBuffer)
+    {
+        YAAF_free(pFile->pReadBuffer);
+    }
+    if (pFile->pCacheBlock)
+    {
+        YAAF_free(pFile->pCacheBlock);
+    }
+}
+
+static void
+YAAF_FileFree(YAAF_File* pFile)
+{
+    YAAF_FileFreeBuffers(pFile);
+    YAAF_free(pFile);
+}
 
 YAAF_File*
-YAAF_FileCreate(const void *ptr,
+YAAF_FileCreate(const struct YAAF_MemFile* pMemFile,
                 const struct YAAF_ManifestEntry * pManifestEntry)
 {
+    YAAF_File* p_result;
 
-    YAAF_File* p_result = NULL;
-    const char* chr_ptr = NULL;
-    const YAAF_FileHeader* p_hdr = NULL;
+    if (!pMemFile)
+    {
+        return NULL;
+    }
+
+    p_result = (YAAF_File*)YAAF_malloc(sizeof(YAAF_File));
+    if (!p_result)
+    {
+        YAAF_SetError("[YAAF_FileCreate] Failed to allocate memory");
+        return NULL;
+    }
 
-    if (!ptr)
+    p_result->pReadBuffer = NULL;
+    p_result->readBufferSize = 0;
+    p_result->pCacheBlock = NULL;
+    p_result->cacheBlockSize = 0;
+    if (YAAF_FileInit(p_result, pMemFile, pManifestEntry) != YAAF_SUCCESS)
     {
+        YAAF_FileFree(p_result);
         return NULL;
     }
+    p_result->storage = YAAF_FILE_STORAGE_HEAP;
+    return p_result;
+}
+
+YAAF_File*
+YAAF_FileCreateInPlace(const struct YAAF_MemFile* pMemFile,
+                       const struct YAAF_ManifestEntry * pManifestEntry,
+                       void* pStorage,
+                       const size_t storageSize)
+{
+    YAAF_File* p_result = (YAAF_File*) pStorage;
 
-    chr_ptr = (const char*) ptr;
-    chr_ptr += pManifestEntry->offset;
+    if (!pMemFile || !pStorage || storageSize < sizeof(YAAF_File) ||
+            ((uintptr_t)pStorage % sizeof(uint64_t)) != 0)
+    {
+        YAAF_SetError("[YAAF_FileCreate] Storage is too small or not aligned");
+        return NULL;
+    }
 
-    /* Read file header */
+    p_result->pReadBuffer = NULL;
+    p_result->readBufferSize = 0;
+    p_result->pCacheBlock = NULL;
+    p_result->cacheBlockSize = 0;
+    if (YAAF_FileInit(p_result, pMemFile, pManifestEntry) != YAAF_SUCCESS)
+    {
+        YAAF_FileFreeBuffers(p_result);
+        return NULL;
+    }
+    p_result->storage = YAAF_FILE_STORAGE_CALLER;
+    return p_result;
+}
 
-    p_hdr = (const YAAF_FileHeader*)chr_ptr;
+YAAF_FilePool*
+YAAF_FilePoolCreate(const uint32_t maxFree)
+{
+    YAAF_FilePool* p_pool = (YAAF_FilePool*) YAAF_malloc(sizeof(YAAF_FilePool));
+    if (!p_pool)
+    {
+        YAAF_SetError("[YAAF File] Failed to allocate memory for file pool");
+        return NULL;
+    }
 
-    if (YAAF_LITTLE_E32(p_hdr->magic) != YAAF_FILE_HEADER_MAGIC)
+    if (YAAF_MutexInit(&p_pool->mutex) != YAAF_SUCCESS)
     {
-        YAAF_SetError("[YAAF_FileCreate] File header magic mismatch");
+        YAAF_SetError("[YAAF File] Failed to create file pool mutex");
+        YAAF_free(p_pool);
         return NULL;
     }
+    p_pool->pFree = NULL;
+    p_pool->nFree = 0;
+    p_pool->maxFree = maxFree;
+    return p_pool;
+}
+
+void
+YAAF_FilePoolDestroy(YAAF_FilePool* pPool)
+{
+    while (pPool->pFree)
+    {
+        YAAF_File* p_next = pPool->pFree->pPoolNext;
+        YAAF_FileFree(pPool->pFree);
+        pPool->pFree = p_next;
+    }
+    YAAF_MutexDestroy(&pPool->mutex);
+    YAAF_free(pPool);
+}
 
-    chr_ptr += sizeof(YAAF_FileHeader);
+YAAF_File*
+YAAF_FileCreatePooled(YAAF_FilePool* pPool,
+                      const struct YAAF_MemFile* pMemFile,
+                      const struct YAAF_ManifestEntry * pManifestEntry)
+{
+    YAAF_File* p_result;
+
+    YAAF_MutexLock(&pPool->mutex);
+    p_result = pPool->pFree;
+    if (p_result)
+    {
+        pPool->pFree = p_result->pPoolNext;
+        --pPool->nFree;
+    }
+    YAAF_MutexUnlock(&pPool->mutex);
 
-    p_result = (YAAF_File*)YAAF_malloc(sizeof(YAAF_File));
     if (!p_result)
     {
-        YAAF_SetError("[YAAF_FileCreate] Failed to allocate memory");
+        p_result = YAAF_FileCreate(pMemFile, pManifestEntry);
     }
-    else
+    else if (YAAF_FileInit(p_result, pMemFile, pManifestEntry) != YAAF_SUCCESS)
     {
-        memset(p_result, 0, sizeof(YAAF_File));
-        p_result->ptr = chr_ptr;
-        p_result->nBytesUncompressed = pManifestEntry->sizeUncompressed;
-        p_result->nBytesCompressed = pManifestEntry->sizeCompressed;
-        p_result->nBytesRead  = 0;
+        YAAF_FileFree(p_result);
+        return NULL;
+    }
 
-        /* create decompressor */
-        if (YAAF_DecompressorCreate(&p_result->decompressor, pManifestEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK)
-                != YAAF_SUCCESS)
-        {
-            YAAF_free(p_result);
-            p_result = NULL;
-        }
+    if (p_result)
+    {
+        p_result->storage = YAAF_FILE_STORAGE_POOL;
+        p_result->pPool = pPool;
     }
     return p_result;
 }
 
+/* Get the block at offset, its data follows the header. When the archive is
+ * not mapped the block is read into pBuffer, which holds
+ * YAAF_FILE_READ_BUFFER_SIZE_FOR(nBytesCompressed) bytes, or from a window
+ * pinned in *ppWindow. */
+static const YAAF_BlockHeader*
+YAAF_FileBlockGet(const YAAF_FileData* pData,
+                  const uint64_t nBytesCompressed,
+                  const uint64_t offset,
+                  void* pBuffer,
+                  void** ppWindow)
+{
+    const void* ptr = NULL;
+    uint64_t size;
+
+    if (pData->ptr)
+    {
+        return (const YAAF_BlockHeader*) YAAF_CONST_PTR_OFFSET(pData->ptr, offset);
+    }
+
+    /* read up to the largest possible block, including the end marker */
+    if (offset > nBytesCompressed)
+    {
+        return NULL;
+    }
+    size = nBytesCompressed + sizeof(YAAF_BlockHeader) - offset;
+    if (size > YAAF_FILE_READ_BUFFER_SIZE)
+    {
+        size = YAAF_FILE_READ_BUFFER_SIZE;
+    }
+
+    if (YAAF_MemFileReadPinned(pData->pMemFile, pData->offset + offset, (size_t)size,
+                               pBuffer, ppWindow, &ptr) != YAAF_SUCCESS)
+    {
+        return NULL;
+    }
+    return (const YAAF_BlockHeader*) ptr;
+}
+
+/* Check the block header and data against the stored hash, unless the block
+ * has already been verified. Block is the index of the block in the file */
+static int
+YAAF_FileVerifyBlock(const YAAF_FileData* pData,
+                     const YAAF_BlockHeader* pHdr,
+                     const uint64_t block)
+{
+    const YAAF_FileVerify* p_verify = &pData->verify;
+    uint32_t* p_word;
+    uint32_t mask;
+
+    if (!p_verify->pVerified)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    if (block >= p_verify->nBlocks)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_word = &p_verify->pVerified[(p_verify->first + block) / 32];
+    mask = 1u << ((p_verify->first + block) % 32);
+    if (YAAF_AtomicLoad32(p_word) & mask)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    if ((uint32_t)YAAF_HashEx(p_verify->hashAlgorithm, pHdr + 1,
+                               YAAF_BLOCK_SIZE_GET(pHdr->size), 0) != pHdr->hash)
+    {
+        return YAAF_FAIL;
+    }
+    YAAF_AtomicOr32(p_word, mask);
+    return YAAF_SUCCESS;
+}
+
+/* Decoded blocks are never larger than the file, small files only get a
+ * buffer of their size and stored files none */
+static int
+YAAF_FileAllocCacheBlock(YAAF_File* pFile)
+{
+    const uint32_t size = (pFile->nBytesUncompressed < YAAF_BLOCK_CACHE_SIZE_RD) ?
+                (uint32_t)pFile->nBytesUncompressed : YAAF_BLOCK_CACHE_SIZE_RD;
+
+    if (pFile->pCacheBlock && pFile->cacheBlockSize >= size)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    if (pFile->pCacheBlock)
+    {
+        YAAF_free(pFile->pCacheBlock);
+    }
+    pFile->cacheBlockSize = 0;
+    pFile->pCacheBlock = (char*) YAAF_malloc((size) ? size : 1);
+    if (!pFile->pCacheBlock)
+    {
+        YAAF_SetError("[YAAF File] Failed to allocate memory");
+        return YAAF_FAIL;
+    }
+    pFile->cacheBlockSize = size;
+    return YAAF_SUCCESS;
+}
+
 static int
 YAAF_FileDecompressNextBlock(YAAF_File* pFile)
 {
-    const YAAF_BlockHeader* pCResult = (YAAF_BlockHeader*) YAAF_PTR_OFFSET(pFile->ptr, pFile->nBytesRead);
-    const uint32_t data_size = YAAF_BLOCK_SIZE_GET(pCResult->size);
-    pFile->nBytesRead += sizeof(YAAF_BlockHeader);
+    const YAAF_BlockHeader* pCResult;
+    uint32_t data_size;
+
     pFile->cacheOffset = 0;
+    if (pFile->pCacheEntry)
+    {
+        YAAF_BlockCacheRelease(pFile->data.pBlockCache, pFile->pCacheEntry);
+        pFile->pCacheEntry = NULL;
+    }
+
+    /* use the block decoded by another file, if any */
+    if (pFile->data.pBlockCache)
+    {
+        const YAAF_BlockCacheEntry* p_entry = YAAF_BlockCacheFind(pFile->data.pBlockCache,
+                                                                  pFile->data.offset + pFile->nBytesRead);
+        if (p_entry)
+        {
+            pFile->pCacheEntry = p_entry;
+            pFile->cachePtr = YAAF_BlockCacheEntryData(p_entry);
+            pFile->cacheSize = p_entry->size;
+            pFile->nBytesRead += p_entry->blockSize;
+            return YAAF_COMPRESSION_OK;
+        }
+    }
+
+    pCResult = YAAF_FileBlockGet(&pFile->data, pFile->nBytesCompressed,
+                                 pFile->nBytesRead, pFile->pReadBuffer,
+                                 &pFile->pWindow);
+    if (!pCResult)
+    {
+        return YAAF_COMPRESSION_FAILED;
+    }
+
+    data_size = YAAF_BLOCK_SIZE_GET(pCResult->size);
     /* check if there are more blocks available */
     if (data_size != 0)
     {
+        if (data_size > YAAF_BLOCK_CACHE_SIZE_WR ||
+                pFile->nBytesRead + sizeof(YAAF_BlockHeader) + data_size > pFile->nBytesCompressed)
+        {
+            return YAAF_COMPRESSION_FAILED;
+        }
+
+        if (YAAF_FileVerifyBlock(&pFile->data, pCResult, pFile->nBytesDecoded / YAAF_BLOCK_SIZE) != YAAF_SUCCESS)
+        {
+            YAAF_SetError("[YAAF File] Block hash does not match");
+            return YAAF_COMPRESSION_FAILED;
+        }
+
+        pFile->nBytesRead += sizeof(YAAF_BlockHeader);
         /* decompress only if the block has been compressed */
         if (YAAF_BLOCK_SIZE_COMPRESSED(pCResult->size))
         {
-            int res =YAAF_DecompressBlock(&pFile->decompressor,
-                                          YAAF_PTR_OFFSET(pFile->ptr, pFile->nBytesRead),
-                                          data_size,
-                                          pFile->cacheBlock,
-                                          YAAF_BLOCK_CACHE_SIZE_RD,
-                                          &pFile->cacheSize);
-            pFile->cachePtr = &pFile->cacheBlock[0];
+            int res;
+            if (YAAF_FileAllocCacheBlock(pFile) != YAAF_SUCCESS)
+            {
+                return YAAF_COMPRESSION_FAILED;
+            }
+            res = YAAF_DecompressBlock(&pFile->decompressor,
+                                       pCResult + 1,
+                                       data_size,
+                                       pFile->pCacheBlock,
+                                       pFile->cacheBlockSize,
+                                       &pFile->cacheSize);
+            pFile->cachePtr = pFile->pCacheBlock;
             if (res == YAAF_COMPRESSION_OK)
             {
+                if (pFile->data.pBlockCache)
+                {
+                    const YAAF_BlockCacheEntry* p_entry = YAAF_BlockCacheInsert(pFile->data.pBlockCache,
+                                                                                pFile->data.offset + pFile->nBytesRead - sizeof(YAAF_BlockHeader),
+                                                                                pFile->pCacheBlock, pFile->cacheSize,
+                                                                                sizeof(YAAF_BlockHeader) + data_size);
+                    if (p_entry)
+                    {
+                        YAAF_BlockCacheRelease(pFile->data.pBlockCache, p_entry);
+                    }
+                }
                 pFile->nBytesRead += data_size;
             }
             return res;
@@ -117,19 +512,250 @@ YAAF_FileDecompressNextBlock(YAAF_File* pFile)
         else
         {
             /* do not copy any memory, simply point directly to the memory
-               mapped file */
-            pFile->cachePtr = YAAF_PTR_OFFSET(pFile->ptr, pFile->nBytesRead);
+               mapped file or the read buffer */
+            pFile->cachePtr = pCResult + 1;
             pFile->cacheSize = data_size;
             pFile->nBytesRead += data_size;
 
-            return YAAF_COMPRESSION_OK;
+            return YAAF_COMPRESSION_OK;
+        }
+    }
+    else
+    {
+        pFile->nBytesRead += sizeof(YAAF_BlockHeader);
+        pFile->cacheSize = 0;
+        return YAAF_COMPRESSION_OK;
+    }
+}
+
+/* Request the next blocks of a sequential read, once the previous request is
+ * half consumed */
+static void
+YAAF_FileReadahead(YAAF_File* pFile)
+{
+    const uint64_t window = (uint64_t)pFile->readahead * YAAF_BLOCK_SIZE;
+
+    if (window && pFile->nBytesRead + window / 2 >= pFile->readaheadEnd &&
+            pFile->readaheadEnd < pFile->nBytesCompressed)
+    {
+        YAAF_MemFileAdvise(pFile->data.pMemFile, pFile->data.offset + pFile->nBytesRead,
+                           window, YAAF_ADVICE_WILLNEED);
+        pFile->readaheadEnd = pFile->nBytesRead + window;
+    }
+}
+
+static int
+YAAF_FileFillCache(YAAF_File* pFile)
+{
+    /* Decode a new block when the current one has been consumed */
+    if (pFile->cacheOffset >= pFile->cacheSize)
+    {
+        YAAF_FileReadahead(pFile);
+        if (YAAF_FileDecompressNextBlock(pFile) != YAAF_COMPRESSION_OK)
+        {
+            YAAF_SetError("[YAAF File] Failed to decode next block");
+            return YAAF_FAIL;
+        }
+        pFile->nBytesDecoded += pFile->cacheSize;
+    }
+    return YAAF_SUCCESS;
+}
+
+static uint64_t
+YAAF_FileBlockTableGet(const YAAF_File* pFile,
+                       const uint64_t block)
+{
+    /* the table is not aligned in the mapping */
+    if (pFile->blockTable64)
+    {
+        uint64_t value64;
+        memcpy(&value64, YAAF_CONST_PTR_OFFSET(pFile->pBlockTable, block * sizeof(uint64_t)),
+               sizeof(value64));
+        return YAAF_LITTLE_E64(value64);
+    }
+    else
+    {
+        uint32_t value32;
+        memcpy(&value32, YAAF_CONST_PTR_OFFSET(pFile->pBlockTable, block * sizeof(uint32_t)),
+               sizeof(value32));
+        return YAAF_LITTLE_E32(value32);
+    }
+}
+
+/* Get the data size of the block at offset, without reading the data */
+static int
+YAAF_FileBlockSize(const YAAF_File* pFile,
+                   const uint64_t offset,
+                   uint32_t* pSize)
+{
+    YAAF_BlockHeader hdr;
+    const void* ptr = NULL;
+
+    if (offset > pFile->nBytesCompressed ||
+            YAAF_MemFileRead(pFile->data.pMemFile, pFile->data.offset + offset,
+                             sizeof(YAAF_BlockHeader), &hdr, &ptr) != YAAF_SUCCESS)
+    {
+        YAAF_SetError("[YAAF File] Invalid block offset");
+        return YAAF_FAIL;
+    }
+    *pSize = YAAF_BLOCK_SIZE_GET(((const YAAF_BlockHeader*)ptr)->size);
+    return YAAF_SUCCESS;
+}
+
+/* Decode the block at *pOffset into pBuffer and advance *pOffset past it.
+ * Block is the index of the block in the file.
+ * pReadBuffer and ppWindow are only used when the archive is not mapped.
+ * Does not set the
+ * error message so that it can be used from worker threads */
+static int
+YAAF_FileDecodeBlock(const YAAF_FileData* pData,
+                     const uint64_t nBytesCompressed,
+                     uint64_t* pOffset,
+                     const uint64_t block,
+                     YAAF_Decompressor* pDecompressor,
+                     void* pReadBuffer,
+                     void** ppWindow,
+                     void* pBuffer,
+                     const uint32_t bufferSize,
+                     uint32_t* pBytesWritten)
+{
+    const YAAF_BlockHeader* p_hdr;
+    uint32_t data_size;
+
+    *pBytesWritten = 0;
+    if (pData->pBlockCache)
+    {
+        const YAAF_BlockCacheEntry* p_entry = YAAF_BlockCacheFind(pData->pBlockCache, pData->offset + *pOffset);
+        if (p_entry)
+        {
+            const int result = (p_entry->size <= bufferSize) ? YAAF_SUCCESS : YAAF_FAIL;
+            if (result == YAAF_SUCCESS)
+            {
+                memcpy(pBuffer, YAAF_BlockCacheEntryData(p_entry), p_entry->size);
+                *pBytesWritten = p_entry->size;
+                *pOffset += p_entry->blockSize;
+            }
+            YAAF_BlockCacheRelease(pData->pBlockCache, p_entry);
+            return result;
+        }
+    }
+
+    p_hdr = YAAF_FileBlockGet(pData, nBytesCompressed, *pOffset, pReadBuffer, ppWindow);
+    if (!p_hdr)
+    {
+        return YAAF_FAIL;
+    }
+
+    data_size = YAAF_BLOCK_SIZE_GET(p_hdr->size);
+    if (data_size == 0)
+    {
+        *pOffset += sizeof(YAAF_BlockHeader);
+        return YAAF_SUCCESS;
+    }
+
+    if (data_size > YAAF_BLOCK_CACHE_SIZE_WR ||
+            *pOffset + sizeof(YAAF_BlockHeader) + data_size > nBytesCompressed ||
+            YAAF_FileVerifyBlock(pData, p_hdr, block) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    if (YAAF_BLOCK_SIZE_COMPRESSED(p_hdr->size))
+    {
+        if (YAAF_DecompressBlock(pDecompressor, p_hdr + 1, data_size,
+                                 pBuffer, bufferSize, pBytesWritten) != YAAF_COMPRESSION_OK)
+        {
+            return YAAF_FAIL;
+        }
+
+        if (pData->pBlockCache)
+        {
+            const YAAF_BlockCacheEntry* p_entry = YAAF_BlockCacheInsert(pData->pBlockCache, pData->offset + *pOffset,
+                                                                        pBuffer, *pBytesWritten,
+                                                                        sizeof(YAAF_BlockHeader) + data_size);
+            if (p_entry)
+            {
+                YAAF_BlockCacheRelease(pData->pBlockCache, p_entry);
+            }
+        }
+    }
+    else
+    {
+        if (data_size > bufferSize)
+        {
+            return YAAF_FAIL;
+        }
+        memcpy(pBuffer, p_hdr + 1, data_size);
+        *pBytesWritten = data_size;
+    }
+
+    *pOffset += sizeof(YAAF_BlockHeader) + data_size;
+    return YAAF_SUCCESS;
+}
+
+static int
+YAAF_FileDecodeBlocks(const YAAF_FileData* pData,
+                      const uint64_t nBytesCompressed,
+                      const uint64_t nBytesUncompressed,
+                      YAAF_Decompressor* pDecompressor,
+                      void* pReadBuffer,
+                      void** ppWindow,
+                      void* pBuffer)
+{
+    uint64_t bytes_read = 0, bytes_decoded = 0;
+
+    for (;;)
+    {
+        const uint64_t remaining = nBytesUncompressed - bytes_decoded;
+        const uint32_t output_size = (remaining < YAAF_BLOCK_SIZE) ? (uint32_t)remaining : YAAF_BLOCK_SIZE;
+        uint32_t bytes_written = 0;
+
+        if (YAAF_FileDecodeBlock(pData, nBytesCompressed, &bytes_read, bytes_decoded / YAAF_BLOCK_SIZE,
+                                 pDecompressor, pReadBuffer, ppWindow,
+                                 YAAF_PTR_OFFSET(pBuffer, bytes_decoded),
+                                 output_size, &bytes_written) != YAAF_SUCCESS)
+        {
+            YAAF_SetError("[YAAF File] Failed to decode block");
+            return YAAF_FAIL;
+        }
+
+        if (bytes_written == 0)
+        {
+            break;
         }
+        bytes_decoded += bytes_written;
     }
-    else
+
+    if (bytes_decoded != nBytesUncompressed)
     {
-        pFile->cacheSize = 0;
-        return YAAF_COMPRESSION_OK;
+        YAAF_SetError("[YAAF File] Decoded size does not match file size");
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+/* Decode the next block straight into pBuffer, which must fit the whole block */
+static int
+YAAF_FileDecompressNextBlockInto(YAAF_File* pFile,
+                                 void* pBuffer,
+                                 const uint32_t bufferSize,
+                                 uint32_t* pBytesWritten)
+{
+    pFile->cacheOffset = 0;
+    pFile->cacheSize = 0;
+
+    YAAF_FileReadahead(pFile);
+    if (YAAF_FileDecodeBlock(&pFile->data, pFile->nBytesCompressed, &pFile->nBytesRead,
+                             pFile->nBytesDecoded / YAAF_BLOCK_SIZE, &pFile->decompressor, pFile->pReadBuffer, &pFile->pWindow, pBuffer, bufferSize,
+                             pBytesWritten) != YAAF_SUCCESS)
+    {
+        YAAF_SetError("[YAAF File] Failed to decode next block");
+        return YAAF_FAIL;
     }
+
+    pFile->nBytesDecoded += *pBytesWritten;
+    pFile->nBytesTell += *pBytesWritten;
+    return YAAF_SUCCESS;
 }
 
 uint32_t
@@ -148,28 +774,41 @@ YAAF_FileRead(YAAF_File* pFile,
 
     while (bytes_written < bufferSize)
     {
-        /* Decode a new block */
-        if (pFile->cacheOffset >= pFile->cacheSize)
+        /* Decode whole blocks straight into the output buffer */
+        if (pBuffer && pFile->cacheOffset >= pFile->cacheSize)
         {
-            const int result = YAAF_FileDecompressNextBlock(pFile);
-            if (result == YAAF_COMPRESSION_OK)
+            const uint64_t remaining = pFile->nBytesUncompressed - pFile->nBytesDecoded;
+            const uint32_t block_size = (remaining < YAAF_BLOCK_SIZE) ? (uint32_t)remaining : YAAF_BLOCK_SIZE;
+
+            if (block_size && block_size <= bufferSize - bytes_written)
             {
-                if( pFile->cacheSize > 0)
+                uint32_t block_written = 0;
+                if (YAAF_FileDecompressNextBlockInto(pFile, (char*)pBuffer + bytes_written,
+                                                     block_size, &block_written) != YAAF_SUCCESS)
                 {
-                    pFile->nBytesDecoded += pFile->cacheSize;
-                    pFile->cacheOffset = 0;
+                    return 0;
                 }
-                else
+
+                if (block_written == 0)
                 {
                     /* EOF */
                     break;
                 }
+                bytes_written += block_written;
+                continue;
             }
-            else
-            {
-                YAAF_SetError("[YAAF File] Failed to decode next block");
-                return 0;
-            }
+        }
+
+        /* Decode a new block */
+        if (YAAF_FileFillCache(pFile) != YAAF_SUCCESS)
+        {
+            return 0;
+        }
+
+        if (pFile->cacheSize == 0)
+        {
+            /* EOF */
+            break;
         }
 
         /* Copy reaming into buffer */
@@ -195,138 +834,520 @@ YAAF_FileRead(YAAF_File* pFile,
     return bytes_written;
 }
 
-
-static int
-YAAF_FileSeekSet(YAAF_File* pFile,
-                 uint32_t bytesRead,
-                 const int offset)
+int
+YAAF_FileReadAll(YAAF_File* pFile,
+                 void* pBuffer)
 {
-    const void* ptr = YAAF_PTR_OFFSET(pFile->ptr, bytesRead);
-    const YAAF_BlockHeader* block_hdr = (const YAAF_BlockHeader*) ptr;
-    uint32_t block_size = YAAF_BLOCK_SIZE_GET(block_hdr->size);
-    uint32_t ptr_offset = 0;
-    const uint32_t skip_blocks = (uint32_t) offset / YAAF_BLOCK_SIZE;
-    const uint32_t skip_bytes = (uint32_t) offset % YAAF_BLOCK_SIZE;
-    uint32_t i;
+    if (pFile->readahead)
+    {
+        YAAF_MemFileAdvise(pFile->data.pMemFile, pFile->data.offset, pFile->nBytesCompressed,
+                           YAAF_ADVICE_WILLNEED);
+    }
 
+    if (YAAF_FileDecodeBlocks(&pFile->data, pFile->nBytesCompressed, pFile->nBytesUncompressed,
+                              &pFile->decompressor, pFile->pReadBuffer, &pFile->pWindow,
+                              pBuffer) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
 
-    /* reset status */
-    pFile->nBytesRead = bytesRead;
-    pFile->nBytesDecoded = 0;
+    /* the whole file has been consumed */
+    pFile->nBytesRead = pFile->nBytesCompressed;
+    pFile->nBytesDecoded = pFile->nBytesUncompressed;
+    pFile->nBytesTell = pFile->nBytesUncompressed;
     pFile->cacheSize = 0;
     pFile->cacheOffset = 0;
+    return YAAF_SUCCESS;
+}
+
+typedef struct
+{
+    const YAAF_File* pFile;
+    const uint64_t* pOffsets;
+    uint64_t firstBlock;
+    uint64_t nBlocks;
+    char* pBuffer;
+    uint64_t bufferSize;
+    uint64_t nextOffset;
+    int result;
+} YAAF_FileReadTask;
+
+/* Decode a contiguous run of blocks with a private decompressor */
+static void
+YAAF_FileReadTaskRun(void* pArg)
+{
+    YAAF_FileReadTask* p_task = (YAAF_FileReadTask*) pArg;
+    const YAAF_File* p_file = p_task->pFile;
+    YAAF_Decompressor dc;
+    uint64_t i, bytes_decoded = 0;
+    char* p_read_buffer = NULL;
+    void* p_window = NULL;
+
+    p_task->result = YAAF_FAIL;
+    if (!p_file->data.ptr)
+    {
+        p_read_buffer = (char*) YAAF_malloc(YAAF_FILE_READ_BUFFER_SIZE_FOR(p_file->nBytesCompressed));
+        if (!p_read_buffer)
+        {
+            return;
+        }
+    }
 
-    /* Skip the first n skip_blocks */
-    for (i = 0; i < skip_blocks && block_size != 0; ++i)
+    if (YAAF_DecompressorCreate(&dc, p_file->compression) != YAAF_SUCCESS)
     {
-        /* update ptr offset */
-        ptr_offset = sizeof(YAAF_BlockHeader) + block_size;
-        pFile->nBytesRead += ptr_offset;
-        ptr = YAAF_PTR_OFFSET(ptr, ptr_offset);
+        if (p_read_buffer)
+        {
+            YAAF_free(p_read_buffer);
+        }
+        return;
+    }
 
-        /* next block size */
-        block_hdr = (const YAAF_BlockHeader*) ptr;
-        block_size = YAAF_BLOCK_SIZE_GET(block_hdr->size);
+    for (i = 0; i < p_task->nBlocks; ++i)
+    {
+        const uint64_t remaining = p_task->bufferSize - bytes_decoded;
+        const uint32_t output_size = (remaining < YAAF_BLOCK_SIZE) ? (uint32_t)remaining : YAAF_BLOCK_SIZE;
+        uint64_t offset = p_task->pOffsets[i];
+        uint32_t bytes_written = 0;
 
-        /* updated decode bytes */
-        pFile->nBytesDecoded += YAAF_BLOCK_SIZE;
+        if (YAAF_FileDecodeBlock(&p_file->data, p_file->nBytesCompressed, &offset, p_task->firstBlock + i, &dc,
+                                 p_read_buffer, &p_window, p_task->pBuffer + bytes_decoded, output_size,
+                                 &bytes_written) != YAAF_SUCCESS ||
+                bytes_written != output_size)
+        {
+            break;
+        }
+        bytes_decoded += bytes_written;
+        p_task->nextOffset = offset;
+    }
 
+    YAAF_MemFileRelease(p_file->data.pMemFile, &p_window);
+    YAAF_DecompressorDestroy(&dc);
+    if (p_read_buffer)
+    {
+        YAAF_free(p_read_buffer);
     }
+    p_task->result = (i == p_task->nBlocks) ? YAAF_SUCCESS : YAAF_FAIL;
+}
+
+/* Collect the offsets of nBlocks blocks starting at the current block */
+static int
+YAAF_FileCollectBlockOffsets(const YAAF_File* pFile,
+                             uint64_t* pOffsets,
+                             const uint64_t nBlocks)
+{
+    const uint64_t first_block = pFile->nBytesDecoded / YAAF_BLOCK_SIZE;
+    uint64_t i, offset = pFile->nBytesRead;
+    uint32_t block_size = 0;
 
-    if (block_size != 0 && i >= skip_blocks)
+    for (i = 0; i < nBlocks; ++i)
     {
-        /* decode next block */
-        const int result = YAAF_FileDecompressNextBlock(pFile);
-        if (result == YAAF_COMPRESSION_OK)
+        if (pFile->pBlockTable)
         {
-            if( pFile->cacheSize > 0)
-            {
-                pFile->nBytesDecoded += pFile->cacheSize;
-                pFile->cacheOffset = skip_bytes;
-                pFile->nBytesTell = offset;
-            }
+            offset = YAAF_FileBlockTableGet(pFile, first_block + i);
         }
-        else
+
+        if (offset >= pFile->nBytesCompressed)
         {
+            YAAF_SetError("[YAAF File] Invalid block offset");
             return YAAF_FAIL;
         }
+        pOffsets[i] = offset;
+
+        if (!pFile->pBlockTable)
+        {
+            if (YAAF_FileBlockSize(pFile, offset, &block_size) != YAAF_SUCCESS)
+            {
+                return YAAF_FAIL;
+            }
+            offset += sizeof(YAAF_BlockHeader) + block_size;
+        }
     }
     return YAAF_SUCCESS;
 }
 
-
-int
-YAAF_FileSeek(YAAF_File* pFile,
-              int offset,
-              int flags)
+uint64_t
+YAAF_FileReadParallel(YAAF_File* pFile,
+                      void* pBuffer,
+                      const uint64_t size,
+                      YAAF_ThreadPool* pPool)
 {
-    switch(flags)
+    YAAF_FileReadTask* p_tasks = NULL;
+    YAAF_Task* p_pool_tasks = NULL;
+    uint64_t* p_offsets = NULL;
+    YAAF_TaskGroup group;
+    uint64_t bytes_written = 0, bytes_parallel, n_blocks, blocks_per_task, i;
+    uint32_t n_tasks;
+
+    /* finish the block in the cache first */
+    if (pFile->cacheOffset < pFile->cacheSize)
     {
-    case SEEK_SET:
+        const uint32_t cached = pFile->cacheSize - pFile->cacheOffset;
+        bytes_written = YAAF_FileRead(pFile, pBuffer, (size < cached) ? (uint32_t)size : cached);
+    }
+
+    /* only whole blocks are decoded in parallel */
+    bytes_parallel = pFile->nBytesUncompressed - pFile->nBytesDecoded;
+    if (size - bytes_written < bytes_parallel)
+    {
+        bytes_parallel = ((size - bytes_written) / YAAF_BLOCK_SIZE) * YAAF_BLOCK_SIZE;
+    }
+    n_blocks = (bytes_parallel + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
+
+    if (!pPool)
+    {
+        pPool = YAAF_ThreadPoolGetDefault();
+    }
+
+    if (pBuffer && n_blocks > 1 && pPool)
+    {
+        n_tasks = YAAF_ThreadPoolSize(pPool);
+        if (n_blocks < n_tasks)
+        {
+            n_tasks = (uint32_t)n_blocks;
+        }
+        blocks_per_task = (n_blocks + n_tasks - 1) / n_tasks;
 
-        if(offset < 0)
+        p_offsets = (uint64_t*) YAAF_malloc(sizeof(uint64_t) * n_blocks);
+        p_tasks = (YAAF_FileReadTask*) YAAF_calloc(n_tasks, sizeof(YAAF_FileReadTask));
+        p_pool_tasks = (YAAF_Task*) YAAF_calloc(n_tasks, sizeof(YAAF_Task));
+        if (!p_offsets || !p_tasks || !p_pool_tasks)
         {
-            return YAAF_FAIL;
+            YAAF_SetError("[YAAF File] Failed to allocate memory");
+            goto cleanup;
         }
 
-        if ((uint32_t) offset > pFile->nBytesUncompressed)
+        if (YAAF_FileCollectBlockOffsets(pFile, p_offsets, n_blocks) != YAAF_SUCCESS)
         {
-            pFile->nBytesRead = pFile->nBytesCompressed;
-            pFile->nBytesDecoded = pFile->nBytesUncompressed;
-            pFile->cacheSize = 0;
-            pFile->cacheOffset = 0;
-            pFile->nBytesTell = pFile->nBytesUncompressed;
-            return YAAF_SUCCESS;
+            goto cleanup;
         }
 
-        return YAAF_FileSeekSet(pFile, 0, offset);
-    case SEEK_CUR:
+        if (pFile->readahead)
+        {
+            YAAF_MemFileAdvise(pFile->data.pMemFile, pFile->data.offset + p_offsets[0],
+                               p_offsets[n_blocks - 1] - p_offsets[0] + sizeof(YAAF_BlockHeader) + YAAF_BLOCK_SIZE,
+                               YAAF_ADVICE_WILLNEED);
+        }
 
-        if (offset < 0)
+        /* each task decodes into its own part of the buffer */
+        group.nPending = 0;
+        for (i = 0; i < n_tasks; ++i)
         {
-            /* check if the offset is still in the cach */
-            int new_offset = offset + (int)pFile->cacheOffset;
-            if ( new_offset >= 0)
+            const uint64_t first_block = i * blocks_per_task;
+            const uint64_t task_offset = first_block * YAAF_BLOCK_SIZE;
+            YAAF_FileReadTask* p_task = &p_tasks[i];
+
+            if (first_block >= n_blocks)
             {
-                pFile->cacheOffset = new_offset;
-                pFile->nBytesTell = new_offset;
+                n_tasks = (uint32_t)i;
+                break;
             }
-            else
+
+            p_task->pFile = pFile;
+            p_task->pOffsets = p_offsets + first_block;
+            p_task->firstBlock = pFile->nBytesDecoded / YAAF_BLOCK_SIZE + first_block;
+            p_task->nBlocks = (n_blocks - first_block < blocks_per_task) ? n_blocks - first_block : blocks_per_task;
+            p_task->pBuffer = (char*)pBuffer + bytes_written + task_offset;
+            p_task->bufferSize = (bytes_parallel - task_offset < p_task->nBlocks * YAAF_BLOCK_SIZE) ?
+                        bytes_parallel - task_offset : p_task->nBlocks * YAAF_BLOCK_SIZE;
+            p_pool_tasks[i].fnc = YAAF_FileReadTaskRun;
+            p_pool_tasks[i].pArg = p_task;
+            YAAF_ThreadPoolSubmit(pPool, &group, &p_pool_tasks[i]);
+        }
+        YAAF_ThreadPoolWait(pPool, &group);
+
+        for (i = 0; i < n_tasks; ++i)
+        {
+            if (p_tasks[i].result != YAAF_SUCCESS)
             {
-                /* offset not in cache, need to start from begining again */
-                return YAAF_FileSeek(pFile, pFile->nBytesDecoded - offset, SEEK_SET);
+                YAAF_SetError("[YAAF File] Failed to decode block");
+                goto cleanup;
             }
         }
-        else if (offset > 0)
+
+        /* the blocks have been consumed */
+        pFile->nBytesRead = p_tasks[n_tasks - 1].nextOffset;
+        pFile->nBytesDecoded += bytes_parallel;
+        pFile->nBytesTell += bytes_parallel;
+        pFile->cacheSize = 0;
+        pFile->cacheOffset = 0;
+        bytes_written += bytes_parallel;
+    }
+
+    /* read the remaining partial block, or everything if there was no point
+       in going parallel. Without a buffer the data is skipped */
+    while (bytes_written < size && !YAAF_FileEOF(pFile))
+    {
+        const uint64_t remaining = size - bytes_written;
+        const uint32_t chunk = (remaining < YAAF_BLOCK_SIZE) ? (uint32_t)remaining : YAAF_BLOCK_SIZE;
+        const uint32_t bytes_read = YAAF_FileRead(pFile, (pBuffer) ? (char*)pBuffer + bytes_written : NULL,
+                                                  chunk);
+        if (bytes_read == 0)
         {
+            break;
+        }
+        bytes_written += bytes_read;
+    }
 
-            /* check if the offset is still in the cache */
-            if ((int)(pFile->cacheSize - pFile->cacheOffset) < offset )
-            {
-                pFile->cacheOffset += (uint32_t) offset;
-                pFile->nBytesTell += offset;
-            }
-            else
+cleanup:
+    if (p_pool_tasks)
+    {
+        YAAF_free(p_pool_tasks);
+    }
+    if (p_tasks)
+    {
+        YAAF_free(p_tasks);
+    }
+    if (p_offsets)
+    {
+        YAAF_free(p_offsets);
+    }
+    /* on failure the position only moved past the bytes already delivered */
+    return bytes_written;
+}
+
+int
+YAAF_FileDecodeEntry(const struct YAAF_MemFile* pMemFile,
+                     struct YAAF_BlockCache* pBlockCache,
+                     const YAAF_FileVerify* pVerify,
+                     const struct YAAF_ManifestEntry* pManifestEntry,
+                     void* pBuffer)
+{
+    YAAF_Decompressor dc;
+    YAAF_FileHeader hdr;
+    YAAF_FileData data;
+    const YAAF_FileHeader* p_hdr = NULL;
+    char* p_read_buffer = NULL;
+    void* p_window = NULL;
+    const uint64_t offset = YAAF_ManifestEntryOffset(pManifestEntry);
+    int result;
+
+    if (YAAF_MemFileRead(pMemFile, offset, sizeof(YAAF_FileHeader), &hdr,
+                         (const void**)&p_hdr) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    if (YAAF_LITTLE_E32(p_hdr->magic) != YAAF_FILE_HEADER_MAGIC)
+    {
+        YAAF_SetError("[YAAF File] File header magic mismatch");
+        return YAAF_FAIL;
+    }
+
+    data.pMemFile = pMemFile;
+    data.offset = offset + sizeof(YAAF_FileHeader);
+    data.ptr = (pMemFile->ptr) ? YAAF_CONST_PTR_OFFSET(pMemFile->ptr, data.offset) : NULL;
+    data.pBlockCache = pBlockCache;
+    if (pVerify)
+    {
+        data.verify = *pVerify;
+    }
+    else
+    {
+        memset(&data.verify, 0, sizeof(data.verify));
+    }
+
+    if (!data.ptr)
+    {
+        p_read_buffer = (char*) YAAF_malloc(YAAF_FILE_READ_BUFFER_SIZE_FOR(YAAF_ManifestEntrySizeCompressed(pManifestEntry)));
+        if (!p_read_buffer)
+        {
+            YAAF_SetError("[YAAF File] Failed to allocate memory");
+            return YAAF_FAIL;
+        }
+    }
+
+    if (YAAF_DecompressorCreate(&dc, pManifestEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK) != YAAF_SUCCESS)
+    {
+        YAAF_SetError("[YAAF File] Failed to create decompressor");
+        result = YAAF_FAIL;
+    }
+    else
+    {
+        result = YAAF_FileDecodeBlocks(&data,
+                                       YAAF_ManifestEntrySizeCompressed(pManifestEntry),
+                                       YAAF_ManifestEntrySizeUncompressed(pManifestEntry),
+                                       &dc, p_read_buffer, &p_window, pBuffer);
+        YAAF_MemFileRelease(pMemFile, &p_window);
+        YAAF_DecompressorDestroy(&dc);
+    }
+
+    if (p_read_buffer)
+    {
+        YAAF_free(p_read_buffer);
+    }
+    return result;
+}
+
+int
+YAAF_FileNextBlock(YAAF_File* pFile,
+                   const void** pPtr,
+                   uint32_t* pSize)
+{
+    *pPtr = NULL;
+    *pSize = 0;
+
+    if (YAAF_FileEOF(pFile))
+    {
+        return YAAF_SUCCESS;
+    }
+
+    if (YAAF_FileFillCache(pFile) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* hand out the remainder of the current block */
+    *pPtr = YAAF_CONST_PTR_OFFSET(pFile->cachePtr, pFile->cacheOffset);
+    *pSize = pFile->cacheSize - pFile->cacheOffset;
+    pFile->cacheOffset = pFile->cacheSize;
+    pFile->nBytesTell += *pSize;
+    return YAAF_SUCCESS;
+}
+
+
+static int
+YAAF_FileSeekBlock(YAAF_File* pFile,
+                   const uint64_t offset)
+{
+    const uint64_t block = offset / YAAF_BLOCK_SIZE;
+    uint64_t cur_block = 0;
+    uint64_t bytes_read = 0;
+
+    if (pFile->pBlockTable)
+    {
+        /* jump straight to the block */
+        if (block >= pFile->nBlocks ||
+                (bytes_read = YAAF_FileBlockTableGet(pFile, block)) >= pFile->nBytesCompressed)
+        {
+            YAAF_SetError("[YAAF File] Invalid block offset table");
+            return YAAF_FAIL;
+        }
+    }
+    else
+    {
+        uint32_t block_size = 0;
+
+        /* continue from the current position when seeking forward */
+        if (pFile->nBytesRead < pFile->nBytesCompressed &&
+                (pFile->nBytesDecoded % YAAF_BLOCK_SIZE) == 0 &&
+                pFile->nBytesDecoded / YAAF_BLOCK_SIZE <= block)
+        {
+            cur_block = pFile->nBytesDecoded / YAAF_BLOCK_SIZE;
+            bytes_read = pFile->nBytesRead;
+        }
+
+        /* Skip blocks until the requested one */
+        if (YAAF_FileBlockSize(pFile, bytes_read, &block_size) != YAAF_SUCCESS)
+        {
+            return YAAF_FAIL;
+        }
+        for (; cur_block < block && block_size != 0; ++cur_block)
+        {
+            bytes_read += sizeof(YAAF_BlockHeader) + block_size;
+            if (YAAF_FileBlockSize(pFile, bytes_read, &block_size) != YAAF_SUCCESS)
             {
-                int remaining_in_cache = (int)(pFile->cacheSize - pFile->cacheOffset);
-                int offset_to_reach = offset - remaining_in_cache;
-                /* read forward untill offset in cache */
-                return YAAF_FileSeekSet(pFile, pFile->nBytesRead, offset_to_reach);
+                return YAAF_FAIL;
             }
         }
-        return YAAF_SUCCESS;
+
+        if (block_size == 0)
+        {
+            YAAF_SetError("[YAAF File] Seek past the last block");
+            return YAAF_FAIL;
+        }
+    }
+
+    /* reset status */
+    pFile->nBytesRead = bytes_read;
+    pFile->nBytesDecoded = block * YAAF_BLOCK_SIZE;
+    pFile->cacheSize = 0;
+    pFile->cacheOffset = 0;
+
+    /* decode the block */
+    if (YAAF_FileDecompressNextBlock(pFile) != YAAF_COMPRESSION_OK)
+    {
+        YAAF_SetError("[YAAF File] Failed to decode block");
+        return YAAF_FAIL;
+    }
+
+    pFile->nBytesDecoded += pFile->cacheSize;
+    pFile->cacheOffset = (uint32_t)(offset - block * YAAF_BLOCK_SIZE);
+    pFile->nBytesTell = offset;
+    /* a single block read after a seek does not trigger readahead */
+    pFile->readaheadEnd = pFile->nBytesRead;
+    return YAAF_SUCCESS;
+}
+
+
+int
+YAAF_FileSeek(YAAF_File* pFile,
+              int64_t offset,
+              int flags)
+{
+    int64_t position;
+    uint64_t block_start;
+
+    switch(flags)
+    {
+    case SEEK_SET:
+        position = offset;
+        break;
+    case SEEK_CUR:
+        position = (int64_t)pFile->nBytesTell + offset;
+        break;
     case SEEK_END:
+        position = (int64_t)pFile->nBytesUncompressed + offset;
+        break;
+    default:
+        return YAAF_FAIL;
+    }
+
+    if (position < 0)
+    {
+        return YAAF_FAIL;
+    }
+
+    if (position >= (int64_t)pFile->nBytesUncompressed)
+    {
         pFile->nBytesRead = pFile->nBytesCompressed;
         pFile->nBytesDecoded = pFile->nBytesUncompressed;
-        pFile->cacheOffset = 0;
         pFile->cacheSize = 0;
-        pFile->nBytesTell += offset;
+        pFile->cacheOffset = 0;
+        pFile->nBytesTell = pFile->nBytesUncompressed;
+        return YAAF_SUCCESS;
+    }
+
+    /* check if the offset is still in the cache */
+    block_start = pFile->nBytesDecoded - pFile->cacheSize;
+    if (pFile->cacheSize && position >= (int64_t)block_start &&
+            position < (int64_t)pFile->nBytesDecoded)
+    {
+        pFile->cacheOffset = (uint32_t)((uint64_t)position - block_start);
+        pFile->nBytesTell = (uint64_t)position;
         return YAAF_SUCCESS;
-    default:
-        return YAAF_FAIL;
     }
+
+    return YAAF_FileSeekBlock(pFile, (uint64_t)position);
+}
+
+
+int
+YAAF_FileAdvise(YAAF_File* pFile,
+                const YAAF_Advice advice)
+{
+    /* include the file header and the block offset table */
+    return YAAF_MemFileAdvise(pFile->data.pMemFile, pFile->data.offset - sizeof(YAAF_FileHeader),
+                              sizeof(YAAF_FileHeader) + pFile->nBytesCompressed + sizeof(YAAF_BlockHeader) +
+                              ((pFile->pBlockTable) ? pFile->nBlocks * ((pFile->blockTable64) ? 8 : 4) : 0),
+                              advice);
 }
 
+void
+YAAF_FileSetReadahead(YAAF_File* pFile,
+                      const uint32_t nBlocks)
+{
+    pFile->readahead = nBlocks;
+}
 
 int
 YAAF_FileEOF(const YAAF_File* pFile)
@@ -335,13 +1356,13 @@ YAAF_FileEOF(const YAAF_File* pFile)
             pFile->cacheOffset >= pFile->cacheSize;
 }
 
-uint32_t
+uint64_t
 YAAF_FileTell(const YAAF_File* pFile)
 {
     return pFile->nBytesTell;
 }
 
-uint32_t
+uint64_t
 YAAF_FileSize(const YAAF_File* pFile)
 {
     return pFile->nBytesUncompressed;
@@ -350,7 +1371,35 @@ YAAF_FileSize(const YAAF_File* pFile)
 void
 YAAF_FileDestroy(YAAF_File* pFile)
 {
-    YAAF_DecompressorDestroy(&pFile->decompressor);
-    YAAF_free(pFile);
+    YAAF_FileFinish(pFile);
+    switch (pFile->storage)
+    {
+    case YAAF_FILE_STORAGE_CALLER:
+        YAAF_FileFreeBuffers(pFile);
+        break;
+    case YAAF_FILE_STORAGE_POOL:
+    {
+        YAAF_FilePool* p_pool = pFile->pPool;
+        int keep;
+
+        YAAF_MutexLock(&p_pool->mutex);
+        keep = p_pool->nFree < p_pool->maxFree;
+        if (keep)
+        {
+            pFile->pPoolNext = p_pool->pFree;
+            p_pool->pFree = pFile;
+            ++p_pool->nFree;
+        }
+        YAAF_MutexUnlock(&p_pool->mutex);
+        if (!keep)
+        {
+            YAAF_FileFree(pFile);
+        }
+        break;
+    }
+    default:
+        YAAF_FileFree(pFile);
+        break;
+    }
 }
 
@@ -37,22 +37,103 @@
 #include "YAAF_Compression.h"
 
 struct YAAF_ManifestEntry;
+struct YAAF_MemFile;
+struct YAAF_BlockCache;
+struct YAAF_BlockCacheEntry;
+
+typedef struct YAAF_FilePool YAAF_FilePool;
+
+/* Who owns the memory of a YAAF_File */
+enum
+{
+  YAAF_FILE_STORAGE_HEAP = 0,
+  YAAF_FILE_STORAGE_CALLER,
+  YAAF_FILE_STORAGE_POOL
+};
+
+/* Blocks of a file are checked against their hash the first time they are
+ * read, the verified blocks are marked in a bitmap shared by the archive */
+typedef struct YAAF_FileVerify
+{
+  uint32_t* pVerified; /* NULL if blocks are not verified */
+  uint64_t first; /* bit of the first block of the file */
+  uint64_t nBlocks;
+  int hashAlgorithm; /* algorithm of the block hashes */
+} YAAF_FileVerify;
+
+/* Location of the blocks of a file in the archive */
+typedef struct YAAF_FileData
+{
+  const struct YAAF_MemFile* pMemFile;
+  const void* ptr; /* NULL when the archive is not mapped */
+  uint64_t offset;
+  struct YAAF_BlockCache* pBlockCache; /* NULL if blocks are not shared */
+  YAAF_FileVerify verify;
+} YAAF_FileData;
+
+/* Blocks are read into a buffer of this size when the archive is not mapped */
+#define YAAF_FILE_READ_BUFFER_SIZE (sizeof(YAAF_BlockHeader) + YAAF_BLOCK_CACHE_SIZE_WR)
+
+/* No block of a file is larger than the file itself */
+#define YAAF_FILE_READ_BUFFER_SIZE_FOR(nBytesCompressed) \
+  (((nBytesCompressed) + sizeof(YAAF_BlockHeader) < YAAF_FILE_READ_BUFFER_SIZE) ? \
+  (size_t)((nBytesCompressed) + sizeof(YAAF_BlockHeader)) : YAAF_FILE_READ_BUFFER_SIZE)
 
 struct YAAF_File
 {
-  const void* ptr;
+  YAAF_FileData data;
   const void* cachePtr;
+  const struct YAAF_BlockCacheEntry* pCacheEntry;
   uint32_t cacheOffset;
   uint32_t cacheSize;
-  uint32_t nBytesRead;
-  uint32_t nBytesDecoded;
-  uint32_t nBytesUncompressed;
-  uint32_t nBytesCompressed;
-  uint32_t nBytesTell;
+  uint64_t nBytesRead;
+  uint64_t nBytesDecoded;
+  uint64_t nBytesUncompressed;
+  uint64_t nBytesCompressed;
+  uint64_t nBytesTell;
+  const void* pBlockTable;
+  uint64_t nBlocks;
+  int blockTable64;
+  int compression;
+  char* pReadBuffer;
+  size_t readBufferSize;
+  void* pWindow;
+  void* pBlockTableBuffer;
+  uint64_t readaheadEnd;
+  uint32_t readahead;
   YAAF_Decompressor decompressor;
-  char cacheBlock[YAAF_BLOCK_CACHE_SIZE_RD];
+  int storage;
+  YAAF_FilePool* pPool;
+  struct YAAF_File* pPoolNext;
+  char* pCacheBlock; /* allocated on the first compressed block */
+  uint32_t cacheBlockSize;
 };
 
-YAAF_File* YAAF_FileCreate(const void* ptr,
+YAAF_File* YAAF_FileCreate(const struct YAAF_MemFile* pMemFile,
                            const struct YAAF_ManifestEntry * pManifestEnt);
+
+/* Create the file in pStorage, which must be 8 byte aligned and at least
+ * sizeof(YAAF_File) bytes. YAAF_FileDestroy() does not free the storage, only
+ * the buffers of the file. */
+YAAF_File* YAAF_FileCreateInPlace(const struct YAAF_MemFile* pMemFile,
+                                  const struct YAAF_ManifestEntry * pManifestEnt,
+                                  void* pStorage,
+                                  const size_t storageSize);
+
+/* A pool keeps up to maxFree destroyed files for reuse */
+YAAF_FilePool* YAAF_FilePoolCreate(const uint32_t maxFree);
+
+/* Every file taken from the pool must have been destroyed */
+void YAAF_FilePoolDestroy(YAAF_FilePool* pPool);
+
+YAAF_File* YAAF_FileCreatePooled(YAAF_FilePool* pPool,
+                                 const struct YAAF_MemFile* pMemFile,
+                                 const struct YAAF_ManifestEntry * pManifestEnt);
+
+/* Decode a whole file into pBuffer without creating a YAAF_File */
+int YAAF_FileDecodeEntry(const struct YAAF_MemFile* pMemFile,
+                         struct YAAF_BlockCache* pBlockCache,
+                         const YAAF_FileVerify* pVerify,
+                         const struct YAAF_ManifestEntry* pManifestEntry,
+                         void* pBuffer);
 #endif
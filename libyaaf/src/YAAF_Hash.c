@@ -31,6 +31,7 @@
  */
 
 #include "YAAF_Hash.h"
+#include "YAAF_Internal.h"
 #include <ctype.h>
 
 /* One At a Time Hash (http://www.burtleburtle.net/bob/hash/doobs.html)
@@ -52,3 +53,69 @@ YAAF_OnceAtATimeHashNoCase(const char* str)
 
     return hash;
 }
+
+/* Name hash of archives with YAAF_ARCHIVE_FLAG_NAME_HASH_V2. The name is
+ * read as little endian 64 bit words, zero padded, with the ASCII letters in
+ * lower case unless the archive is case sensitive. Each word costs one
+ * multiply instead of a tolower() per byte. The result must not change
+ * between platforms, it is stored in archives. */
+#define YAAF_NAME_HASH_PRIME 0x9E3779B97F4A7C15ull
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_NameHashMix(uint64_t hash,
+                 const uint64_t word)
+{
+    hash = (hash ^ word) * YAAF_NAME_HASH_PRIME;
+    return hash ^ (hash >> 32);
+}
+
+YAAF_FORCE_INLINE uint32_t
+YAAF_NameHashImpl(const char* str,
+                  const size_t len,
+                  const int fold)
+{
+    uint64_t hash = YAAF_NAME_HASH_PRIME ^ (uint64_t)len;
+    uint64_t word;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8)
+    {
+        memcpy(&word, str + i, 8);
+        word = YAAF_LITTLE_E64(word);
+        hash = YAAF_NameHashMix(hash, fold ? YAAF_FoldAscii64(word) : word);
+    }
+
+    /* the remaining bytes in the low bytes of the last word */
+    if (i < len)
+    {
+        const size_t remaining = len - i;
+        word = YAAF_LoadTail64(str, len);
+        if (len >= 8)
+        {
+            word >>= (8 - remaining) * 8;
+        }
+        hash = YAAF_NameHashMix(hash, fold ? YAAF_FoldAscii64(word) : word);
+    }
+
+    /* MurmurHash3 finalizer */
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return (uint32_t)hash;
+}
+
+uint32_t
+YAAF_NameHash(const char* str,
+              const size_t len)
+{
+    return YAAF_NameHashImpl(str, len, 1);
+}
+
+uint32_t
+YAAF_NameHashExact(const char* str,
+                   const size_t len)
+{
+    return YAAF_NameHashImpl(str, len, 0);
+}
@@ -39,20 +39,42 @@
 #error No hashing algorithm defined
 #endif
 
+/* Hash algorithms of the blocks and files of an archive. Blocks store the
+ * lower 32 bits of the hash, files the whole hash. The manifest and index
+ * always use YAAF_HASH_XXH32. */
+enum
+{
+    YAAF_HASH_XXH32 = 0,
+    YAAF_HASH_XXH64
+};
+
 void YAAF_HashStateReset(YAAF_HashState_t* pState,
+                         const int algorithm,
                          const uint32_t seed);
 
 int YAAF_HashStateUpdate(YAAF_HashState_t* pState,
                          const void* input,
                          const uint32_t size);
 
-uint32_t YAAF_HashStateDigest(YAAF_HashState_t* pState);
+uint64_t YAAF_HashStateDigest(YAAF_HashState_t* pState);
 
 uint32_t YAAF_Hash(const void* input,
                    const uint32_t size,
                    const uint32_t seed);
 
+uint64_t YAAF_HashEx(const int algorithm,
+                     const void* input,
+                     const uint32_t size,
+                     const uint32_t seed);
+
 uint32_t YAAF_OnceAtATimeHashNoCase(const char* str);
 
+uint32_t YAAF_NameHash(const char* str,
+                       const size_t len);
+
+/* YAAF_NameHash() without case folding, for case sensitive archives */
+uint32_t YAAF_NameHashExact(const char* str,
+                            const size_t len);
+
 
 #endif
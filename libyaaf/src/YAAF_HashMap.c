@@ -33,33 +33,197 @@
 #include "YAAF_Internal.h"
 #include "YAAF_Hash.h"
 
-/* us the address of the pointer of the hashmap structure as an empty value*/
-#define YAAF_HASHMAP_ENTRY_DELETED(hashmap) ((void*)(hashmap))
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YAAF_HASHMAP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define YAAF_HASHMAP_NEON
+#endif
+
+#define YAAF_HASHMAP_GROUP_SIZE 16
+#define YAAF_HASHMAP_CTRL_EMPTY 0x80
+#define YAAF_HASHMAP_CTRL_DELETED 0xFE
+/* slots in use have the top bit of their control byte cleared */
+#define YAAF_HASHMAP_CTRL_IS_FULL(ctrl) (((ctrl) & 0x80) == 0)
+#define YAAF_HASHMAP_H1(hash) ((hash) >> 7)
+#define YAAF_HASHMAP_H2(hash) ((uint8_t)((hash) & 0x7F))
+#define YAAF_HASHMAP_MAX_CAPACITY 0x80000000u
+#define YAAF_HASHMAP_NOT_FOUND 0xFFFFFFFF
 
 struct YAAF_HashMapEntry
 {
     const void* pData;
     const char* key;
-    uint32_t hash;
 };
 
+/* --- Group probing -------------------------------------------------------
+ * The match functions return a bit mask of the slots of a group that
+ * satisfy the condition. NEON has no movemask, each slot takes 4 bits of
+ * the mask instead of 1. */
+
+#if defined(YAAF_HASHMAP_NEON)
+#define YAAF_HASHMAP_MASK_SHIFT 2
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapNeonMask(const uint8x16_t cmp)
+{
+    const uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrow), 0) & 0x8888888888888888ull;
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatch(const uint8_t* pCtrl,
+                       const uint8_t tag)
+{
+    return YAAF_HashMapNeonMask(vceqq_u8(vld1q_u8(pCtrl), vdupq_n_u8(tag)));
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatchEmpty(const uint8_t* pCtrl)
+{
+    return YAAF_HashMapGroupMatch(pCtrl, YAAF_HASHMAP_CTRL_EMPTY);
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatchFree(const uint8_t* pCtrl)
+{
+    return YAAF_HashMapNeonMask(vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(pCtrl)), vdupq_n_s8(0)));
+}
+
+#elif defined(YAAF_HASHMAP_SSE2)
+#define YAAF_HASHMAP_MASK_SHIFT 0
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatch(const uint8_t* pCtrl,
+                       const uint8_t tag)
+{
+    const __m128i group = _mm_loadu_si128((const __m128i*)pCtrl);
+    return (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatchEmpty(const uint8_t* pCtrl)
+{
+    return YAAF_HashMapGroupMatch(pCtrl, YAAF_HASHMAP_CTRL_EMPTY);
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatchFree(const uint8_t* pCtrl)
+{
+    return (uint64_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)pCtrl));
+}
+
+#else
+#define YAAF_HASHMAP_MASK_SHIFT 0
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatch(const uint8_t* pCtrl,
+                       const uint8_t tag)
+{
+    uint64_t mask = 0;
+    int i;
+    for (i = 0; i < YAAF_HASHMAP_GROUP_SIZE; ++i)
+    {
+        mask |= (uint64_t)(pCtrl[i] == tag) << i;
+    }
+    return mask;
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatchEmpty(const uint8_t* pCtrl)
+{
+    return YAAF_HashMapGroupMatch(pCtrl, YAAF_HASHMAP_CTRL_EMPTY);
+}
+
+YAAF_FORCE_INLINE uint64_t
+YAAF_HashMapGroupMatchFree(const uint8_t* pCtrl)
+{
+    uint64_t mask = 0;
+    int i;
+    for (i = 0; i < YAAF_HASHMAP_GROUP_SIZE; ++i)
+    {
+        mask |= (uint64_t)(pCtrl[i] >> 7) << i;
+    }
+    return mask;
+}
+#endif
+
+/* index in the group of the lowest slot set in the mask */
+YAAF_FORCE_INLINE uint32_t
+YAAF_HashMapMaskFirst(const uint64_t mask)
+{
+    uint32_t bit = 0;
+#if defined(YAAF_COMPILER_GNUC) || defined(YAAF_COMPILER_CLANG)
+    bit = (uint32_t)__builtin_ctzll(mask);
+#else
+    uint64_t tmp = mask;
+    while (!(tmp & 1))
+    {
+        tmp >>= 1;
+        ++bit;
+    }
+#endif
+    return bit >> YAAF_HASHMAP_MASK_SHIFT;
+}
+
+/* --- Map -----------------------------------------------------------------*/
+
+static uint32_t
+YAAF_HashMapCapacityFor(const uint64_t count)
+{
+    uint64_t capacity = YAAF_HASHMAP_GROUP_SIZE;
+    while (count > capacity * 7 / 8)
+    {
+        capacity <<= 1;
+    }
+    return (capacity > YAAF_HASHMAP_MAX_CAPACITY) ? 0 : (uint32_t)capacity;
+}
+
+static int
+YAAF_HashMapAlloc(YAAF_HashMap* pHashMap,
+                  const uint32_t capacity)
+{
+    /* entries, hashes and control bytes share one allocation */
+    char* ptr = (char*) YAAF_malloc((sizeof(YAAF_HashMapEntry) + sizeof(uint32_t) + 1) * (size_t)capacity);
+    if (!ptr)
+    {
+        return YAAF_FAIL;
+    }
+    pHashMap->pEntries = (YAAF_HashMapEntry*) ptr;
+    pHashMap->pHashes = (uint32_t*)(ptr + sizeof(YAAF_HashMapEntry) * (size_t)capacity);
+    pHashMap->pCtrl = (uint8_t*)(pHashMap->pHashes + capacity);
+    memset(pHashMap->pCtrl, YAAF_HASHMAP_CTRL_EMPTY, capacity);
+    pHashMap->capacity = capacity;
+    pHashMap->growthLeft = capacity / 8 * 7;
+    pHashMap->count = 0;
+    return YAAF_SUCCESS;
+}
+
 void
 YAAF_HashMapInit(YAAF_HashMap* pHashMap,
                  const uint32_t initialCount)
 {
-
-    pHashMap->count = 0;
-    /* Use 0.75 load factor */
-    pHashMap->capacity = initialCount * 4/3;
-    pHashMap->pEntries = (YAAF_HashMapEntry*)YAAF_calloc(pHashMap->capacity, sizeof(YAAF_HashMapEntry));
+    YAAF_HashMapInitNoAlloc(pHashMap);
+    {
+        const uint32_t capacity = YAAF_HashMapCapacityFor(initialCount);
+        if (capacity)
+        {
+            YAAF_HashMapAlloc(pHashMap, capacity);
+        }
+    }
 }
 
 void
 YAAF_HashMapInitNoAlloc(YAAF_HashMap* pHashMap)
 {
+    pHashMap->pCtrl = NULL;
+    pHashMap->pEntries = NULL;
+    pHashMap->pHashes = NULL;
     pHashMap->count = 0;
     pHashMap->capacity = 0;
-    pHashMap->pEntries = NULL;
+    pHashMap->growthLeft = 0;
+    pHashMap->caseSensitive = 0;
 }
 
 void
@@ -68,129 +232,148 @@ YAAF_HashMapDestroy(YAAF_HashMap* pHashMap)
     if (pHashMap->pEntries)
     {
         YAAF_free(pHashMap->pEntries);
-        pHashMap->pEntries = NULL;
     }
-    pHashMap->capacity = 0;
-    pHashMap->count = 0;
+    YAAF_HashMapInitNoAlloc(pHashMap);
 }
 
-static uint32_t
-YAAF_HashMapCalculateIdx(const uint32_t hash,
-                         const uint32_t n,
-                         const uint32_t size)
+YAAF_FORCE_INLINE uint32_t
+YAAF_HashMapKeyHash(const YAAF_HashMap* pHashMap,
+                    const char* key,
+                    const size_t keyLen)
 {
-    /* use linear probing to find the best  */
-    return (hash + n) % size;
+    return pHashMap->caseSensitive ? YAAF_NameHashExact(key, keyLen) : YAAF_NameHash(key, keyLen);
 }
 
-static YAAF_HashMapEntry*
-YAAF_HashMapFindEntry(const YAAF_HashMap* pHashMap,
-                      const char* key,
-                      const uint32_t hash)
+static uint32_t
+YAAF_HashMapFindSlot(const YAAF_HashMap* pHashMap,
+                     const char* key,
+                     const size_t keyLen,
+                     const uint32_t hash)
 {
-    uint32_t hk = 0;
-    uint32_t i = 0;
-    YAAF_HashMapEntry* p_result = NULL;
+    const uint32_t group_mask = pHashMap->capacity / YAAF_HASHMAP_GROUP_SIZE - 1;
+    uint32_t group = YAAF_HASHMAP_H1(hash) & group_mask;
+    uint32_t i;
 
-    for(i = 0; i < pHashMap->capacity; ++i)
+    if (!pHashMap->capacity)
     {
-        hk =  YAAF_HashMapCalculateIdx(hash, i, pHashMap->capacity);
-        YAAF_HashMapEntry* p_cur_entry = &pHashMap->pEntries[hk];
+        return YAAF_HASHMAP_NOT_FOUND;
+    }
 
-        if (!p_cur_entry->pData)
-        {
-            /* No key found when data is NULL. exit loop */
-            break;
-        }
+    /* triangular probing visits every group once */
+    for (i = 0; i <= group_mask; ++i)
+    {
+        const uint8_t* p_ctrl = pHashMap->pCtrl + group * YAAF_HASHMAP_GROUP_SIZE;
+        uint64_t match = YAAF_HashMapGroupMatch(p_ctrl, YAAF_HASHMAP_H2(hash));
 
-        if (p_cur_entry->pData == YAAF_HASHMAP_ENTRY_DELETED(pHashMap))
+        while (match)
         {
-            /* Element was deleted, find next element */
-            continue;
+            const uint32_t idx = group * YAAF_HASHMAP_GROUP_SIZE + YAAF_HashMapMaskFirst(match);
+            const char* entry_key = pHashMap->pEntries[idx].key;
+            /* the key length is not stored to keep the entries small */
+            if (strlen(entry_key) == keyLen &&
+                    (pHashMap->caseSensitive ? memcmp(key, entry_key, keyLen) == 0 :
+                                               YAAF_StrEqualNoCaseN(key, entry_key, keyLen)))
+            {
+                return idx;
+            }
+            match &= match - 1;
         }
 
-        if (p_cur_entry->pData)
+        /* the key would have been stored in the first empty slot */
+        if (YAAF_HashMapGroupMatchEmpty(p_ctrl))
         {
-            /* check if the hashes match */
-            if (p_cur_entry->hash == hash
-                    && YAAF_StrCompareNoCase(key, p_cur_entry->key) == 0)
-            {
-                p_result = &pHashMap->pEntries[hk];
-                break;
-            }
+            break;
         }
-        /* continue loop */
+        group = (group + i + 1) & group_mask;
     }
-    return p_result;
+    return YAAF_HASHMAP_NOT_FOUND;
 }
 
 const void*
 YAAF_HashMapGet(const YAAF_HashMap* pHashMap,
                 const char* key)
 {
-    uint32_t hash = YAAF_OnceAtATimeHashNoCase(key);
-    YAAF_HashMapEntry* p_entry = NULL;
+    const size_t key_len = strlen(key);
+    const uint32_t idx = YAAF_HashMapFindSlot(pHashMap, key, key_len,
+                                                   YAAF_HashMapKeyHash(pHashMap, key, key_len));
+    return (idx != YAAF_HASHMAP_NOT_FOUND) ? pHashMap->pEntries[idx].pData : NULL;
+}
 
-    p_entry = YAAF_HashMapFindEntry(pHashMap, key, hash);
-    return (p_entry) ? p_entry->pData : NULL;
+const void*
+YAAF_HashMapGetWithHash(const YAAF_HashMap* pHashMap,
+                        const uint32_t hash,
+                        const char* key)
+{
+    const uint32_t idx = YAAF_HashMapFindSlot(pHashMap, key, strlen(key), hash);
+    return (idx != YAAF_HASHMAP_NOT_FOUND) ? pHashMap->pEntries[idx].pData : NULL;
 }
 
-static int
-YAAF_HashMapResizeIfNecessary(YAAF_HashMap* pHashMap)
+/* store a key which is not in the map yet, there has to be room left */
+static void
+YAAF_HashMapInsert(YAAF_HashMap* pHashMap,
+                   const uint32_t hash,
+                   const char* key,
+                   const void* pData)
 {
-    /* If the load factor exceeds 0.75... */
-    if (pHashMap->count > (pHashMap->capacity * 3 / 4))
+    const uint32_t group_mask = pHashMap->capacity / YAAF_HASHMAP_GROUP_SIZE - 1;
+    uint32_t group = YAAF_HASHMAP_H1(hash) & group_mask;
+    uint32_t i;
+
+    for (i = 0; i <= group_mask; ++i)
     {
-        /* Add an additional with a 0.33 load factor */
-        uint32_t new_capacity = pHashMap->capacity << 1;
-        YAAF_HashMapEntry* new_entries = NULL;
-        uint32_t i;
+        const uint8_t* p_ctrl = pHashMap->pCtrl + group * YAAF_HASHMAP_GROUP_SIZE;
+        const uint64_t match = YAAF_HashMapGroupMatchFree(p_ctrl);
 
-        /* check overflow */
-        if (new_capacity < pHashMap->capacity)
+        if (match)
         {
-            return YAAF_FAIL;
+            const uint32_t idx = group * YAAF_HASHMAP_GROUP_SIZE + YAAF_HashMapMaskFirst(match);
+            if (pHashMap->pCtrl[idx] == YAAF_HASHMAP_CTRL_EMPTY)
+            {
+                pHashMap->growthLeft--;
+            }
+            pHashMap->pCtrl[idx] = YAAF_HASHMAP_H2(hash);
+            pHashMap->pEntries[idx].pData = pData;
+            pHashMap->pEntries[idx].key = key;
+            pHashMap->pHashes[idx] = hash;
+            pHashMap->count++;
+            return;
         }
+        group = (group + i + 1) & group_mask;
+    }
+    YAAF_ASSERT(0 && "HashMap is full");
+}
 
-        /* create new entries */
-        new_entries = YAAF_calloc(1, sizeof(YAAF_HashMapEntry) * new_capacity);
-        if (!new_entries)
-        {
-            return YAAF_FAIL;
-        }
+static int
+YAAF_HashMapResizeIfNecessary(YAAF_HashMap* pHashMap)
+{
+    YAAF_HashMap new_map;
+    uint32_t i, new_capacity;
+
+    if (pHashMap->growthLeft)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    /* double the capacity, or only drop the deleted slots when the map
+     * holds few entries */
+    new_capacity = YAAF_HashMapCapacityFor((uint64_t)pHashMap->count * 2 + 1);
+    if (!new_capacity || YAAF_HashMapAlloc(&new_map, new_capacity) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
 
-        /* copy over existing entries*/
-        for (i = 0; i < pHashMap->capacity; i++)
+    for (i = 0; i < pHashMap->capacity; ++i)
+    {
+        if (YAAF_HASHMAP_CTRL_IS_FULL(pHashMap->pCtrl[i]))
         {
-            YAAF_HashMapEntry* cur_entry = &pHashMap->pEntries[i];
-            if (cur_entry->pData != NULL && cur_entry->pData != YAAF_HASHMAP_ENTRY_DELETED(pHashMap))
-            {
-                uint32_t j=0;
-                YAAF_HashMapEntry* new_entry = NULL;
-                uint32_t idx =0;
-
-                for(j = 0; j < pHashMap->capacity; ++j)
-                {
-                    idx = YAAF_HashMapCalculateIdx(cur_entry->hash, j, new_capacity);
-                    new_entry = &new_entries[idx];
-                    /* insert new element if the location is empty */
-                    if (!new_entry->pData)
-                    {
-                        new_entry->key = cur_entry->key;
-                        new_entry->pData = cur_entry->pData;
-                        new_entry->hash = cur_entry->hash;
-                        break;
-                    }
-                }
-            }
+            YAAF_HashMapInsert(&new_map, pHashMap->pHashes[i],
+                               pHashMap->pEntries[i].key, pHashMap->pEntries[i].pData);
         }
-
-        /* release old data */
-        YAAF_free(pHashMap->pEntries);
-        pHashMap->pEntries = new_entries;
-        pHashMap->capacity = new_capacity;
     }
 
+    new_map.caseSensitive = pHashMap->caseSensitive;
+    YAAF_HashMapDestroy(pHashMap);
+    *pHashMap = new_map;
     return YAAF_SUCCESS;
 }
 
@@ -200,7 +383,7 @@ YAAF_HashMapPut(YAAF_HashMap* pHashMap,
                 const char* key,
                 const void* pData)
 {
-    uint32_t hash = YAAF_OnceAtATimeHashNoCase(key);
+    uint32_t hash = YAAF_HashMapKeyHash(pHashMap, key, strlen(key));
     return YAAF_HashMapPutWithHash(pHashMap, hash, key, pData);
 }
 
@@ -209,105 +392,82 @@ int YAAF_HashMapPutWithHash(YAAF_HashMap*  pHashMap,
                             const char*    key,
                             const void*    pData)
 {
-    uint32_t i = 0;
-    YAAF_HashMapEntry* new_entry = NULL;
-    uint32_t idx = 0;
+    const uint32_t idx = YAAF_HashMapFindSlot(pHashMap, key, strlen(key), hash);
 
-    /* Reize if necessary, also checks against overflow */
-    if(YAAF_HashMapResizeIfNecessary(pHashMap) == YAAF_FAIL)
+    /* replace contents when the key is already present */
+    if (idx != YAAF_HASHMAP_NOT_FOUND)
     {
-        return YAAF_FAIL;
+        pHashMap->pEntries[idx].pData = pData;
+        return YAAF_SUCCESS;
     }
 
-    for(i = 0; i < pHashMap->capacity; ++i)
+    /* Reize if necessary, also checks against overflow */
+    if(YAAF_HashMapResizeIfNecessary(pHashMap) == YAAF_FAIL)
     {
-        /* get index */
-        idx = YAAF_HashMapCalculateIdx(hash, i, pHashMap->capacity);
-        new_entry = &(pHashMap->pEntries[idx]);
-        /* insert new element if the location is empty */
-        if (!new_entry->pData || new_entry->pData == YAAF_HASHMAP_ENTRY_DELETED(pHashMap))
-        {
-            new_entry->pData = pData;
-            new_entry->key = key;
-            new_entry->hash = hash;
-            pHashMap->count++;
-            return YAAF_SUCCESS;
-        }
-
-        /* replace contents when hashes match */
-        if (new_entry->hash == hash)
-        {
-            new_entry->pData = pData;
-            return YAAF_SUCCESS;
-        }
-        /* continue loop */
+        return YAAF_FAIL;
     }
 
-    return YAAF_FAIL;
+    YAAF_HashMapInsert(pHashMap, hash, key, pData);
+    return YAAF_SUCCESS;
 }
 
 int
 YAAF_HashMapRemove(YAAF_HashMap* pHashMap,
                    const char* key)
 {
-    YAAF_HashMapEntry* p_entry = NULL;
-    uint32_t hash = YAAF_OnceAtATimeHashNoCase(key);
-    p_entry = YAAF_HashMapFindEntry(pHashMap, key, hash);
+    const size_t key_len = strlen(key);
+    const uint32_t idx = YAAF_HashMapFindSlot(pHashMap, key, key_len,
+                                                   YAAF_HashMapKeyHash(pHashMap, key, key_len));
+    const uint8_t* p_group;
 
-    if (p_entry)
+    if (idx == YAAF_HASHMAP_NOT_FOUND)
     {
-        p_entry->hash = 0;
-        p_entry->key = NULL;
-        p_entry->pData = YAAF_HASHMAP_ENTRY_DELETED(pHashMap);
-        pHashMap->count--;
-        return YAAF_SUCCESS;
+        return YAAF_FAIL;
     }
 
-    return YAAF_FAIL;
+    /* lookups stop at groups with an empty slot, so the slot only has to be
+     * marked as deleted when its group is full */
+    p_group = pHashMap->pCtrl + (idx & ~(uint32_t)(YAAF_HASHMAP_GROUP_SIZE - 1));
+    if (YAAF_HashMapGroupMatchEmpty(p_group))
+    {
+        pHashMap->pCtrl[idx] = YAAF_HASHMAP_CTRL_EMPTY;
+        pHashMap->growthLeft++;
+    }
+    else
+    {
+        pHashMap->pCtrl[idx] = YAAF_HASHMAP_CTRL_DELETED;
+    }
+    pHashMap->pEntries[idx].pData = NULL;
+    pHashMap->pEntries[idx].key = NULL;
+    pHashMap->count--;
+    return YAAF_SUCCESS;
+}
+
+static const YAAF_HashMapEntry*
+YAAF_HashMapItFind(const YAAF_HashMap* pHashMap,
+                   uint32_t idx)
+{
+    while (idx < pHashMap->capacity && !YAAF_HASHMAP_CTRL_IS_FULL(pHashMap->pCtrl[idx]))
+    {
+        ++idx;
+    }
+    return pHashMap->pEntries + idx;
 }
 
 const YAAF_HashMapEntry*
 YAAF_HashMapItBegin(const YAAF_HashMap* pHashMap)
 {
-    const YAAF_HashMapEntry* ptr, *ptr_end;
     YAAF_ASSERT(pHashMap->pEntries);
-
-    ptr= pHashMap->pEntries;
-    ptr_end = pHashMap->pEntries + pHashMap->capacity;
-
-    while(ptr < ptr_end)
-    {
-        if (ptr->pData && ptr->pData != YAAF_HASHMAP_ENTRY_DELETED(pHashMap))
-        {
-            return ptr;
-        }
-        ++ptr;
-    }
-    return ptr_end;
+    return YAAF_HashMapItFind(pHashMap, 0);
 }
 
 void
 YAAF_HashMapItNext(const YAAF_HashMap* pHashMap,
                    const YAAF_HashMapEntry** pIter)
 {
-    const YAAF_HashMapEntry* ptr_end;
-    const YAAF_HashMapEntry* ptr;
     YAAF_ASSERT(pIter && *pIter);
     YAAF_ASSERT(pHashMap->pEntries);
-
-    ptr = *pIter;
-    ptr_end = pHashMap->pEntries + pHashMap->capacity;
-    ++ptr;
-    while(ptr < ptr_end)
-    {
-        if (ptr->pData && ptr->pData != YAAF_HASHMAP_ENTRY_DELETED(pHashMap))
-        {
-            *pIter = ptr;
-            return;
-        }
-        ++ptr;
-    }
-    *pIter = ptr_end;
+    *pIter = YAAF_HashMapItFind(pHashMap, (uint32_t)(*pIter - pHashMap->pEntries) + 1);
 }
 
 const YAAF_HashMapEntry*
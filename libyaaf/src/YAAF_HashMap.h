@@ -42,17 +42,25 @@ typedef struct YAAF_HashMapEntry YAAF_HashMapEntry;
  * Implementation of an Open Addresing HashMap for YAAF.
  *
  * The hashmap only holds pointers, it does not allocate any data
- * besides the array in which the entries are stored.
+ * besides the arrays in which the entries are stored.
  *
- * The capacity of the hashmap is maitained at 75% capacity to
- * increase the efficiency of linear probing method.
+ * Every slot has a control byte holding the lower 7 bits of the hash of its
+ * key, or marking it as empty or deleted. The control bytes are probed a
+ * group of 16 slots at a time (SSE2, NEON or a scalar fallback), so the
+ * entries are only touched when the 7 bit tags match. The groups are
+ * visited with triangular probing and the capacity is a power of 2 kept
+ * below 87.5% load.
  */
 
 typedef struct
 {
+    uint8_t* pCtrl;
     YAAF_HashMapEntry* pEntries;
+    uint32_t* pHashes; /* full hash of each entry, only used to grow */
     uint32_t count;
     uint32_t capacity;
+    uint32_t growthLeft; /* empty slots that can still be used */
+    int caseSensitive; /* compare keys byte for byte, set before use */
 } YAAF_HashMap;
 
 
@@ -63,9 +71,15 @@ void YAAF_HashMapInitNoAlloc(YAAF_HashMap* pHashMap);
 
 void YAAF_HashMapDestroy(YAAF_HashMap* pHashMap);
 
+/* Keys are hashed with YAAF_NameHash(), or YAAF_NameHashExact() when the map
+ * is case sensitive, unless the hash is provided */
 const void *YAAF_HashMapGet(const YAAF_HashMap *pHashMap,
                             const char*         key);
 
+const void *YAAF_HashMapGetWithHash(const YAAF_HashMap *pHashMap,
+                                    const uint32_t      hash,
+                                    const char*         key);
+
 int YAAF_HashMapPut(YAAF_HashMap* pHashMap,
                     const char*   key,
                     const void*   pData);
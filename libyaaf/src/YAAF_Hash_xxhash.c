@@ -35,9 +35,18 @@
 
 void
 YAAF_HashStateReset(YAAF_HashState_t* pState,
+                    const int algorithm,
                     const uint32_t seed)
 {
-    XXH32_reset(pState, seed);
+    pState->algorithm = algorithm;
+    if (algorithm == YAAF_HASH_XXH64)
+    {
+        XXH64_reset(&pState->u.state64, seed);
+    }
+    else
+    {
+        XXH32_reset(&pState->u.state32, seed);
+    }
 }
 
 int
@@ -45,13 +54,18 @@ YAAF_HashStateUpdate(YAAF_HashState_t* pState,
                      const void* input,
                      const uint32_t size)
 {
-    return (XXH32_update(pState, input, size) == XXH_OK) ? YAAF_SUCCESS : YAAF_FAIL;
+    const XXH_errorcode result = (pState->algorithm == YAAF_HASH_XXH64) ?
+                XXH64_update(&pState->u.state64, input, size) :
+                XXH32_update(&pState->u.state32, input, size);
+    return (result == XXH_OK) ? YAAF_SUCCESS : YAAF_FAIL;
 }
 
-uint32_t
+uint64_t
 YAAF_HashStateDigest(YAAF_HashState_t* pState)
 {
-    return XXH32_digest(pState);
+    return (pState->algorithm == YAAF_HASH_XXH64) ?
+                XXH64_digest(&pState->u.state64) :
+                XXH32_digest(&pState->u.state32);
 }
 
 uint32_t
@@ -62,4 +76,13 @@ YAAF_Hash(const void* input,
     return XXH32(input, size, seed);
 }
 
+uint64_t
+YAAF_HashEx(const int algorithm,
+            const void* input,
+            const uint32_t size,
+            const uint32_t seed)
+{
+    return (algorithm == YAAF_HASH_XXH64) ? XXH64(input, size, seed) : XXH32(input, size, seed);
+}
+
 #endif
@@ -33,5 +33,13 @@
 #define __YAAF_HASH_XXHASH_H__
 
 #include <xxhash.h>
-typedef XXH32_state_t YAAF_HashState_t;
+typedef struct
+{
+  int algorithm;
+  union
+  {
+    XXH32_state_t state32;
+    XXH64_state_t state64;
+  } u;
+} YAAF_HashState_t;
 #endif
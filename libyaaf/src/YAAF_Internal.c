@@ -33,8 +33,13 @@
 #include "YAAF.h"
 #include "YAAF_Internal.h"
 #include "YAAF_TLS.h"
+#include "YAAF_Thread.h"
 
 #include <sys/stat.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YAAF_HAVE_SSE2
+#endif
 
 
 static YAAF_Allocator YAAF_gpAllocator;
@@ -68,7 +73,8 @@ YAAF_Init(const YAAF_Allocator* pAlloc)
         YAAF_gpAllocator.free = free;
     }
 
-    if (YAAF_TLSCreate(&YAAF_gErrorTLS) == YAAF_SUCCESS)
+    if (YAAF_TLSCreate(&YAAF_gErrorTLS) == YAAF_SUCCESS &&
+            YAAF_ThreadInit() == YAAF_SUCCESS)
     {
         return YAAF_TLSSet(YAAF_gErrorTLS, NULL);
     }
@@ -78,6 +84,7 @@ YAAF_Init(const YAAF_Allocator* pAlloc)
 void
 YAAF_Shutdown()
 {
+    YAAF_ThreadShutdown();
     YAAF_TLSDestroy(YAAF_gErrorTLS);
 }
 
@@ -117,6 +124,65 @@ YAAF_StrCompareNoCase(const char* str1, const char* str2)
 #endif
 }
 
+int
+YAAF_StrNCompareNoCase(const char* str1, const char* str2, const size_t n)
+{
+#if defined(YAAF_HAVE_STRCASECMP)
+    return strncasecmp(str1, str2, n);
+#elif defined(YAAF_HAVE_STRICMP)
+    return _strnicmp(str1, str2, n);
+#else
+#error No implementation of string case insentive compare
+#endif
+}
+
+int
+YAAF_StrEqualNoCaseN(const char* str1, const char* str2, const size_t len)
+{
+    size_t i = 0;
+    uint64_t word1, word2;
+
+#if defined(YAAF_HAVE_SSE2)
+    {
+        /* set 0x20 in the upper case ASCII letters of 16 bytes */
+        const __m128i before_a = _mm_set1_epi8('A' - 1);
+        const __m128i after_z = _mm_set1_epi8('Z' + 1);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(str1 + i));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(str2 + i));
+            v1 = _mm_or_si128(v1, _mm_and_si128(case_bit, _mm_and_si128(_mm_cmpgt_epi8(v1, before_a),
+                                                                         _mm_cmplt_epi8(v1, after_z))));
+            v2 = _mm_or_si128(v2, _mm_and_si128(case_bit, _mm_and_si128(_mm_cmpgt_epi8(v2, before_a),
+                                                                         _mm_cmplt_epi8(v2, after_z))));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) != 0xFFFF)
+            {
+                return 0;
+            }
+        }
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8)
+    {
+        memcpy(&word1, str1 + i, 8);
+        memcpy(&word2, str2 + i, 8);
+        if (YAAF_FoldAscii64(word1) != YAAF_FoldAscii64(word2))
+        {
+            return 0;
+        }
+    }
+
+    /* the last bytes, overlapping the ones already compared */
+    if (i < len)
+    {
+        return YAAF_FoldAscii64(YAAF_LoadTail64(str1, len)) ==
+                YAAF_FoldAscii64(YAAF_LoadTail64(str2, len));
+    }
+    return 1;
+}
+
 int
 YAAF_StrContainsChr(const char* str, const char chr)
 {
@@ -138,11 +204,17 @@ int
 YAAF_GetFileSize(size_t* out,
                  const char* path)
 {
+#if defined(YAAF_OS_WIN)
+    struct _stat64 stat_inf;
+    if (_stat64(path, &stat_inf) == 0 && S_ISREG(stat_inf.st_mode) &&
+#else
     struct stat stat_inf;
     /* only get size information if it is a regular file */
-    if (stat(path, &stat_inf) == 0 && S_ISREG(stat_inf.st_mode))
+    if (stat(path, &stat_inf) == 0 && S_ISREG(stat_inf.st_mode) &&
+#endif
+            (uint64_t)stat_inf.st_size <= (uint64_t)((size_t)-1))
     {
-        *out = stat_inf.st_size;
+        *out = (size_t)stat_inf.st_size;
         return YAAF_SUCCESS;
     }
     return YAAF_FAIL;
@@ -37,6 +37,8 @@
 #define YAAF_BLOCK_SIZE (128 * 1024)
 #define YAAF_BLOCK_CACHE_SIZE_RD YAAF_BLOCK_SIZE
 #define YAAF_BLOCK_CACHE_SIZE_WR (YAAF_BLOCK_SIZE + (8 * 1024))
+#define YAAF_DEFAULT_READAHEAD 4
+#define YAAF_DEFAULT_DIRECT_CACHE_SIZE (16 * 1024 * 1024)
 
 
 #define YAAF_PTR_OFFSET(ptr, offset) (((char*)ptr) + offset)
@@ -89,6 +91,48 @@ void* YAAF_calloc(size_t nmb,
 int YAAF_StrCompareNoCase(const char* str1,
                           const char* str2);
 
+int YAAF_StrNCompareNoCase(const char* str1,
+                           const char* str2,
+                           const size_t n);
+
+/* Lower case the ASCII letters of 8 bytes at once, other bytes are kept */
+YAAF_FORCE_INLINE uint64_t
+YAAF_FoldAscii64(const uint64_t word)
+{
+    const uint64_t heptets = word & 0x7F7F7F7F7F7F7F7Full;
+    /* the top bit of each byte is set for bytes above 'Z' and from 'A' */
+    const uint64_t above_z = heptets + 0x2525252525252525ull;
+    const uint64_t from_a = heptets + 0x3F3F3F3F3F3F3F3Full;
+    const uint64_t upper = ~word & (above_z ^ from_a) & 0x8080808080808080ull;
+    return word | (upper >> 2);
+}
+
+/* Little endian 64 bit word of the last len bytes of the string, len < 8
+ * bytes are zero padded. Longer strings load the last 8 bytes at once */
+YAAF_FORCE_INLINE uint64_t
+YAAF_LoadTail64(const char* str,
+                const size_t len)
+{
+    uint64_t word = 0;
+    size_t i;
+    if (len >= 8)
+    {
+        memcpy(&word, str + len - 8, 8);
+        return YAAF_LITTLE_E64(word);
+    }
+    for (i = len; i > 0; --i)
+    {
+        word = (word << 8) | (uint8_t)str[i - 1];
+    }
+    return word;
+}
+
+/* Compare len bytes of both strings ignoring the case of ASCII letters,
+ * both strings have to hold at least len bytes. Returns 1 if equal */
+int YAAF_StrEqualNoCaseN(const char* str1,
+                         const char* str2,
+                         const size_t len);
+
 int YAAF_StrContainsChr(const char* str,
                         const char chr);
 
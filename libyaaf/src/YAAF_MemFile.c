@@ -29,9 +29,339 @@
  * You can contact the author at :
  * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
  */
+#if !defined(_GNU_SOURCE)
+/* posix_madvise(), posix_fadvise(), MAP_ANONYMOUS, MAP_POPULATE,
+   MADV_HUGEPAGE and O_DIRECT */
+#define _GNU_SOURCE 1
+#endif
+
 #include "YAAF_MemFile.h"
 #include "YAAF.h"
 #include "YAAF_Internal.h"
+#include "YAAF_Thread.h"
+
+/* Regions read from a file that is not mapped, freed on close */
+typedef union YAAF_MemFileRegionHdr
+{
+    union YAAF_MemFileRegionHdr* pNext;
+    uint64_t align;
+} YAAF_MemFileRegionHdr;
+
+static void
+YAAF_MemFileFreeRegions(YAAF_MemFile* pFile)
+{
+    YAAF_MemFileRegionHdr* p_region = (YAAF_MemFileRegionHdr*) pFile->pRegions;
+    while (p_region)
+    {
+        YAAF_MemFileRegionHdr* p_next = p_region->pNext;
+        YAAF_free(p_region);
+        p_region = p_next;
+    }
+    pFile->pRegions = NULL;
+}
+
+/* Windows are mapped at multiples of the window size and overlap the next
+ * window by more than a block, so that blocks never straddle two windows */
+#define YAAF_MEMFILE_WINDOW_SIZE (64 * 1024 * 1024)
+#define YAAF_MEMFILE_WINDOW_OVERLAP (8 * YAAF_BLOCK_SIZE)
+#define YAAF_MEMFILE_WINDOW_COUNT 4
+
+/* Chunks of the direct read cache, multiple of the direct I/O alignment */
+#define YAAF_MEMFILE_CHUNK_SIZE (256 * 1024)
+#define YAAF_MEMFILE_CHUNK_MIN_COUNT 4
+#define YAAF_MEMFILE_DIRECT_ALIGN 4096
+
+typedef struct YAAF_MemFileWindow
+{
+    const char* ptr;
+    uint64_t offset;
+    size_t size;
+    uint64_t lastUse;
+    uint32_t nPins;
+    int loading;
+} YAAF_MemFileWindow;
+
+/* LRU of the windows of a file, either mapped views (YAAF_MAP_WINDOWED) or
+ * chunks read into the cache memory (YAAF_MAP_DIRECT) */
+typedef struct YAAF_MemFileWindows
+{
+    YAAF_Mutex mutex;
+    YAAF_Cond condLoaded;
+    uint64_t clock;
+    uint64_t windowSize;
+    uint64_t overlap;
+    uint32_t nWindows;
+    void* pAlloc;
+    char* pMemory;
+    YAAF_MemFileWindow* pWindows;
+} YAAF_MemFileWindows;
+
+/* Platform specific, return NULL or YAAF_FAIL on failure without setting
+ * the error */
+static const void* YAAF_MemFileMapView(const YAAF_MemFile* pFile,
+                                       const uint64_t offset,
+                                       const size_t size);
+
+static void YAAF_MemFileUnmapView(const void* ptr,
+                                  const size_t size);
+
+static int YAAF_MemFileReadAtLeast(const YAAF_MemFile* pFile,
+                                   const uint64_t offset,
+                                   const size_t size,
+                                   const size_t minSize,
+                                   void* pBuffer);
+
+static uint32_t
+YAAF_MemFileChunkCount(const uint64_t cacheSize)
+{
+    const uint64_t n_chunks = cacheSize / YAAF_MEMFILE_CHUNK_SIZE;
+    return (n_chunks > YAAF_MEMFILE_CHUNK_MIN_COUNT) ? (uint32_t)n_chunks : YAAF_MEMFILE_CHUNK_MIN_COUNT;
+}
+
+static int
+YAAF_MemFileCreateWindows(YAAF_MemFile* pFile,
+                          const uint64_t windowSize,
+                          const uint64_t overlap,
+                          const uint32_t nWindows,
+                          const int direct)
+{
+    YAAF_MemFileWindows* p_windows = (YAAF_MemFileWindows*)
+            YAAF_malloc(sizeof(YAAF_MemFileWindows) + nWindows * sizeof(YAAF_MemFileWindow));
+    if (!p_windows)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to allocate memory for windows");
+        return YAAF_FAIL;
+    }
+
+    memset(p_windows, 0, sizeof(YAAF_MemFileWindows) + nWindows * sizeof(YAAF_MemFileWindow));
+    p_windows->windowSize = windowSize;
+    p_windows->overlap = overlap;
+    p_windows->nWindows = nWindows;
+    p_windows->pWindows = (YAAF_MemFileWindow*)(p_windows + 1);
+
+    if (direct)
+    {
+        /* direct I/O needs aligned buffers */
+        p_windows->pAlloc = YAAF_malloc((size_t)(nWindows * windowSize) + YAAF_MEMFILE_DIRECT_ALIGN);
+        if (!p_windows->pAlloc)
+        {
+            YAAF_SetError("[YAAF MemFile] Failed to allocate memory for the cache");
+            YAAF_free(p_windows);
+            return YAAF_FAIL;
+        }
+        p_windows->pMemory = (char*)(((uintptr_t)p_windows->pAlloc + YAAF_MEMFILE_DIRECT_ALIGN - 1) &
+                                     ~(uintptr_t)(YAAF_MEMFILE_DIRECT_ALIGN - 1));
+    }
+
+    if (YAAF_MutexInit(&p_windows->mutex) != YAAF_SUCCESS ||
+            YAAF_CondInit(&p_windows->condLoaded) != YAAF_SUCCESS)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to create windows mutex");
+        if (p_windows->pAlloc)
+        {
+            YAAF_free(p_windows->pAlloc);
+        }
+        YAAF_free(p_windows);
+        return YAAF_FAIL;
+    }
+    pFile->pWindows = p_windows;
+    return YAAF_SUCCESS;
+}
+
+static void
+YAAF_MemFileDestroyWindows(YAAF_MemFile* pFile)
+{
+    YAAF_MemFileWindows* p_windows = (YAAF_MemFileWindows*) pFile->pWindows;
+    uint32_t i;
+
+    if (!p_windows)
+    {
+        return;
+    }
+
+    for (i = 0; i < p_windows->nWindows && !p_windows->pMemory; ++i)
+    {
+        if (p_windows->pWindows[i].ptr)
+        {
+            YAAF_MemFileUnmapView(p_windows->pWindows[i].ptr, p_windows->pWindows[i].size);
+        }
+    }
+    YAAF_CondDestroy(&p_windows->condLoaded);
+    YAAF_MutexDestroy(&p_windows->mutex);
+    if (p_windows->pAlloc)
+    {
+        YAAF_free(p_windows->pAlloc);
+    }
+    YAAF_free(p_windows);
+    pFile->pWindows = NULL;
+}
+
+/* Get the window starting at start pinned, mapping or reading it if needed.
+ * Returns NULL if all windows are pinned or it could not be loaded. */
+static YAAF_MemFileWindow*
+YAAF_MemFileWindowAcquire(const YAAF_MemFile* pFile,
+                          YAAF_MemFileWindows* pWindows,
+                          const uint64_t start)
+{
+    YAAF_MemFileWindow* p_window = NULL;
+    const char* old_ptr;
+    size_t old_size, size;
+    const void* ptr;
+    uint32_t i;
+
+    YAAF_MutexLock(&pWindows->mutex);
+    for (;;)
+    {
+        p_window = NULL;
+        for (i = 0; i < pWindows->nWindows; ++i)
+        {
+            if (pWindows->pWindows[i].offset == start &&
+                    (pWindows->pWindows[i].ptr || pWindows->pWindows[i].loading))
+            {
+                p_window = &pWindows->pWindows[i];
+                break;
+            }
+        }
+
+        if (!p_window || !p_window->loading)
+        {
+            break;
+        }
+        /* another thread is loading the window */
+        YAAF_CondWait(&pWindows->condLoaded, &pWindows->mutex);
+    }
+
+    if (p_window)
+    {
+        ++p_window->nPins;
+        p_window->lastUse = ++pWindows->clock;
+        YAAF_MutexUnlock(&pWindows->mutex);
+        return p_window;
+    }
+
+    /* replace the least recently used window which is not in use */
+    for (i = 0; i < pWindows->nWindows; ++i)
+    {
+        if (pWindows->pWindows[i].nPins == 0 &&
+                (!p_window || pWindows->pWindows[i].lastUse < p_window->lastUse))
+        {
+            p_window = &pWindows->pWindows[i];
+        }
+    }
+
+    if (!p_window)
+    {
+        YAAF_MutexUnlock(&pWindows->mutex);
+        return NULL;
+    }
+
+    size = (pFile->size - start < pWindows->windowSize + pWindows->overlap) ?
+                (size_t)(pFile->size - start) : (size_t)(pWindows->windowSize + pWindows->overlap);
+    old_ptr = p_window->ptr;
+    old_size = p_window->size;
+    p_window->ptr = NULL;
+    p_window->offset = start;
+    p_window->size = size;
+    p_window->loading = 1;
+    p_window->nPins = 1;
+    p_window->lastUse = ++pWindows->clock;
+    YAAF_MutexUnlock(&pWindows->mutex);
+
+    /* load outside of the lock, other windows stay available */
+    if (pWindows->pMemory)
+    {
+        char* p_memory = pWindows->pMemory + (size_t)(p_window - pWindows->pWindows) * pWindows->windowSize;
+        const size_t aligned_size = (size + YAAF_MEMFILE_DIRECT_ALIGN - 1) & ~(size_t)(YAAF_MEMFILE_DIRECT_ALIGN - 1);
+        ptr = (YAAF_MemFileReadAtLeast(pFile, start, aligned_size, size, p_memory) == YAAF_SUCCESS) ? p_memory : NULL;
+    }
+    else
+    {
+        if (old_ptr)
+        {
+            YAAF_MemFileUnmapView(old_ptr, old_size);
+        }
+        ptr = YAAF_MemFileMapView(pFile, start, size);
+    }
+
+    YAAF_MutexLock(&pWindows->mutex);
+    p_window->ptr = (const char*) ptr;
+    p_window->loading = 0;
+    if (!ptr)
+    {
+        p_window->nPins = 0;
+        p_window->lastUse = 0;
+        p_window = NULL;
+    }
+    YAAF_CondBroadcast(&pWindows->condLoaded);
+    YAAF_MutexUnlock(&pWindows->mutex);
+    return p_window;
+}
+
+static void
+YAAF_MemFileWindowRelease(YAAF_MemFileWindows* pWindows,
+                          YAAF_MemFileWindow* pWindow)
+{
+    YAAF_MutexLock(&pWindows->mutex);
+    --pWindow->nPins;
+    YAAF_MutexUnlock(&pWindows->mutex);
+}
+
+/* Copy a range through the direct read cache. Chunks which can not be cached
+ * are read into temporary memory. */
+static int
+YAAF_MemFileReadCached(const YAAF_MemFile* pFile,
+                       uint64_t offset,
+                       size_t size,
+                       void* pBuffer)
+{
+    YAAF_MemFileWindows* p_windows = (YAAF_MemFileWindows*) pFile->pWindows;
+    char* p_output = (char*) pBuffer;
+
+    while (size)
+    {
+        const uint64_t start = offset - (offset % p_windows->windowSize);
+        const size_t chunk_offset = (size_t)(offset - start);
+        const size_t n = (size < p_windows->windowSize - chunk_offset) ? size : (size_t)(p_windows->windowSize - chunk_offset);
+        YAAF_MemFileWindow* p_window = YAAF_MemFileWindowAcquire(pFile, p_windows, start);
+
+        if (p_window)
+        {
+            memcpy(p_output, p_window->ptr + chunk_offset, n);
+            YAAF_MemFileWindowRelease(p_windows, p_window);
+        }
+        else
+        {
+            const size_t aligned_size = (chunk_offset + n + YAAF_MEMFILE_DIRECT_ALIGN - 1) & ~(size_t)(YAAF_MEMFILE_DIRECT_ALIGN - 1);
+            char* p_alloc = (char*) YAAF_malloc(aligned_size + YAAF_MEMFILE_DIRECT_ALIGN);
+            char* p_tmp;
+            int result;
+
+            if (!p_alloc)
+            {
+                YAAF_SetError("[YAAF MemFile] Failed to allocate memory for read");
+                return YAAF_FAIL;
+            }
+            p_tmp = (char*)(((uintptr_t)p_alloc + YAAF_MEMFILE_DIRECT_ALIGN - 1) &
+                            ~(uintptr_t)(YAAF_MEMFILE_DIRECT_ALIGN - 1));
+            result = YAAF_MemFileReadAtLeast(pFile, start, aligned_size, chunk_offset + n, p_tmp);
+            if (result == YAAF_SUCCESS)
+            {
+                memcpy(p_output, p_tmp + chunk_offset, n);
+            }
+            YAAF_free(p_alloc);
+            if (result != YAAF_SUCCESS)
+            {
+                YAAF_SetError("[YAAF MemFile] Failed to read file");
+                return YAAF_FAIL;
+            }
+        }
+
+        p_output += n;
+        offset += n;
+        size -= n;
+    }
+    return YAAF_SUCCESS;
+}
 
 #if defined(YAAF_HAVE_MMAN_H)
 #include <sys/mman.h>
@@ -40,38 +370,181 @@
 #include <errno.h>
 #include <unistd.h>
 
+/* Read the whole file into anonymous memory */
+static int
+YAAF_MemFileLoad(YAAF_MemFile* pFile,
+                 const int handle,
+                 const size_t size,
+                 const uint32_t flags)
+{
+    size_t bytes_read = 0;
+    void* ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to allocate memory for file");
+        return YAAF_FAIL;
+    }
+
+#if defined(MADV_HUGEPAGE)
+    /* needs to be set before the pages are touched */
+    if (flags & YAAF_MAP_HUGEPAGES)
+    {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#else
+    (void) flags;
+#endif
+
+    while (bytes_read < size)
+    {
+        const ssize_t res = read(handle, (char*)ptr + bytes_read, size - bytes_read);
+        if (res <= 0)
+        {
+            if (res == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            YAAF_SetError("[YAAF MemFile] Failed to read file");
+            munmap(ptr, size);
+            return YAAF_FAIL;
+        }
+        bytes_read += (size_t)res;
+    }
+
+    mprotect(ptr, size, PROT_READ);
+    pFile->ptr = ptr;
+    pFile->size = size;
+    pFile->oshdl = -1;
+    pFile->closeop = YAAF_MEMFILE_CLOSE_UNMAP;
+    return YAAF_SUCCESS;
+}
+
+static int
+YAAF_MemFileMap(YAAF_MemFile* pFile,
+                const int handle,
+                const size_t size,
+                const uint32_t flags)
+{
+    int mmap_flags = MAP_SHARED;
+    void* ptr;
+
+#if defined(MAP_POPULATE)
+    if (flags & YAAF_MAP_POPULATE)
+    {
+        mmap_flags |= MAP_POPULATE;
+    }
+#endif
+
+    ptr = mmap(0, size, PROT_READ, mmap_flags, handle, 0);
+    if (ptr == MAP_FAILED)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to map file");
+        return YAAF_FAIL;
+    }
+
+#if defined(MADV_HUGEPAGE)
+    /* only honoured by kernels with huge pages for the page cache */
+    if (flags & YAAF_MAP_HUGEPAGES)
+    {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#endif
+
+#if !defined(MAP_POPULATE)
+    if (flags & YAAF_MAP_POPULATE)
+    {
+        posix_madvise(ptr, size, POSIX_MADV_WILLNEED);
+    }
+#endif
+
+    pFile->ptr = ptr;
+    pFile->size = size;
+    pFile->oshdl = handle;
+    pFile->closeop = YAAF_MEMFILE_CLOSE_FILE;
+    return YAAF_SUCCESS;
+}
+
 int
 YAAF_MemFileOpen(YAAF_MemFile* pFile,
                  const char* path)
+{
+    return YAAF_MemFileOpenEx(pFile, path, 0, 0);
+}
+
+int
+YAAF_MemFileOpenEx(YAAF_MemFile* pFile,
+                   const char* path,
+                   const uint32_t flags,
+                   const uint64_t cacheSize)
 {
     int result = YAAF_FAIL;
     size_t file_size = 0;
     int handle = -1;
+    pFile->ptr = NULL;
+    pFile->oshdl = -1;
+    pFile->pRegions = NULL;
+    pFile->pWindows = NULL;
     pFile->closeop = YAAF_MEMFILE_CLOSE_FILE;
     if (YAAF_GetFileSize(&file_size, path) == YAAF_SUCCESS)
     {
-        int file_flags  = O_RDONLY;
-        int mmap_flags = PROT_READ;
-
-        handle = open(path, file_flags);
+        handle = open(path, O_RDONLY);
         if (handle  == -1)
         {
             YAAF_SetError("[YAAF MemFile] Could not open requested file");
         }
-        else
+        else if (flags & YAAF_MAP_PREAD)
         {
-            void *ptr = mmap(0, file_size, mmap_flags, MAP_SHARED, handle, 0);
-            if (ptr == MAP_FAILED)
+            /* nothing is mapped, the data is read on request */
+            pFile->size = file_size;
+            pFile->oshdl = handle;
+            return YAAF_SUCCESS;
+        }
+        else if (flags & YAAF_MAP_DIRECT)
+        {
+            /* bypass the page cache, the chunks are cached by the file */
+#if defined(O_DIRECT)
+            const int handle_direct = open(path, O_RDONLY | O_DIRECT);
+            /* not every file system supports direct I/O */
+            if (handle_direct != -1)
             {
-                YAAF_SetError("[YAAF MemFile] Failed to map file");
+                close(handle);
+                handle = handle_direct;
             }
-            else
+#elif defined(F_NOCACHE)
+            fcntl(handle, F_NOCACHE, 1);
+#endif
+            pFile->size = file_size;
+            pFile->oshdl = handle;
+            result = YAAF_MemFileCreateWindows(pFile, YAAF_MEMFILE_CHUNK_SIZE, 0,
+                                               YAAF_MemFileChunkCount(cacheSize), 1);
+            if (result == YAAF_SUCCESS)
             {
-                pFile->ptr = ptr;
-                pFile->oshdl = handle;
-                pFile->size = file_size;
-                result = YAAF_SUCCESS;
+                return YAAF_SUCCESS;
+            }
+            pFile->oshdl = -1;
+        }
+        else if (flags & YAAF_MAP_WINDOWED)
+        {
+            /* windows are mapped on request */
+            pFile->size = file_size;
+            pFile->oshdl = handle;
+            result = YAAF_MemFileCreateWindows(pFile, YAAF_MEMFILE_WINDOW_SIZE, YAAF_MEMFILE_WINDOW_OVERLAP,
+                                               YAAF_MEMFILE_WINDOW_COUNT, 0);
+            if (result == YAAF_SUCCESS)
+            {
+                return YAAF_SUCCESS;
             }
+            pFile->oshdl = -1;
+        }
+        else if (flags & YAAF_MAP_PRELOAD)
+        {
+            result = YAAF_MemFileLoad(pFile, handle, file_size, flags);
+            close(handle);
+            handle = -1;
+        }
+        else
+        {
+            result = YAAF_MemFileMap(pFile, handle, file_size, flags);
         }
     }
     else
@@ -79,7 +552,19 @@ YAAF_MemFileOpen(YAAF_MemFile* pFile,
         YAAF_SetError("[YAAF MemFile] Could not get file size for request file");
     }
 
-    if (result == YAAF_FAIL && handle == -1)
+    if (result == YAAF_SUCCESS && (flags & YAAF_MAP_LOCK_ALL))
+    {
+        result = YAAF_MemFileLock(pFile, 0, pFile->size);
+        if (result == YAAF_FAIL)
+        {
+            /* also closes the handle */
+            YAAF_MemFileClose(pFile);
+            pFile->ptr = NULL;
+            return YAAF_FAIL;
+        }
+    }
+
+    if (result == YAAF_FAIL && handle != -1)
     {
         close(handle);
     }
@@ -90,10 +575,22 @@ YAAF_MemFileOpen(YAAF_MemFile* pFile,
 int
 YAAF_MemFileClose(YAAF_MemFile* pFile)
 {
-    if (pFile->ptr && pFile->closeop == YAAF_MEMFILE_CLOSE_FILE)
+    YAAF_MemFileFreeRegions(pFile);
+    YAAF_MemFileDestroyWindows(pFile);
+    if (pFile->closeop == YAAF_MEMFILE_CLOSE_FILE)
+    {
+        if (pFile->ptr)
+        {
+            munmap((void*)pFile->ptr, pFile->size);
+        }
+        if (pFile->oshdl != -1)
+        {
+            close(pFile->oshdl);
+        }
+    }
+    if (pFile->ptr && pFile->closeop == YAAF_MEMFILE_CLOSE_UNMAP)
     {
         munmap((void*)pFile->ptr, pFile->size);
-        close(pFile->oshdl);
     }
     if (pFile->ptr && pFile->closeop == YAAF_MEMFILE_CLOSE_FREE)
     {
@@ -102,15 +599,186 @@ YAAF_MemFileClose(YAAF_MemFile* pFile)
     return YAAF_SUCCESS;
 }
 
+int
+YAAF_MemFileLock(const YAAF_MemFile* pFile,
+                 const uint64_t offset,
+                 const uint64_t size)
+{
+    uint64_t start, end;
+
+    if (!pFile->ptr || offset >= pFile->size || size == 0)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    start = offset & ~((uint64_t)sysconf(_SC_PAGESIZE) - 1);
+    end = (size < pFile->size - offset) ? offset + size : pFile->size;
+    if (mlock((const char*)pFile->ptr + start, (size_t)(end - start)) != 0)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to lock file in memory");
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+static const void*
+YAAF_MemFileMapView(const YAAF_MemFile* pFile,
+                    const uint64_t offset,
+                    const size_t size)
+{
+    void* ptr = mmap(0, size, PROT_READ, MAP_SHARED, pFile->oshdl, (off_t)offset);
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+static void
+YAAF_MemFileUnmapView(const void* ptr,
+                      const size_t size)
+{
+    munmap((void*)ptr, size);
+}
+
+static int
+YAAF_MemFileReadAtLeast(const YAAF_MemFile* pFile,
+                        const uint64_t offset,
+                        const size_t size,
+                        const size_t minSize,
+                        void* pBuffer)
+{
+    size_t bytes_read = 0;
+
+    /* direct reads request whole aligned chunks and stop short at the end of
+     * the file */
+    while (bytes_read < minSize)
+    {
+        const ssize_t res = pread(pFile->oshdl, (char*)pBuffer + bytes_read, size - bytes_read,
+                                  (off_t)(offset + bytes_read));
+        if (res <= 0)
+        {
+            if (res == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            YAAF_SetError("[YAAF MemFile] Failed to read file");
+            return YAAF_FAIL;
+        }
+        bytes_read += (size_t)res;
+    }
+    return YAAF_SUCCESS;
+}
+
+int
+YAAF_MemFileAdvise(const YAAF_MemFile* pFile,
+                   const uint64_t offset,
+                   const uint64_t size,
+                   const YAAF_Advice advice)
+{
+    uint64_t start, end;
+    int madv, fadv;
+
+    /* direct reads do not go through the page cache */
+    if (pFile->closeop != YAAF_MEMFILE_CLOSE_FILE ||
+            offset >= pFile->size || size == 0 ||
+            (pFile->pWindows && ((const YAAF_MemFileWindows*)pFile->pWindows)->pMemory))
+    {
+        return YAAF_SUCCESS;
+    }
+
+    /* the mapping advice needs to start at a page boundary */
+    start = offset & ~((uint64_t)sysconf(_SC_PAGESIZE) - 1);
+    end = (size < pFile->size - offset) ? offset + size : pFile->size;
+
+    switch (advice)
+    {
+    case YAAF_ADVICE_SEQUENTIAL:
+        madv = POSIX_MADV_SEQUENTIAL;
+        fadv = POSIX_FADV_SEQUENTIAL;
+        break;
+    case YAAF_ADVICE_RANDOM:
+        madv = POSIX_MADV_RANDOM;
+        fadv = POSIX_FADV_RANDOM;
+        break;
+    case YAAF_ADVICE_WILLNEED:
+        madv = POSIX_MADV_WILLNEED;
+        fadv = POSIX_FADV_WILLNEED;
+        break;
+    case YAAF_ADVICE_DONTNEED:
+        /* only the file advice drops the cached pages */
+        madv = POSIX_MADV_DONTNEED;
+        fadv = POSIX_FADV_DONTNEED;
+        break;
+    default:
+        madv = POSIX_MADV_NORMAL;
+        fadv = POSIX_FADV_NORMAL;
+        break;
+    }
+
+    if ((pFile->ptr && posix_madvise((char*)pFile->ptr + start, (size_t)(end - start), madv) != 0) ||
+            posix_fadvise(pFile->oshdl, (off_t)start, (off_t)(end - start), fadv) != 0)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to advise file access");
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
 #elif defined(YAAF_HAVE_WINDOWS_H)
 #include <Windows.h>
 
+/* Read the whole file into memory */
+static int
+YAAF_MemFileLoad(YAAF_MemFile* pFile,
+                 HANDLE handle,
+                 const size_t size)
+{
+    size_t bytes_read = 0;
+    char* ptr = (char*) YAAF_malloc(size);
+    if (!ptr)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to allocate memory for file");
+        return YAAF_FAIL;
+    }
+
+    while (bytes_read < size)
+    {
+        const DWORD chunk = (size - bytes_read < 0x40000000) ? (DWORD)(size - bytes_read) : 0x40000000;
+        DWORD res = 0;
+        if (!ReadFile(handle, ptr + bytes_read, chunk, &res, NULL) || res == 0)
+        {
+            YAAF_SetError("[YAAF MemFile] Failed to read file");
+            YAAF_free(ptr);
+            return YAAF_FAIL;
+        }
+        bytes_read += res;
+    }
+
+    pFile->ptr = ptr;
+    pFile->size = size;
+    pFile->memhdl = NULL;
+    pFile->oshdl = NULL;
+    pFile->closeop = YAAF_MEMFILE_CLOSE_FREE;
+    return YAAF_SUCCESS;
+}
+
 int
 YAAF_MemFileOpen(YAAF_MemFile* pFile,
                  const char* path)
+{
+    return YAAF_MemFileOpenEx(pFile, path, 0, 0);
+}
+
+int
+YAAF_MemFileOpenEx(YAAF_MemFile* pFile,
+                   const char* path,
+                   const uint32_t flags,
+                   const uint64_t cacheSize)
 {
     int result = YAAF_FAIL;
     size_t file_size = 0;
+    pFile->ptr = NULL;
+    pFile->memhdl = NULL;
+    pFile->oshdl = NULL;
+    pFile->pRegions = NULL;
+    pFile->pWindows = NULL;
     pFile->closeop = YAAF_MEMFILE_CLOSE_FILE;
     HANDLE handle_file = (HANDLE)HFILE_ERROR;
     HANDLE handle_mem = NULL;
@@ -123,13 +791,63 @@ YAAF_MemFileOpen(YAAF_MemFile* pFile,
         {
             YAAF_SetError("[YAAF MemFile] Could not open requested file");
         }
+        else if (flags & YAAF_MAP_PREAD)
+        {
+            /* nothing is mapped, the data is read on request */
+            pFile->size = file_size;
+            pFile->oshdl = handle_file;
+            return YAAF_SUCCESS;
+        }
+        else if (flags & YAAF_MAP_DIRECT)
+        {
+            /* bypass the system cache, the chunks are cached by the file */
+            HANDLE handle_direct = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                               FILE_FLAG_NO_BUFFERING, NULL);
+            if (handle_direct != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(handle_file);
+                handle_file = handle_direct;
+            }
+            pFile->size = file_size;
+            pFile->oshdl = handle_file;
+            result = YAAF_MemFileCreateWindows(pFile, YAAF_MEMFILE_CHUNK_SIZE, 0,
+                                               YAAF_MemFileChunkCount(cacheSize), 1);
+            if (result == YAAF_SUCCESS)
+            {
+                return YAAF_SUCCESS;
+            }
+            pFile->oshdl = NULL;
+        }
+        else if (flags & YAAF_MAP_PRELOAD)
+        {
+            result = YAAF_MemFileLoad(pFile, handle_file, file_size);
+            CloseHandle(handle_file);
+            handle_file = (HANDLE)HFILE_ERROR;
+        }
         else
         {
-            handle_mem = CreateFileMapping(handle_file, NULL, PAGE_READONLY, 0, (DWORD)file_size, NULL);
+            handle_mem = CreateFileMapping(handle_file, NULL, PAGE_READONLY,
+                                           (DWORD)((uint64_t)file_size >> 32),
+                                           (DWORD)file_size, NULL);
             if (!handle_mem)
             {
                 YAAF_SetError("[YAAF MemFile] Could not create file mapping");
             }
+            else if (flags & YAAF_MAP_WINDOWED)
+            {
+                /* windows are mapped on request */
+                pFile->size = file_size;
+                pFile->memhdl = handle_mem;
+                pFile->oshdl = handle_file;
+                result = YAAF_MemFileCreateWindows(pFile, YAAF_MEMFILE_WINDOW_SIZE, YAAF_MEMFILE_WINDOW_OVERLAP,
+                                                   YAAF_MEMFILE_WINDOW_COUNT, 0);
+                if (result == YAAF_SUCCESS)
+                {
+                    return YAAF_SUCCESS;
+                }
+                pFile->memhdl = NULL;
+                pFile->oshdl = NULL;
+            }
             else
             {
                 void* ptr = MapViewOfFile(handle_mem, FILE_MAP_READ, 0, 0, file_size);
@@ -144,6 +862,17 @@ YAAF_MemFileOpen(YAAF_MemFile* pFile,
                     pFile->memhdl = handle_mem;
                     pFile->oshdl = handle_file;
                     result = YAAF_SUCCESS;
+
+                    if (flags & YAAF_MAP_POPULATE)
+                    {
+                        /* touch every page */
+                        volatile const char* p_page = (volatile const char*)ptr;
+                        size_t i;
+                        for (i = 0; i < file_size; i += 4096)
+                        {
+                            (void) p_page[i];
+                        }
+                    }
                 }
             }
         }
@@ -153,6 +882,15 @@ YAAF_MemFileOpen(YAAF_MemFile* pFile,
         YAAF_SetError("[YAAF MemFile] Could not get file size for request file");
     }
 
+    if (result == YAAF_SUCCESS && (flags & YAAF_MAP_LOCK_ALL) &&
+            YAAF_MemFileLock(pFile, 0, pFile->size) != YAAF_SUCCESS)
+    {
+        /* also closes the handles */
+        YAAF_MemFileClose(pFile);
+        pFile->ptr = NULL;
+        return YAAF_FAIL;
+    }
+
     if (result == YAAF_FAIL)
     {
         if (handle_mem)
@@ -171,6 +909,8 @@ YAAF_MemFileOpen(YAAF_MemFile* pFile,
 int
 YAAF_MemFileClose(YAAF_MemFile* pFile)
 {
+    YAAF_MemFileFreeRegions(pFile);
+    YAAF_MemFileDestroyWindows(pFile);
     if (pFile->ptr && pFile->closeop == YAAF_MEMFILE_CLOSE_FILE)
     {
         if (UnmapViewOfFile(pFile->ptr) == 0)
@@ -178,7 +918,13 @@ YAAF_MemFileClose(YAAF_MemFile* pFile)
             YAAF_SetError("[YAAF MemFile] Could not unmap file");
             return YAAF_FAIL;
         }
+    }
+    if (pFile->memhdl && pFile->closeop == YAAF_MEMFILE_CLOSE_FILE)
+    {
         CloseHandle(pFile->memhdl);
+    }
+    if (pFile->oshdl && pFile->closeop == YAAF_MEMFILE_CLOSE_FILE)
+    {
         CloseHandle(pFile->oshdl);
     }
     if (pFile->ptr && pFile->closeop == YAAF_MEMFILE_CLOSE_FREE)
@@ -188,6 +934,88 @@ YAAF_MemFileClose(YAAF_MemFile* pFile)
     return YAAF_SUCCESS;
 }
 
+int
+YAAF_MemFileLock(const YAAF_MemFile* pFile,
+                 const uint64_t offset,
+                 const uint64_t size)
+{
+    uint64_t end;
+
+    if (!pFile->ptr || offset >= pFile->size || size == 0)
+    {
+        return YAAF_SUCCESS;
+    }
+
+    end = (size < pFile->size - offset) ? offset + size : pFile->size;
+    if (!VirtualLock((char*)pFile->ptr + offset, (SIZE_T)(end - offset)))
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to lock file in memory");
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+static const void*
+YAAF_MemFileMapView(const YAAF_MemFile* pFile,
+                    const uint64_t offset,
+                    const size_t size)
+{
+    return MapViewOfFile(pFile->memhdl, FILE_MAP_READ, (DWORD)(offset >> 32),
+                         (DWORD)offset, size);
+}
+
+static void
+YAAF_MemFileUnmapView(const void* ptr,
+                      const size_t size)
+{
+    (void) size;
+    UnmapViewOfFile(ptr);
+}
+
+static int
+YAAF_MemFileReadAtLeast(const YAAF_MemFile* pFile,
+                        const uint64_t offset,
+                        const size_t size,
+                        const size_t minSize,
+                        void* pBuffer)
+{
+    size_t bytes_read = 0;
+
+    while (bytes_read < minSize)
+    {
+        const DWORD chunk = (size - bytes_read < 0x40000000) ? (DWORD)(size - bytes_read) : 0x40000000;
+        const uint64_t position = offset + bytes_read;
+        OVERLAPPED ov;
+        DWORD res = 0;
+
+        /* positioned read, does not depend on the file pointer */
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)position;
+        ov.OffsetHigh = (DWORD)(position >> 32);
+        if (!ReadFile(pFile->oshdl, (char*)pBuffer + bytes_read, chunk, &res, &ov) || res == 0)
+        {
+            YAAF_SetError("[YAAF MemFile] Failed to read file");
+            return YAAF_FAIL;
+        }
+        bytes_read += res;
+    }
+    return YAAF_SUCCESS;
+}
+
+int
+YAAF_MemFileAdvise(const YAAF_MemFile* pFile,
+                   const uint64_t offset,
+                   const uint64_t size,
+                   const YAAF_Advice advice)
+{
+    /* no equivalent of madvise() for mapped views */
+    (void) pFile;
+    (void) offset;
+    (void) size;
+    (void) advice;
+    return YAAF_SUCCESS;
+}
+
 #else
 #error "No Implementation for memory mapped file for current platform"
 #endif
@@ -201,6 +1029,121 @@ YAAF_MemFileFromMemory(YAAF_MemFile* pFile,
     pFile->ptr = ptr;
     pFile->size = size;
     pFile->oshdl = 0;
+    pFile->pRegions = NULL;
+    pFile->pWindows = NULL;
     pFile->closeop = closeop;
     return YAAF_SUCCESS;
 }
+
+int
+YAAF_MemFileRead(const YAAF_MemFile* pFile,
+                 const uint64_t offset,
+                 const size_t size,
+                 void* pBuffer,
+                 const void** pPtr)
+{
+    if (offset > pFile->size || size > pFile->size - offset)
+    {
+        YAAF_SetError("[YAAF MemFile] Read out of bounds");
+        return YAAF_FAIL;
+    }
+
+    if (pFile->ptr)
+    {
+        *pPtr = YAAF_CONST_PTR_OFFSET(pFile->ptr, offset);
+        return YAAF_SUCCESS;
+    }
+
+    if (pFile->pWindows && ((const YAAF_MemFileWindows*)pFile->pWindows)->pMemory)
+    {
+        if (YAAF_MemFileReadCached(pFile, offset, size, pBuffer) != YAAF_SUCCESS)
+        {
+            return YAAF_FAIL;
+        }
+    }
+    else if (YAAF_MemFileReadAtLeast(pFile, offset, size, size, pBuffer) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+    *pPtr = pBuffer;
+    return YAAF_SUCCESS;
+}
+
+int
+YAAF_MemFileReadPinned(const YAAF_MemFile* pFile,
+                       const uint64_t offset,
+                       const size_t size,
+                       void* pBuffer,
+                       void** ppWindow,
+                       const void** pPtr)
+{
+    YAAF_MemFileWindows* p_windows = (YAAF_MemFileWindows*) pFile->pWindows;
+    YAAF_MemFileWindow* p_window = NULL;
+    uint64_t start;
+
+    if (!p_windows || offset > pFile->size || size > pFile->size - offset ||
+            (offset % p_windows->windowSize) + size > p_windows->windowSize + p_windows->overlap)
+    {
+        YAAF_MemFileRelease(pFile, ppWindow);
+        return YAAF_MemFileRead(pFile, offset, size, pBuffer, pPtr);
+    }
+
+    start = offset - (offset % p_windows->windowSize);
+    p_window = YAAF_MemFileWindowAcquire(pFile, p_windows, start);
+
+    /* the previous window is released after pinning the new one, in case
+     * they are the same */
+    YAAF_MemFileRelease(pFile, ppWindow);
+    if (!p_window)
+    {
+        /* all windows are pinned or the window could not be loaded */
+        return YAAF_MemFileRead(pFile, offset, size, pBuffer, pPtr);
+    }
+
+    *ppWindow = p_window;
+    *pPtr = p_window->ptr + (offset - start);
+    return YAAF_SUCCESS;
+}
+
+void
+YAAF_MemFileRelease(const YAAF_MemFile* pFile,
+                    void** ppWindow)
+{
+    if (*ppWindow)
+    {
+        YAAF_MemFileWindowRelease((YAAF_MemFileWindows*) pFile->pWindows,
+                                  (YAAF_MemFileWindow*) *ppWindow);
+        *ppWindow = NULL;
+    }
+}
+
+const void*
+YAAF_MemFileRegion(YAAF_MemFile* pFile,
+                   const uint64_t offset,
+                   const size_t size)
+{
+    YAAF_MemFileRegionHdr* p_region;
+    const void* ptr = NULL;
+
+    if (pFile->ptr)
+    {
+        return (YAAF_MemFileRead(pFile, offset, size, NULL, &ptr) == YAAF_SUCCESS) ? ptr : NULL;
+    }
+
+    p_region = (YAAF_MemFileRegionHdr*) YAAF_malloc(sizeof(YAAF_MemFileRegionHdr) + size);
+    if (!p_region)
+    {
+        YAAF_SetError("[YAAF MemFile] Failed to allocate memory for region");
+        return NULL;
+    }
+
+    if (YAAF_MemFileRead(pFile, offset, size, p_region + 1, &ptr) != YAAF_SUCCESS)
+    {
+        YAAF_free(p_region);
+        return NULL;
+    }
+
+    p_region->pNext = (YAAF_MemFileRegionHdr*) pFile->pRegions;
+    pFile->pRegions = p_region;
+    return ptr;
+}
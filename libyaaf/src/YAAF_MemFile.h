@@ -38,7 +38,8 @@ typedef enum
 {
     YAAF_MEMFILE_CLOSE_FILE,
     YAAF_MEMFILE_CLOSE_FREE,
-    YAAF_MEMFILE_CLOSE_WTHFREE
+    YAAF_MEMFILE_CLOSE_WTHFREE,
+    YAAF_MEMFILE_CLOSE_UNMAP
 }YAAF_MemFileCloseOp;
 
 typedef struct YAAF_MemFile
@@ -46,6 +47,8 @@ typedef struct YAAF_MemFile
     const void * ptr;
     size_t size;
     YAAF_MemFileCloseOp closeop;
+    void* pRegions;
+    void* pWindows;
 #if defined(YAAF_OS_UNIX)
     int oshdl;
 #elif defined(YAAF_OS_WIN)
@@ -60,6 +63,13 @@ typedef struct YAAF_MemFile
 int YAAF_MemFileOpen(YAAF_MemFile* pFile,
                      const char* path);
 
+/* Open with a combination of YAAF_MapFlags. cacheSize is the size of the
+ * chunk cache with YAAF_MAP_DIRECT. */
+int YAAF_MemFileOpenEx(YAAF_MemFile* pFile,
+                       const char* path,
+                       const uint32_t flags,
+                       const uint64_t cacheSize);
+
 int YAAF_MemFileFromMemory(YAAF_MemFile* pFile,
                            const void* ptr,
                            const size_t size,
@@ -67,4 +77,48 @@ int YAAF_MemFileFromMemory(YAAF_MemFile* pFile,
 
 int YAAF_MemFileClose(YAAF_MemFile* pFile);
 
+/* Get size bytes at offset. With the file mapped *pPtr points into the
+ * mapping, otherwise the data is read into pBuffer. Safe to call from
+ * multiple threads. */
+int YAAF_MemFileRead(const YAAF_MemFile* pFile,
+                     const uint64_t offset,
+                     const size_t size,
+                     void* pBuffer,
+                     const void** pPtr);
+
+/* Like YAAF_MemFileRead(). For files opened with YAAF_MAP_WINDOWED the
+ * range is served from a mapped window which stays pinned in *ppWindow until
+ * the next call with the same ppWindow or YAAF_MemFileRelease(). Falls back
+ * to reading into pBuffer when no window can hold the range. Safe to call
+ * from multiple threads. */
+int YAAF_MemFileReadPinned(const YAAF_MemFile* pFile,
+                           const uint64_t offset,
+                           const size_t size,
+                           void* pBuffer,
+                           void** ppWindow,
+                           const void** pPtr);
+
+/* Unpin the window held in *ppWindow, if any */
+void YAAF_MemFileRelease(const YAAF_MemFile* pFile,
+                         void** ppWindow);
+
+/* Get size bytes at offset which stay valid until the file is closed. With
+ * the file mapped the result points into the mapping, otherwise the data is
+ * read into memory owned by the file. Not thread safe. */
+const void* YAAF_MemFileRegion(YAAF_MemFile* pFile,
+                               const uint64_t offset,
+                               const size_t size);
+
+/* Lock a range of the file in memory */
+int YAAF_MemFileLock(const YAAF_MemFile* pFile,
+                     const uint64_t offset,
+                     const uint64_t size);
+
+/* Pass an access pattern hint for a range of the file to the OS. Files not
+ * mapped from disk ignore the hint. */
+int YAAF_MemFileAdvise(const YAAF_MemFile* pFile,
+                       const uint64_t offset,
+                       const uint64_t size,
+                       const YAAF_Advice advice);
+
 #endif
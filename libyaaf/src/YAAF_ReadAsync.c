@@ -0,0 +1,244 @@
+/*
+ * YAAF - Yet Another Archive Format
+ * Copyright (C) 2014-2015, Leander Beernaert
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
+ */
+#include "YAAF.h"
+#include "YAAF_Internal.h"
+#include "YAAF_Thread.h"
+
+struct YAAF_ReadRequest
+{
+    YAAF_Task task;
+    YAAF_TaskGroup group;
+    YAAF_ThreadPool* pPool;
+    YAAF_Archive* pArchive;
+    YAAF_EntryId id;
+    uint64_t offset;
+    uint64_t size;
+    void* pBuffer;
+    YAAF_ReadCallback callback;
+    void* pUser;
+    uint64_t bytesRead;
+    const char* error; /* error of the worker thread on failure */
+    /* protected by the pool's mutex */
+    YAAF_ReadStatus status;
+    int cancelled;
+};
+
+static int
+YAAF_ReadIsCancelled(YAAF_ReadRequest* pRequest)
+{
+    int cancelled;
+    YAAF_MutexLock(&pRequest->pPool->mutex);
+    cancelled = pRequest->cancelled;
+    YAAF_MutexUnlock(&pRequest->pPool->mutex);
+    return cancelled;
+}
+
+static YAAF_ReadStatus
+YAAF_ReadExecute(YAAF_ReadRequest* pRequest)
+{
+    YAAF_ReadStatus status = YAAF_READ_DONE;
+    YAAF_File* p_file;
+
+    if (YAAF_ReadIsCancelled(pRequest))
+    {
+        return YAAF_READ_CANCELLED;
+    }
+
+    p_file = YAAF_FileOpenById(pRequest->pArchive, pRequest->id);
+    if (!p_file)
+    {
+        YAAF_SetError("[YAAF Read] Failed to open file");
+        return YAAF_READ_FAILED;
+    }
+
+    if (pRequest->offset && YAAF_FileSeek(p_file, (int64_t)pRequest->offset, SEEK_SET) != YAAF_SUCCESS)
+    {
+        YAAF_FileDestroy(p_file);
+        return YAAF_READ_FAILED;
+    }
+
+    /* read a block at a time so that cancellation is noticed */
+    while (pRequest->bytesRead < pRequest->size && !YAAF_FileEOF(p_file))
+    {
+        const uint64_t remaining = pRequest->size - pRequest->bytesRead;
+        const uint32_t chunk = (remaining < YAAF_BLOCK_SIZE) ? (uint32_t)remaining : YAAF_BLOCK_SIZE;
+        const uint32_t bytes_read = YAAF_FileRead(p_file, (char*)pRequest->pBuffer + pRequest->bytesRead, chunk);
+
+        if (bytes_read == 0)
+        {
+            status = YAAF_READ_FAILED;
+            break;
+        }
+        pRequest->bytesRead += bytes_read;
+
+        if (YAAF_ReadIsCancelled(pRequest))
+        {
+            status = YAAF_READ_CANCELLED;
+            break;
+        }
+    }
+
+    YAAF_FileDestroy(p_file);
+    return status;
+}
+
+static void
+YAAF_ReadTaskRun(void* pArg)
+{
+    YAAF_ReadRequest* p_request = (YAAF_ReadRequest*) pArg;
+    const YAAF_ReadStatus status = YAAF_ReadExecute(p_request);
+
+    /* the error is thread local, keep it for the thread waiting on the request */
+    if (status == YAAF_READ_FAILED)
+    {
+        p_request->error = YAAF_GetError();
+    }
+
+    /* the request is finished before the callback runs, the group is only
+     * released by the pool once the callback has returned */
+    YAAF_MutexLock(&p_request->pPool->mutex);
+    p_request->status = status;
+    YAAF_MutexUnlock(&p_request->pPool->mutex);
+
+    if (p_request->callback)
+    {
+        p_request->callback(p_request, status, p_request->bytesRead, p_request->pUser);
+    }
+}
+
+YAAF_ReadRequest*
+YAAF_ReadAsync(YAAF_Archive* pArchive,
+               const char* filePath,
+               const uint64_t offset,
+               const uint64_t size,
+               void* pBuffer,
+               YAAF_ReadCallback callback,
+               void* pUser,
+               YAAF_ThreadPool* pPool)
+{
+    /* the name is looked up once here, the worker opens the file by id */
+    const YAAF_EntryId id = YAAF_ArchiveResolve(pArchive, filePath);
+
+    if (id == YAAF_ENTRY_ID_INVALID)
+    {
+        return NULL;
+    }
+    return YAAF_ReadAsyncById(pArchive, id, offset, size, pBuffer, callback, pUser, pPool);
+}
+
+YAAF_ReadRequest*
+YAAF_ReadAsyncById(YAAF_Archive* pArchive,
+                   const YAAF_EntryId id,
+                   const uint64_t offset,
+                   const uint64_t size,
+                   void* pBuffer,
+                   YAAF_ReadCallback callback,
+                   void* pUser,
+                   YAAF_ThreadPool* pPool)
+{
+    YAAF_ReadRequest* p_request = NULL;
+
+    if (!pPool)
+    {
+        pPool = YAAF_ThreadPoolGetDefault();
+        if (!pPool)
+        {
+            return NULL;
+        }
+    }
+
+    p_request = (YAAF_ReadRequest*) YAAF_calloc(1, sizeof(YAAF_ReadRequest));
+    if (!p_request)
+    {
+        YAAF_SetError("[YAAF Read] Failed to allocate memory");
+        return NULL;
+    }
+
+    p_request->pPool = pPool;
+    p_request->pArchive = pArchive;
+    p_request->id = id;
+    p_request->offset = offset;
+    p_request->size = size;
+    p_request->pBuffer = pBuffer;
+    p_request->callback = callback;
+    p_request->pUser = pUser;
+    p_request->status = YAAF_READ_PENDING;
+    p_request->task.fnc = YAAF_ReadTaskRun;
+    p_request->task.pArg = p_request;
+
+    YAAF_ThreadPoolSubmit(pPool, &p_request->group, &p_request->task);
+    return p_request;
+}
+
+void
+YAAF_ReadCancel(YAAF_ReadRequest* pRequest)
+{
+    YAAF_MutexLock(&pRequest->pPool->mutex);
+    pRequest->cancelled = 1;
+    YAAF_MutexUnlock(&pRequest->pPool->mutex);
+}
+
+YAAF_ReadStatus
+YAAF_ReadPoll(YAAF_ReadRequest* pRequest)
+{
+    YAAF_ReadStatus status;
+    YAAF_MutexLock(&pRequest->pPool->mutex);
+    status = pRequest->status;
+    YAAF_MutexUnlock(&pRequest->pPool->mutex);
+    return status;
+}
+
+YAAF_ReadStatus
+YAAF_ReadWait(YAAF_ReadRequest* pRequest,
+              uint64_t* pBytesRead)
+{
+    YAAF_ThreadPoolWait(pRequest->pPool, &pRequest->group);
+    if (pBytesRead)
+    {
+        *pBytesRead = pRequest->bytesRead;
+    }
+    if (pRequest->status == YAAF_READ_FAILED)
+    {
+        YAAF_SetError(pRequest->error);
+    }
+    return pRequest->status;
+}
+
+void
+YAAF_ReadRelease(YAAF_ReadRequest* pRequest)
+{
+    if (pRequest)
+    {
+        YAAF_ThreadPoolWait(pRequest->pPool, &pRequest->group);
+        YAAF_free(pRequest);
+    }
+}
@@ -0,0 +1,455 @@
+/*
+ * YAAF - Yet Another Archive Format
+ * Copyright (C) 2014-2015, Leander Beernaert
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
+ */
+#include "YAAF_Thread.h"
+#include "YAAF_Internal.h"
+
+#if defined(YAAF_THREAD_PTHREAD)
+#include <unistd.h>
+
+int
+YAAF_MutexInit(YAAF_Mutex* pMutex)
+{
+    return (pthread_mutex_init(pMutex, NULL) == 0) ? YAAF_SUCCESS : YAAF_FAIL;
+}
+
+void
+YAAF_MutexDestroy(YAAF_Mutex* pMutex)
+{
+    pthread_mutex_destroy(pMutex);
+}
+
+void
+YAAF_MutexLock(YAAF_Mutex* pMutex)
+{
+    pthread_mutex_lock(pMutex);
+}
+
+void
+YAAF_MutexUnlock(YAAF_Mutex* pMutex)
+{
+    pthread_mutex_unlock(pMutex);
+}
+
+int
+YAAF_CondInit(YAAF_Cond* pCond)
+{
+    return (pthread_cond_init(pCond, NULL) == 0) ? YAAF_SUCCESS : YAAF_FAIL;
+}
+
+void
+YAAF_CondDestroy(YAAF_Cond* pCond)
+{
+    pthread_cond_destroy(pCond);
+}
+
+void
+YAAF_CondWait(YAAF_Cond* pCond,
+              YAAF_Mutex* pMutex)
+{
+    pthread_cond_wait(pCond, pMutex);
+}
+
+void
+YAAF_CondBroadcast(YAAF_Cond* pCond)
+{
+    pthread_cond_broadcast(pCond);
+}
+
+typedef struct
+{
+    YAAF_ThreadFnc fnc;
+    void* pArg;
+} YAAF_ThreadStart;
+
+static void*
+YAAF_ThreadEntry(void* pArg)
+{
+    YAAF_ThreadStart start = *(YAAF_ThreadStart*)pArg;
+    YAAF_free(pArg);
+    start.fnc(start.pArg);
+    return NULL;
+}
+
+int
+YAAF_ThreadCreate(YAAF_Thread* pThread,
+                  YAAF_ThreadFnc fnc,
+                  void* pArg)
+{
+    YAAF_ThreadStart* p_start = (YAAF_ThreadStart*) YAAF_malloc(sizeof(YAAF_ThreadStart));
+    if (!p_start)
+    {
+        return YAAF_FAIL;
+    }
+    p_start->fnc = fnc;
+    p_start->pArg = pArg;
+
+    if (pthread_create(pThread, NULL, YAAF_ThreadEntry, p_start) != 0)
+    {
+        YAAF_free(p_start);
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+void
+YAAF_ThreadJoin(YAAF_Thread thread)
+{
+    pthread_join(thread, NULL);
+}
+
+uint32_t
+YAAF_CPUCount(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (uint32_t)count : 1;
+}
+
+#elif defined(YAAF_THREAD_WINDOWS)
+
+int
+YAAF_MutexInit(YAAF_Mutex* pMutex)
+{
+    InitializeCriticalSection(pMutex);
+    return YAAF_SUCCESS;
+}
+
+void
+YAAF_MutexDestroy(YAAF_Mutex* pMutex)
+{
+    DeleteCriticalSection(pMutex);
+}
+
+void
+YAAF_MutexLock(YAAF_Mutex* pMutex)
+{
+    EnterCriticalSection(pMutex);
+}
+
+void
+YAAF_MutexUnlock(YAAF_Mutex* pMutex)
+{
+    LeaveCriticalSection(pMutex);
+}
+
+int
+YAAF_CondInit(YAAF_Cond* pCond)
+{
+    InitializeConditionVariable(pCond);
+    return YAAF_SUCCESS;
+}
+
+void
+YAAF_CondDestroy(YAAF_Cond* pCond)
+{
+    (void) pCond;
+}
+
+void
+YAAF_CondWait(YAAF_Cond* pCond,
+              YAAF_Mutex* pMutex)
+{
+    SleepConditionVariableCS(pCond, pMutex, INFINITE);
+}
+
+void
+YAAF_CondBroadcast(YAAF_Cond* pCond)
+{
+    WakeAllConditionVariable(pCond);
+}
+
+typedef struct
+{
+    YAAF_ThreadFnc fnc;
+    void* pArg;
+} YAAF_ThreadStart;
+
+static DWORD WINAPI
+YAAF_ThreadEntry(LPVOID pArg)
+{
+    YAAF_ThreadStart start = *(YAAF_ThreadStart*)pArg;
+    YAAF_free(pArg);
+    start.fnc(start.pArg);
+    return 0;
+}
+
+int
+YAAF_ThreadCreate(YAAF_Thread* pThread,
+                  YAAF_ThreadFnc fnc,
+                  void* pArg)
+{
+    YAAF_ThreadStart* p_start = (YAAF_ThreadStart*) YAAF_malloc(sizeof(YAAF_ThreadStart));
+    if (!p_start)
+    {
+        return YAAF_FAIL;
+    }
+    p_start->fnc = fnc;
+    p_start->pArg = pArg;
+
+    *pThread = CreateThread(NULL, 0, YAAF_ThreadEntry, p_start, 0, NULL);
+    if (!*pThread)
+    {
+        YAAF_free(p_start);
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+void
+YAAF_ThreadJoin(YAAF_Thread thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+uint32_t
+YAAF_CPUCount(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? (uint32_t)info.dwNumberOfProcessors : 1;
+}
+#endif
+
+/* --- Thread Pool ---------------------------------------------------------*/
+
+static YAAF_Mutex YAAF_gDefaultPoolMutex;
+static YAAF_ThreadPool* YAAF_gpDefaultPool = NULL;
+
+/* Pop the next task, must be called with the pool mutex locked */
+static YAAF_Task*
+YAAF_ThreadPoolPop(YAAF_ThreadPool* pPool)
+{
+    YAAF_Task* p_task = pPool->pHead;
+    if (p_task)
+    {
+        pPool->pHead = p_task->pNext;
+        if (!pPool->pHead)
+        {
+            pPool->pTail = NULL;
+        }
+    }
+    return p_task;
+}
+
+/* Run a task, must be called with the pool mutex locked */
+static void
+YAAF_ThreadPoolRun(YAAF_ThreadPool* pPool,
+                   YAAF_Task* pTask)
+{
+    YAAF_TaskGroup* p_group = pTask->pGroup;
+
+    YAAF_MutexUnlock(&pPool->mutex);
+    pTask->fnc(pTask->pArg);
+    YAAF_MutexLock(&pPool->mutex);
+
+    /* the task may be released as soon as the group completes */
+    if (--p_group->nPending == 0)
+    {
+        YAAF_CondBroadcast(&pPool->condDone);
+    }
+}
+
+static void
+YAAF_ThreadPoolWorker(void* pArg)
+{
+    YAAF_ThreadPool* p_pool = (YAAF_ThreadPool*) pArg;
+
+    YAAF_MutexLock(&p_pool->mutex);
+    for (;;)
+    {
+        YAAF_Task* p_task = YAAF_ThreadPoolPop(p_pool);
+        if (p_task)
+        {
+            YAAF_ThreadPoolRun(p_pool, p_task);
+        }
+        else if (p_pool->shutdown)
+        {
+            break;
+        }
+        else
+        {
+            YAAF_CondWait(&p_pool->condWork, &p_pool->mutex);
+        }
+    }
+    YAAF_MutexUnlock(&p_pool->mutex);
+}
+
+YAAF_ThreadPool*
+YAAF_ThreadPoolCreate(const uint32_t nThreads)
+{
+    YAAF_ThreadPool* p_pool = (YAAF_ThreadPool*) YAAF_calloc(1, sizeof(YAAF_ThreadPool));
+    const uint32_t n_threads = (nThreads) ? nThreads : YAAF_CPUCount();
+    uint32_t i;
+
+    if (!p_pool)
+    {
+        YAAF_SetError("Failed to allocate memory for thread pool");
+        return NULL;
+    }
+
+    p_pool->pThreads = (YAAF_Thread*) YAAF_malloc(sizeof(YAAF_Thread) * n_threads);
+    if (!p_pool->pThreads)
+    {
+        YAAF_SetError("Failed to allocate memory for thread pool");
+        YAAF_free(p_pool);
+        return NULL;
+    }
+
+    YAAF_MutexInit(&p_pool->mutex);
+    YAAF_CondInit(&p_pool->condWork);
+    YAAF_CondInit(&p_pool->condDone);
+
+    for (i = 0; i < n_threads; ++i)
+    {
+        if (YAAF_ThreadCreate(&p_pool->pThreads[i], YAAF_ThreadPoolWorker, p_pool) != YAAF_SUCCESS)
+        {
+            break;
+        }
+        ++p_pool->nThreads;
+    }
+
+    if (!p_pool->nThreads)
+    {
+        YAAF_SetError("Failed to create thread pool threads");
+        YAAF_ThreadPoolDestroy(p_pool);
+        return NULL;
+    }
+    return p_pool;
+}
+
+void
+YAAF_ThreadPoolDestroy(YAAF_ThreadPool* pPool)
+{
+    uint32_t i;
+
+    if (!pPool)
+    {
+        return;
+    }
+
+    /* workers drain the queue before exiting */
+    YAAF_MutexLock(&pPool->mutex);
+    pPool->shutdown = 1;
+    YAAF_CondBroadcast(&pPool->condWork);
+    YAAF_MutexUnlock(&pPool->mutex);
+
+    for (i = 0; i < pPool->nThreads; ++i)
+    {
+        YAAF_ThreadJoin(pPool->pThreads[i]);
+    }
+
+    YAAF_CondDestroy(&pPool->condDone);
+    YAAF_CondDestroy(&pPool->condWork);
+    YAAF_MutexDestroy(&pPool->mutex);
+    YAAF_free(pPool->pThreads);
+    YAAF_free(pPool);
+}
+
+uint32_t
+YAAF_ThreadPoolSize(const YAAF_ThreadPool* pPool)
+{
+    return pPool->nThreads;
+}
+
+void
+YAAF_ThreadPoolSubmit(YAAF_ThreadPool* pPool,
+                      YAAF_TaskGroup* pGroup,
+                      YAAF_Task* pTask)
+{
+    pTask->pGroup = pGroup;
+    pTask->pNext = NULL;
+
+    YAAF_MutexLock(&pPool->mutex);
+    ++pGroup->nPending;
+    if (pPool->pTail)
+    {
+        pPool->pTail->pNext = pTask;
+    }
+    else
+    {
+        pPool->pHead = pTask;
+    }
+    pPool->pTail = pTask;
+    YAAF_CondBroadcast(&pPool->condWork);
+    YAAF_MutexUnlock(&pPool->mutex);
+}
+
+void
+YAAF_ThreadPoolWait(YAAF_ThreadPool* pPool,
+                    YAAF_TaskGroup* pGroup)
+{
+    YAAF_MutexLock(&pPool->mutex);
+    while (pGroup->nPending)
+    {
+        /* help with the queued tasks instead of idling */
+        YAAF_Task* p_task = YAAF_ThreadPoolPop(pPool);
+        if (p_task)
+        {
+            YAAF_ThreadPoolRun(pPool, p_task);
+        }
+        else
+        {
+            YAAF_CondWait(&pPool->condDone, &pPool->mutex);
+        }
+    }
+    YAAF_MutexUnlock(&pPool->mutex);
+}
+
+YAAF_ThreadPool*
+YAAF_ThreadPoolGetDefault(void)
+{
+    YAAF_ThreadPool* p_pool;
+
+    YAAF_MutexLock(&YAAF_gDefaultPoolMutex);
+    if (!YAAF_gpDefaultPool)
+    {
+        YAAF_gpDefaultPool = YAAF_ThreadPoolCreate(0);
+    }
+    p_pool = YAAF_gpDefaultPool;
+    YAAF_MutexUnlock(&YAAF_gDefaultPoolMutex);
+    return p_pool;
+}
+
+int
+YAAF_ThreadInit(void)
+{
+    YAAF_gpDefaultPool = NULL;
+    return YAAF_MutexInit(&YAAF_gDefaultPoolMutex);
+}
+
+void
+YAAF_ThreadShutdown(void)
+{
+    YAAF_ThreadPoolDestroy(YAAF_gpDefaultPool);
+    YAAF_gpDefaultPool = NULL;
+    YAAF_MutexDestroy(&YAAF_gDefaultPoolMutex);
+}
@@ -0,0 +1,141 @@
+/*
+ * YAAF - Yet Another Archive Format
+ * Copyright (C) 2014-2015, Leander Beernaert
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
+ */
+#ifndef __YAAF_THREAD_H__
+#define __YAAF_THREAD_H__
+
+#include "YAAF.h"
+
+#if defined(YAAF_HAVE_PTHREAD_H)
+#include <pthread.h>
+#define YAAF_THREAD_PTHREAD 1
+typedef pthread_mutex_t YAAF_Mutex;
+typedef pthread_cond_t YAAF_Cond;
+typedef pthread_t YAAF_Thread;
+#elif defined(YAAF_OS_WIN) && defined(YAAF_HAVE_WINDOWS_H)
+#include <windows.h>
+#define YAAF_THREAD_WINDOWS 1
+typedef CRITICAL_SECTION YAAF_Mutex;
+typedef CONDITION_VARIABLE YAAF_Cond;
+typedef HANDLE YAAF_Thread;
+#else
+#error "No implementation of threads for current platform"
+#endif
+
+typedef void (*YAAF_ThreadFnc)(void*);
+
+int YAAF_MutexInit(YAAF_Mutex* pMutex);
+
+void YAAF_MutexDestroy(YAAF_Mutex* pMutex);
+
+void YAAF_MutexLock(YAAF_Mutex* pMutex);
+
+void YAAF_MutexUnlock(YAAF_Mutex* pMutex);
+
+int YAAF_CondInit(YAAF_Cond* pCond);
+
+void YAAF_CondDestroy(YAAF_Cond* pCond);
+
+void YAAF_CondWait(YAAF_Cond* pCond,
+                   YAAF_Mutex* pMutex);
+
+void YAAF_CondBroadcast(YAAF_Cond* pCond);
+
+int YAAF_ThreadCreate(YAAF_Thread* pThread,
+                      YAAF_ThreadFnc fnc,
+                      void* pArg);
+
+void YAAF_ThreadJoin(YAAF_Thread thread);
+
+uint32_t YAAF_CPUCount(void);
+
+/* --- Atomics -------------------------------------------------------------*/
+
+#if defined(YAAF_COMPILER_GNUC) || defined(YAAF_COMPILER_CLANG)
+#define YAAF_AtomicLoad32(pValue) __atomic_load_n((pValue), __ATOMIC_ACQUIRE)
+/* returns the previous value */
+#define YAAF_AtomicOr32(pValue, bits) __atomic_fetch_or((pValue), (bits), __ATOMIC_RELEASE)
+#elif defined(YAAF_COMPILER_MSC)
+#include <intrin.h>
+#define YAAF_AtomicLoad32(pValue) ((uint32_t)_InterlockedOr((volatile long*)(pValue), 0))
+#define YAAF_AtomicOr32(pValue, bits) ((uint32_t)_InterlockedOr((volatile long*)(pValue), (long)(bits)))
+#else
+#error "No implementation of atomics for current compiler"
+#endif
+
+/* --- Thread Pool ---------------------------------------------------------*/
+
+/* Tasks are owned by the submitter and need to stay valid until completed */
+typedef struct YAAF_Task
+{
+    YAAF_ThreadFnc fnc;
+    void* pArg;
+    struct YAAF_TaskGroup* pGroup;
+    struct YAAF_Task* pNext;
+} YAAF_Task;
+
+/* A task group tracks the completion of a set of tasks */
+typedef struct YAAF_TaskGroup
+{
+    uint32_t nPending;
+} YAAF_TaskGroup;
+
+struct YAAF_ThreadPool
+{
+    YAAF_Mutex mutex;
+    YAAF_Cond condWork;
+    YAAF_Cond condDone;
+    YAAF_Task* pHead;
+    YAAF_Task* pTail;
+    YAAF_Thread* pThreads;
+    uint32_t nThreads;
+    int shutdown;
+};
+
+uint32_t YAAF_ThreadPoolSize(const YAAF_ThreadPool* pPool);
+
+void YAAF_ThreadPoolSubmit(YAAF_ThreadPool* pPool,
+                           YAAF_TaskGroup* pGroup,
+                           YAAF_Task* pTask);
+
+/* Wait for all the tasks in the group, the calling thread runs queued tasks
+ * while waiting */
+void YAAF_ThreadPoolWait(YAAF_ThreadPool* pPool,
+                         YAAF_TaskGroup* pGroup);
+
+/* Pool shared by the library, created on first use */
+YAAF_ThreadPool* YAAF_ThreadPoolGetDefault(void);
+
+int YAAF_ThreadInit(void);
+
+void YAAF_ThreadShutdown(void);
+
+#endif
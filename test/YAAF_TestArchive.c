@@ -0,0 +1,1233 @@
+/*
+ * YAAF Test Archive
+ * Copyright (c) 2014 Leander Beernaert
+ *
+ * YAAFCL is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * YAAFCL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with YAAFCL. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * You can contact the author at :
+ * - YAAF source repository : http://www.github.com/LeanderBB/YAAF
+ */
+
+
+#include "YAAF.h"
+#include "YAAF_Archive.h"
+#include "YAAF_Compression.h"
+#include "YAAF_Hash.h"
+#include "YAAF_Internal.h"
+#include "YAAF_Thread.h"
+#include <stddef.h>
+
+/* Archives are written in the same layout as yaafcl, for each set of
+ * manifest flags, and read back with every validation level */
+
+static const char* s_output_file = "archive_test.tmp";
+
+#define BIG_FILE_SIZE (3 * YAAF_BLOCK_SIZE + 1000)
+
+typedef struct
+{
+    const char* name;
+    const char* data;
+    uint32_t size;
+} TestFile;
+
+/* the data of files without data is g_big_data */
+static char* g_big_data;
+
+static const char*
+file_data(const TestFile* pFile)
+{
+    return (pFile->data) ? pFile->data : g_big_data;
+}
+
+typedef struct
+{
+    char* ptr;
+    size_t size;
+    size_t capacity;
+} TestBuffer;
+
+static int
+buffer_append(TestBuffer* pBuffer,
+              const void* ptr,
+              const size_t size)
+{
+    if (pBuffer->size + size > pBuffer->capacity)
+    {
+        size_t capacity = (pBuffer->capacity) ? pBuffer->capacity * 2 : 4096;
+        char* p_new;
+        while (capacity < pBuffer->size + size)
+        {
+            capacity *= 2;
+        }
+        p_new = (char*) realloc(pBuffer->ptr, capacity);
+        if (!p_new)
+        {
+            return YAAF_FAIL;
+        }
+        pBuffer->ptr = p_new;
+        pBuffer->capacity = capacity;
+    }
+    memcpy(pBuffer->ptr + pBuffer->size, ptr, size);
+    pBuffer->size += size;
+    return YAAF_SUCCESS;
+}
+
+static uint32_t
+name_hash(const char* name,
+          const uint32_t flags)
+{
+    if (!(flags & YAAF_ARCHIVE_FLAG_NAME_HASH_V2))
+    {
+        return YAAF_OnceAtATimeHashNoCase(name);
+    }
+    return (flags & YAAF_ARCHIVE_FLAG_CASE_SENSITIVE) ?
+                YAAF_NameHashExact(name, strlen(name)) : YAAF_NameHash(name, strlen(name));
+}
+
+/* Write the blocks of a file, followed by the end of blocks marker and the
+ * block offset table */
+static int
+write_file(TestBuffer* pOutput,
+           const TestFile* pFile,
+           const uint32_t flags,
+           YAAF_ManifestEntry* pEntry,
+           YAAF_ManifestEntryExt64* pExt)
+{
+    static char tmp_output[YAAF_BLOCK_CACHE_SIZE_WR];
+    const int algorithm = (flags & YAAF_ARCHIVE_FLAG_HASH_XXH64) ? YAAF_HASH_XXH64 : YAAF_HASH_XXH32;
+    const char* data = file_data(pFile);
+    const uint64_t offset = pOutput->size;
+    uint64_t block_table[16];
+    uint32_t n_blocks = 0, done = 0, i;
+    YAAF_FileHeader file_hdr;
+    YAAF_BlockHeader end_block;
+    YAAF_Compressor c;
+    uint64_t file_hash;
+    int result = YAAF_FAIL;
+
+    file_hdr.magic = YAAF_FILE_HEADER_MAGIC;
+    memset(&end_block, 0, sizeof(end_block));
+    if (buffer_append(pOutput, &file_hdr, sizeof(file_hdr)) != YAAF_SUCCESS ||
+            YAAF_CompressorCreate(&c, YAAF_DEFAULT_COMPRESSION_BIT) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+    c.hashAlgorithm = algorithm;
+
+    while (done < pFile->size)
+    {
+        const uint32_t size = (pFile->size - done < YAAF_BLOCK_SIZE) ? pFile->size - done : YAAF_BLOCK_SIZE;
+        YAAF_BlockHeader block_hdr;
+
+        block_table[n_blocks++] = pOutput->size - offset - sizeof(file_hdr);
+        if (YAAF_CompressBlock(&c, data + done, size, tmp_output,
+                               sizeof(tmp_output), &block_hdr) != YAAF_COMPRESSION_OK ||
+                buffer_append(pOutput, &block_hdr, sizeof(block_hdr)) != YAAF_SUCCESS ||
+                buffer_append(pOutput, tmp_output, YAAF_BLOCK_SIZE_GET(block_hdr.size)) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+        done += size;
+    }
+
+    memset(pEntry, 0, sizeof(YAAF_ManifestEntry));
+    memset(pExt, 0, sizeof(YAAF_ManifestEntryExt64));
+    pEntry->magic = YAAF_MANIFEST_ENTRY_MAGIC;
+    pEntry->sizeCompressed = (uint32_t)(pOutput->size - offset - sizeof(file_hdr));
+    pEntry->sizeUncompressed = pFile->size;
+    pEntry->nameHash = name_hash(pFile->name, flags);
+    pEntry->offset = (uint32_t)offset;
+    pEntry->nameLen = (uint16_t)(strlen(pFile->name) + 1);
+    pEntry->flags = YAAF_DEFAULT_COMPRESSION_BIT;
+    if (flags & YAAF_ARCHIVE_FLAG_64_BIT)
+    {
+        pEntry->flags |= YAAF_ENTRY_FLAG_64_BIT;
+    }
+
+    file_hash = YAAF_HashEx(algorithm, data, pFile->size, 0);
+    pEntry->fileHash = (uint32_t)file_hash;
+    pExt->fileHashHigh = (uint32_t)(file_hash >> 32);
+
+    if (buffer_append(pOutput, &end_block, sizeof(end_block)) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+
+    if (n_blocks > 1)
+    {
+        pEntry->flags |= YAAF_ENTRY_FLAG_BLOCK_TABLE;
+        for (i = 0; i < n_blocks; ++i)
+        {
+            const uint32_t offset32 = (uint32_t)block_table[i];
+            if (((flags & YAAF_ARCHIVE_FLAG_64_BIT) ?
+                 buffer_append(pOutput, &block_table[i], sizeof(uint64_t)) :
+                 buffer_append(pOutput, &offset32, sizeof(uint32_t))) != YAAF_SUCCESS)
+            {
+                goto cleanup;
+            }
+        }
+    }
+    result = YAAF_SUCCESS;
+cleanup:
+    YAAF_CompressorDestroy(&c);
+    return result;
+}
+
+/* The files are written in the given order, the archive expects them sorted
+ * as it compares names */
+static int
+write_archive(const TestFile* pFiles,
+              const uint32_t nFiles,
+              const uint32_t flags)
+{
+    TestBuffer output, entries;
+    YAAF_ManifestEntry* p_entries = NULL;
+    YAAF_ManifestEntryExt64* p_exts = NULL;
+    uint32_t* p_index = NULL;
+    YAAF_IndexSlot* p_slots;
+    YAAF_IndexHeader index_hdr;
+    YAAF_Manifest manifest;
+    uint32_t i, n_slots = 1;
+    FILE* p_file = NULL;
+    int result = YAAF_FAIL;
+
+    memset(&output, 0, sizeof(output));
+    memset(&entries, 0, sizeof(entries));
+    while (n_slots / 2 < nFiles)
+    {
+        n_slots <<= 1;
+    }
+
+    p_entries = (YAAF_ManifestEntry*) calloc(nFiles, sizeof(YAAF_ManifestEntry));
+    p_exts = (YAAF_ManifestEntryExt64*) calloc(nFiles, sizeof(YAAF_ManifestEntryExt64));
+    p_index = (uint32_t*) malloc(sizeof(uint32_t) * nFiles + sizeof(YAAF_IndexSlot) * n_slots);
+    if (!p_entries || !p_exts || !p_index)
+    {
+        goto cleanup;
+    }
+    p_slots = (YAAF_IndexSlot*)(p_index + nFiles);
+    memset(p_slots, 0xFF, sizeof(YAAF_IndexSlot) * n_slots);
+
+    for (i = 0; i < nFiles; ++i)
+    {
+        if (write_file(&output, &pFiles[i], flags, &p_entries[i], &p_exts[i]) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+    }
+
+    /* manifest entries and the lookup index pointing at them */
+    for (i = 0; i < nFiles; ++i)
+    {
+        uint32_t idx = p_entries[i].nameHash & (n_slots - 1);
+        while (p_slots[idx].entry != YAAF_INDEX_SLOT_EMPTY)
+        {
+            idx = (idx + 1) & (n_slots - 1);
+        }
+        p_slots[idx].nameHash = p_entries[i].nameHash;
+        p_slots[idx].entry = i;
+        p_index[i] = (uint32_t)entries.size;
+
+        if (buffer_append(&entries, &p_entries[i], sizeof(YAAF_ManifestEntry)) != YAAF_SUCCESS ||
+                ((flags & YAAF_ARCHIVE_FLAG_64_BIT) &&
+                 buffer_append(&entries, &p_exts[i], sizeof(YAAF_ManifestEntryExt64)) != YAAF_SUCCESS) ||
+                buffer_append(&entries, pFiles[i].name, p_entries[i].nameLen) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+    }
+
+    if (flags & YAAF_ARCHIVE_FLAG_LOOKUP_INDEX)
+    {
+        index_hdr.magic = YAAF_INDEX_MAGIC;
+        index_hdr.nSlots = n_slots;
+        index_hdr.indexSize = (uint32_t)(sizeof(uint32_t) * nFiles + sizeof(YAAF_IndexSlot) * n_slots);
+        index_hdr.indexHash = YAAF_Hash(p_index, index_hdr.indexSize, 0);
+        if (buffer_append(&output, p_index, index_hdr.indexSize) != YAAF_SUCCESS ||
+                buffer_append(&output, &index_hdr, sizeof(index_hdr)) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+    }
+
+    memset(&manifest, 0, sizeof(manifest));
+    manifest.magic = YAAF_MANIFEST_MAGIC;
+    manifest.versionBuilt = YAAF_VERSION;
+    manifest.versionRequired = YAAF_VERSION;
+    manifest.nEntries = nFiles;
+    manifest.manifestEntriesSize = (uint32_t)entries.size;
+    manifest.entriesHash = YAAF_Hash(entries.ptr, (uint32_t)entries.size, 0);
+    manifest.flags = flags;
+    if (buffer_append(&output, entries.ptr, entries.size) != YAAF_SUCCESS ||
+            buffer_append(&output, &manifest, sizeof(manifest)) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+
+    p_file = fopen(s_output_file, "wb");
+    if (p_file && fwrite(output.ptr, 1, output.size, p_file) == output.size)
+    {
+        result = YAAF_SUCCESS;
+    }
+
+cleanup:
+    if (p_file)
+    {
+        fclose(p_file);
+    }
+    free(p_entries);
+    free(p_exts);
+    free(p_index);
+    free(output.ptr);
+    free(entries.ptr);
+    return result;
+}
+
+/* Flip a byte of the archive, counted from the end when offset is negative */
+static int
+corrupt_archive(const long offset)
+{
+    FILE* p_file = fopen(s_output_file, "r+b");
+    int c, result = YAAF_FAIL;
+    if (!p_file)
+    {
+        return YAAF_FAIL;
+    }
+    if (fseek(p_file, offset, (offset < 0) ? SEEK_END : SEEK_SET) == 0 &&
+            (c = fgetc(p_file)) != EOF &&
+            fseek(p_file, -1, SEEK_CUR) == 0 &&
+            fputc(c ^ 0x5A, p_file) != EOF)
+    {
+        result = YAAF_SUCCESS;
+    }
+    fclose(p_file);
+    return result;
+}
+
+static const TestFile g_files[] =
+{
+    {"Data/a.txt", "Hello from a", 12},
+    {"Data/big.bin", NULL, BIG_FILE_SIZE},
+    {"Data/sub/c.txt", "Nested file c", 13},
+    {"Readme.txt", "Readme", 6}
+};
+#define FILE_COUNT (sizeof(g_files) / sizeof(g_files[0]))
+
+/* Only the case differs, sorted for the case sensitive comparison */
+static const TestFile g_case_files[] =
+{
+    {"Data/A.txt", "Upper case", 10},
+    {"Data/a.txt", "Lower case", 10},
+    {"Data/b.txt", "Only lower", 10}
+};
+#define CASE_FILE_COUNT (sizeof(g_case_files) / sizeof(g_case_files[0]))
+
+/* The files of g_files, out of order */
+static const TestFile g_unsorted_files[] =
+{
+    {"Readme.txt", "Readme", 6},
+    {"Data/sub/c.txt", "Nested file c", 13},
+    {"Data/a.txt", "Hello from a", 12},
+    {"Data/big.bin", NULL, BIG_FILE_SIZE}
+};
+
+static int
+check_file(YAAF_Archive* pArchive,
+           const char* path,
+           const TestFile* pFile)
+{
+    static char buffer[BIG_FILE_SIZE];
+    const char* data = file_data(pFile);
+    const YAAF_EntryId id = YAAF_ArchiveResolve(pArchive, path);
+    YAAF_FileInfo info;
+    YAAF_File* p_file;
+    uint32_t done = 0;
+    int result = YAAF_FAIL;
+
+    if (YAAF_ArchiveFileInfo(pArchive, path, &info) != YAAF_SUCCESS ||
+            info.sizeUncompressed != pFile->size)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* the id finds the same entry without hashing the name */
+    memset(&info, 0, sizeof(info));
+    if (id == YAAF_ENTRY_ID_INVALID ||
+            YAAF_ArchiveFileInfoById(pArchive, id, &info) != YAAF_SUCCESS ||
+            info.sizeUncompressed != pFile->size ||
+            YAAF_ArchiveReadFileById(pArchive, id, buffer, sizeof(buffer)) != YAAF_SUCCESS ||
+            memcmp(buffer, data, pFile->size) != 0)
+    {
+        return YAAF_FAIL;
+    }
+
+    memset(buffer, 0, pFile->size);
+    p_file = YAAF_FileOpenById(pArchive, id);
+    if (!p_file)
+    {
+        return YAAF_FAIL;
+    }
+
+    while (done < pFile->size)
+    {
+        const uint32_t bytes_read = YAAF_FileRead(p_file, buffer + done, pFile->size - done);
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        done += bytes_read;
+    }
+
+    /* seek back through the block offset table into the last block */
+    if (done == pFile->size && memcmp(buffer, data, pFile->size) == 0 &&
+            YAAF_FileSeek(p_file, pFile->size - 5, SEEK_SET) == YAAF_SUCCESS &&
+            YAAF_FileRead(p_file, buffer, 5) == 5 &&
+            memcmp(buffer, data + pFile->size - 5, 5) == 0)
+    {
+        result = YAAF_SUCCESS;
+    }
+    YAAF_FileDestroy(p_file);
+    return result;
+}
+
+/* The list has to hold the expected names in order */
+static int
+check_list(const YAAF_Archive* pArchive,
+           const char* dir,
+           const char** pExpected,
+           const uint32_t nExpected)
+{
+    const char** p_list = YAAF_ArchiveListDir(pArchive, dir);
+    int result = (p_list) ? YAAF_SUCCESS : YAAF_FAIL;
+    uint32_t i;
+
+    for (i = 0; i < nExpected && result == YAAF_SUCCESS; ++i)
+    {
+        if (!p_list[i] || strcmp(p_list[i], pExpected[i]) != 0)
+        {
+            result = YAAF_FAIL;
+        }
+    }
+    if (result == YAAF_SUCCESS && p_list[nExpected])
+    {
+        result = YAAF_FAIL;
+    }
+    if (p_list)
+    {
+        YAAF_ArchiveFreeList(p_list);
+    }
+    return result;
+}
+
+static int
+test_dirs(const YAAF_Archive* pArchive)
+{
+    static const char* s_data[] = {"Data/a.txt", "Data/big.bin", "Data/sub/c.txt"};
+    static const char* s_root[] = {"Readme.txt"};
+    static const char* s_sub[] = {"Data/sub/c.txt"};
+    char buffer[16];
+    YAAF_Dir* p_dir;
+    YAAF_File* p_file;
+    int result = YAAF_FAIL;
+
+    /* directories list their sub directories, the root only its files */
+    if (check_list(pArchive, "Data", s_data, 3) != YAAF_SUCCESS ||
+            check_list(pArchive, ".", s_root, 1) != YAAF_SUCCESS ||
+            check_list(pArchive, "Data/sub", s_sub, 1) != YAAF_SUCCESS ||
+            check_list(pArchive, "Missing", NULL, 0) != YAAF_SUCCESS ||
+            check_list(pArchive, "Data/a.txt", NULL, 0) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_dir = YAAF_DirOpen(pArchive, "Missing");
+    if (p_dir)
+    {
+        YAAF_DirClose(p_dir);
+        return YAAF_FAIL;
+    }
+
+    /* names are relative to the directory, which is opened with the case folded */
+    p_dir = YAAF_DirOpen(pArchive, "DATA");
+    if (!p_dir)
+    {
+        return YAAF_FAIL;
+    }
+    if (YAAF_DirContains(p_dir, "a.txt") == YAAF_SUCCESS &&
+            YAAF_DirContains(p_dir, "BIG.bin") == YAAF_SUCCESS &&
+            YAAF_DirContains(p_dir, "sub/c.txt") == YAAF_SUCCESS &&
+            YAAF_DirContains(p_dir, "c.txt") != YAAF_SUCCESS &&
+            YAAF_DirContains(p_dir, "Readme.txt") != YAAF_SUCCESS)
+    {
+        p_file = YAAF_DirFileOpen(p_dir, "sub/c.txt");
+        if (p_file && YAAF_FileRead(p_file, buffer, sizeof(buffer)) == g_files[2].size &&
+                memcmp(buffer, g_files[2].data, g_files[2].size) == 0)
+        {
+            result = YAAF_SUCCESS;
+        }
+        if (p_file)
+        {
+            YAAF_FileDestroy(p_file);
+        }
+    }
+    YAAF_DirClose(p_dir);
+    return result;
+}
+
+static YAAF_Archive*
+open_archive(const YAAF_Validation validation)
+{
+    YAAF_ArchiveOptions options;
+    YAAF_ArchiveOptionsInit(&options);
+    options.validation = validation;
+    return YAAF_ArchiveOpenEx(s_output_file, &options);
+}
+
+static int
+test_lookups(const uint32_t flags)
+{
+    uint32_t i, v;
+
+    if (write_archive(g_files, FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    for (v = YAAF_VALIDATION_FULL; v <= YAAF_VALIDATION_DEFERRED; ++v)
+    {
+        YAAF_Archive* p_archive = open_archive((YAAF_Validation)v);
+        int result = (p_archive) ? YAAF_SUCCESS : YAAF_FAIL;
+
+        for (i = 0; i < FILE_COUNT && result == YAAF_SUCCESS; ++i)
+        {
+            result = check_file(p_archive, g_files[i].name, &g_files[i]);
+        }
+
+        /* a miss, and a hit with the case folded */
+        if (result == YAAF_SUCCESS &&
+                (YAAF_ArchiveContains(p_archive, "Data/b.txt") == YAAF_SUCCESS ||
+                 YAAF_ArchiveContains(p_archive, "Data/sub") == YAAF_SUCCESS ||
+                 YAAF_ArchiveResolve(p_archive, "Missing") != YAAF_ENTRY_ID_INVALID ||
+                 YAAF_ArchiveReadFileById(p_archive, (YAAF_EntryId)FILE_COUNT, NULL, 0) == YAAF_SUCCESS ||
+                 check_file(p_archive, "DATA/BIG.BIN", &g_files[1]) != YAAF_SUCCESS ||
+                 check_file(p_archive, "readme.TXT", &g_files[3]) != YAAF_SUCCESS))
+        {
+            result = YAAF_FAIL;
+        }
+
+        if (result == YAAF_SUCCESS && test_dirs(p_archive) != YAAF_SUCCESS)
+        {
+            result = YAAF_FAIL;
+        }
+
+        if (result == YAAF_SUCCESS &&
+                (YAAF_ArchiveCheck(p_archive) != YAAF_SUCCESS ||
+                 YAAF_ArchiveCheckEx(p_archive, YAAF_CHECK_BLOCKS, NULL, NULL, NULL) != YAAF_SUCCESS))
+        {
+            result = YAAF_FAIL;
+        }
+
+        if (p_archive)
+        {
+            YAAF_ArchiveClose(p_archive);
+        }
+        if (result != YAAF_SUCCESS)
+        {
+            fprintf(stderr, "flags 0x%x validation %u: %s\n", flags, v, YAAF_GetError());
+            return YAAF_FAIL;
+        }
+    }
+    return YAAF_SUCCESS;
+}
+
+static int
+test_case_sensitive()
+{
+    const uint32_t flags = YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 |
+            YAAF_ARCHIVE_FLAG_32_BIT | YAAF_ARCHIVE_FLAG_CASE_SENSITIVE;
+    YAAF_Archive* p_archive;
+    YAAF_Dir* p_dir = NULL;
+    int result = YAAF_FAIL;
+    uint32_t i;
+
+    if (write_archive(g_case_files, CASE_FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+
+    for (i = 0; i < CASE_FILE_COUNT; ++i)
+    {
+        if (check_file(p_archive, g_case_files[i].name, &g_case_files[i]) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+    }
+
+    p_dir = YAAF_DirOpen(p_archive, "Data");
+    if (YAAF_ArchiveContains(p_archive, "Data/B.txt") == YAAF_SUCCESS ||
+            YAAF_ArchiveContains(p_archive, "DATA/a.txt") == YAAF_SUCCESS ||
+            !p_dir || YAAF_DirContains(p_dir, "A.txt") != YAAF_SUCCESS ||
+            YAAF_DirContains(p_dir, "B.txt") == YAAF_SUCCESS ||
+            YAAF_ArchiveCheck(p_archive) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+    result = YAAF_SUCCESS;
+
+cleanup:
+    if (p_dir)
+    {
+        YAAF_DirClose(p_dir);
+    }
+    YAAF_ArchiveClose(p_archive);
+    return result;
+}
+
+/* A full validation sorts the entries of an indexed archive written out of
+ * order, the other levels trust the order and only the check reports it */
+static int
+test_unsorted()
+{
+    const uint32_t flags = YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 |
+            YAAF_ARCHIVE_FLAG_32_BIT;
+    YAAF_Archive* p_archive;
+    int result = YAAF_SUCCESS;
+    uint32_t i;
+
+    if (write_archive(g_unsorted_files, FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+    for (i = 0; i < FILE_COUNT && result == YAAF_SUCCESS; ++i)
+    {
+        result = check_file(p_archive, g_files[i].name, &g_files[i]);
+    }
+    if (result == YAAF_SUCCESS &&
+            (test_dirs(p_archive) != YAAF_SUCCESS || YAAF_ArchiveCheck(p_archive) != YAAF_SUCCESS))
+    {
+        result = YAAF_FAIL;
+    }
+    YAAF_ArchiveClose(p_archive);
+    if (result != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_DEFERRED);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+    result = (YAAF_ArchiveCheck(p_archive) != YAAF_SUCCESS) ? YAAF_SUCCESS : YAAF_FAIL;
+    YAAF_ArchiveClose(p_archive);
+    return result;
+}
+
+/* A damaged lookup index is rejected by a full validation, the other levels
+ * only detect it when the archive is checked */
+static int
+test_corrupt_index()
+{
+    const uint32_t flags = YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 |
+            YAAF_ARCHIVE_FLAG_32_BIT;
+    const long index_end = -(long)(sizeof(YAAF_Manifest) + sizeof(YAAF_IndexHeader));
+    YAAF_Archive* p_archive;
+    uint32_t entries_size, v;
+
+    if (write_archive(g_files, FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+    entries_size = p_archive->pManifest->manifestEntriesSize;
+    YAAF_ArchiveClose(p_archive);
+
+    /* damage the last slot of the index */
+    if (corrupt_archive(index_end - (long)entries_size - 1) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (p_archive)
+    {
+        YAAF_ArchiveClose(p_archive);
+        return YAAF_FAIL;
+    }
+
+    for (v = YAAF_VALIDATION_HEADER; v <= YAAF_VALIDATION_DEFERRED; ++v)
+    {
+        int result;
+
+        p_archive = open_archive((YAAF_Validation)v);
+        if (!p_archive)
+        {
+            return YAAF_FAIL;
+        }
+        result = (YAAF_ArchiveCheck(p_archive) != YAAF_SUCCESS) ? YAAF_SUCCESS : YAAF_FAIL;
+        YAAF_ArchiveClose(p_archive);
+        if (result != YAAF_SUCCESS)
+        {
+            return YAAF_FAIL;
+        }
+    }
+    return YAAF_SUCCESS;
+}
+
+/* Offset of the data of the first block of a file, walking the manifest */
+static long
+block_data_offset(const YAAF_Archive* pArchive,
+                  const char* name)
+{
+    const char* ptr = (const char*) pArchive->pEntries;
+    uint32_t i;
+
+    for (i = 0; i < pArchive->pManifest->nEntries; ++i)
+    {
+        const YAAF_ManifestEntry* p_entry = (const YAAF_ManifestEntry*) ptr;
+        const char* entry_name = ptr + YAAF_ManifestEntryHeaderSize(p_entry) + p_entry->extraLen;
+
+        if (strcmp(entry_name, name) == 0)
+        {
+            return (long)(YAAF_ManifestEntryOffset(p_entry) + sizeof(YAAF_FileHeader) +
+                          sizeof(YAAF_BlockHeader));
+        }
+        ptr = entry_name + p_entry->nameLen;
+    }
+    return -1;
+}
+
+typedef struct
+{
+    uint32_t nCalls;
+    const TestFile* pFiles[FILE_COUNT];
+} CheckState;
+
+static void
+check_callback(const char* file,
+               const char* error,
+               void* pUser)
+{
+    CheckState* p_state = (CheckState*) pUser;
+    uint32_t i;
+
+    for (i = 0; i < FILE_COUNT && error; ++i)
+    {
+        if (strcmp(g_files[i].name, file) == 0 && p_state->nCalls < FILE_COUNT)
+        {
+            p_state->pFiles[p_state->nCalls] = &g_files[i];
+        }
+    }
+    ++p_state->nCalls;
+}
+
+/* The check goes on after a corrupted file and reports each of them once, in
+ * the order of the files. The block hashes catch the damage without
+ * decompressing. */
+static int
+test_check()
+{
+    const uint32_t flags = YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 |
+            YAAF_ARCHIVE_FLAG_32_BIT;
+    YAAF_Archive* p_archive;
+    CheckState state;
+    long offset_a, offset_c;
+    int result = YAAF_SUCCESS;
+    uint32_t level;
+
+    if (write_archive(g_files, FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+    offset_a = block_data_offset(p_archive, g_files[0].name);
+    offset_c = block_data_offset(p_archive, g_files[2].name);
+    YAAF_ArchiveClose(p_archive);
+
+    if (offset_a < 0 || offset_c < 0 ||
+            corrupt_archive(offset_a + 1) != YAAF_SUCCESS ||
+            corrupt_archive(offset_c + 1) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+
+    for (level = YAAF_CHECK_FULL; level <= YAAF_CHECK_BLOCKS && result == YAAF_SUCCESS; ++level)
+    {
+        memset(&state, 0, sizeof(state));
+        if (YAAF_ArchiveCheckEx(p_archive, (YAAF_CheckLevel)level, NULL, check_callback, &state) == YAAF_SUCCESS ||
+                state.nCalls != 2 || state.pFiles[0] != &g_files[0] || state.pFiles[1] != &g_files[2])
+        {
+            fprintf(stderr, "check level %u: %u files reported\n", level, state.nCalls);
+            result = YAAF_FAIL;
+        }
+    }
+    if (result == YAAF_SUCCESS && YAAF_ArchiveCheckFile(p_archive, g_files[1].name) != YAAF_SUCCESS)
+    {
+        result = YAAF_FAIL;
+    }
+    YAAF_ArchiveClose(p_archive);
+    return result;
+}
+
+static YAAF_Archive*
+open_verified_archive()
+{
+    YAAF_ArchiveOptions options;
+    YAAF_ArchiveOptionsInit(&options);
+    options.verifyOnRead = 1;
+    /* data is read from the file each time, later changes to it are seen */
+    options.mapFlags = YAAF_MAP_PREAD;
+    return YAAF_ArchiveOpenEx(s_output_file, &options);
+}
+
+/* Reads of a damaged block fail, verified blocks are not hashed again: the
+ * read still succeeds once the stored hash of a verified block is damaged */
+static int
+test_verify_on_read(const uint32_t flags)
+{
+    const long hash_offset = (long)sizeof(YAAF_BlockHeader) - (long)offsetof(YAAF_BlockHeader, hash);
+    YAAF_Archive* p_archive;
+    YAAF_Dir* p_dir = NULL;
+    YAAF_File* p_file = NULL;
+    YAAF_EntryId id;
+    long offset_a, offset_big;
+    char buffer[16];
+    char* p_buffer;
+    uint64_t bit;
+    int result = YAAF_FAIL;
+
+    if (write_archive(g_files, FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+    offset_a = block_data_offset(p_archive, g_files[0].name);
+    offset_big = block_data_offset(p_archive, g_files[1].name);
+    YAAF_ArchiveClose(p_archive);
+    if (offset_a < 0 || offset_big < 0 || corrupt_archive(offset_a + 1) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+
+    p_buffer = (char*) malloc(BIG_FILE_SIZE);
+    p_archive = open_verified_archive();
+    if (!p_buffer || !p_archive)
+    {
+        goto cleanup;
+    }
+
+    if (YAAF_ArchiveReadFile(p_archive, g_files[0].name, buffer, sizeof(buffer)) == YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+    p_file = YAAF_FileOpen(p_archive, g_files[0].name);
+    if (!p_file || YAAF_FileRead(p_file, buffer, sizeof(buffer)) != 0)
+    {
+        goto cleanup;
+    }
+
+    /* files opened from a directory find their blocks by id as well */
+    YAAF_FileDestroy(p_file);
+    p_file = NULL;
+    p_dir = YAAF_DirOpen(p_archive, "Data/sub");
+    if (!p_dir)
+    {
+        goto cleanup;
+    }
+    p_file = YAAF_DirFileOpen(p_dir, "c.txt");
+    if (!p_file || YAAF_FileRead(p_file, buffer, sizeof(buffer)) != g_files[2].size ||
+            memcmp(buffer, g_files[2].data, g_files[2].size) != 0)
+    {
+        goto cleanup;
+    }
+
+    id = YAAF_ArchiveResolve(p_archive, g_files[1].name);
+    if (YAAF_ArchiveReadFileById(p_archive, id, p_buffer, BIG_FILE_SIZE) != YAAF_SUCCESS ||
+            memcmp(p_buffer, g_big_data, BIG_FILE_SIZE) != 0)
+    {
+        goto cleanup;
+    }
+    for (bit = p_archive->pVerifyFirst[id]; bit < p_archive->pVerifyFirst[id] + 4; ++bit)
+    {
+        if (!(p_archive->pVerified[bit / 32] & (1u << (bit % 32))))
+        {
+            goto cleanup;
+        }
+    }
+
+    if (corrupt_archive(offset_big - hash_offset) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+    memset(p_buffer, 0, BIG_FILE_SIZE);
+    if (YAAF_ArchiveReadFileById(p_archive, id, p_buffer, BIG_FILE_SIZE) != YAAF_SUCCESS ||
+            memcmp(p_buffer, g_big_data, BIG_FILE_SIZE) != 0)
+    {
+        goto cleanup;
+    }
+
+    /* the damaged hash is caught by an archive that did not verify it yet */
+    YAAF_DirClose(p_dir);
+    p_dir = NULL;
+    YAAF_FileDestroy(p_file);
+    p_file = NULL;
+    YAAF_ArchiveClose(p_archive);
+    p_archive = open_verified_archive();
+    if (p_archive && YAAF_ArchiveReadFileById(p_archive, id, p_buffer, BIG_FILE_SIZE) != YAAF_SUCCESS)
+    {
+        result = YAAF_SUCCESS;
+    }
+
+cleanup:
+    if (p_file)
+    {
+        YAAF_FileDestroy(p_file);
+    }
+    if (p_dir)
+    {
+        YAAF_DirClose(p_dir);
+    }
+    if (p_archive)
+    {
+        YAAF_ArchiveClose(p_archive);
+    }
+    free(p_buffer);
+    return result;
+}
+
+typedef struct
+{
+    YAAF_Mutex mutex;
+    uint32_t started;
+    uint32_t nCalls;
+    YAAF_ReadStatus status;
+    uint64_t bytesRead;
+} AsyncState;
+
+static void
+async_callback(YAAF_ReadRequest* pRequest,
+               YAAF_ReadStatus status,
+               uint64_t bytesRead,
+               void* pUser)
+{
+    AsyncState* p_state = (AsyncState*) pUser;
+    (void) pRequest;
+    p_state->status = status;
+    p_state->bytesRead = bytesRead;
+    ++p_state->nCalls;
+}
+
+/* Keeps the worker busy until the mutex of the state is released */
+static void
+async_block_callback(YAAF_ReadRequest* pRequest,
+                     YAAF_ReadStatus status,
+                     uint64_t bytesRead,
+                     void* pUser)
+{
+    AsyncState* p_state = (AsyncState*) pUser;
+    (void) pRequest;
+    (void) status;
+    (void) bytesRead;
+    YAAF_AtomicOr32(&p_state->started, 1);
+    YAAF_MutexLock(&p_state->mutex);
+    YAAF_MutexUnlock(&p_state->mutex);
+}
+
+/* Read across several blocks from an offset, by name and by id past the end
+ * of the file */
+static int
+check_async_read(YAAF_Archive* pArchive,
+                 YAAF_ThreadPool* pPool)
+{
+    const uint64_t offset = YAAF_BLOCK_SIZE / 2 + 3;
+    const uint64_t size = 2 * YAAF_BLOCK_SIZE;
+    const YAAF_EntryId id = YAAF_ArchiveResolve(pArchive, g_files[1].name);
+    YAAF_ReadRequest* p_request;
+    AsyncState state;
+    uint64_t bytes_read = 0;
+    char* p_buffer;
+    int result = YAAF_FAIL;
+
+    p_buffer = (char*) malloc((size_t)size);
+    if (!p_buffer)
+    {
+        return YAAF_FAIL;
+    }
+
+    memset(&state, 0, sizeof(state));
+    p_request = YAAF_ReadAsync(pArchive, g_files[1].name, offset, size, p_buffer, async_callback, &state, pPool);
+    if (p_request && YAAF_ReadWait(p_request, &bytes_read) == YAAF_READ_DONE &&
+            YAAF_ReadPoll(p_request) == YAAF_READ_DONE && bytes_read == size &&
+            state.nCalls == 1 && state.status == YAAF_READ_DONE && state.bytesRead == size &&
+            memcmp(p_buffer, g_big_data + offset, (size_t)size) == 0)
+    {
+        result = YAAF_SUCCESS;
+    }
+    YAAF_ReadRelease(p_request);
+
+    memset(&state, 0, sizeof(state));
+    p_request = (result == YAAF_SUCCESS) ?
+                YAAF_ReadAsyncById(pArchive, id, BIG_FILE_SIZE - 100, size, p_buffer, async_callback, &state, pPool) :
+                NULL;
+    if (!p_request || YAAF_ReadWait(p_request, &bytes_read) != YAAF_READ_DONE || bytes_read != 100 ||
+            state.nCalls != 1 || memcmp(p_buffer, g_big_data + BIG_FILE_SIZE - 100, 100) != 0)
+    {
+        result = YAAF_FAIL;
+    }
+    YAAF_ReadRelease(p_request);
+    free(p_buffer);
+    return result;
+}
+
+/* A request cancelled while queued behind a blocked read is not started */
+static int
+check_async_cancel(YAAF_Archive* pArchive,
+                   YAAF_ThreadPool* pPool)
+{
+    char buffer[16];
+    char* p_buffer;
+    AsyncState block_state, state;
+    YAAF_ReadRequest* p_block;
+    YAAF_ReadRequest* p_request = NULL;
+    uint64_t bytes_read = 1;
+    int result = YAAF_FAIL;
+
+    p_buffer = (char*) malloc(BIG_FILE_SIZE);
+    if (!p_buffer)
+    {
+        return YAAF_FAIL;
+    }
+    memset(&block_state, 0, sizeof(block_state));
+    memset(&state, 0, sizeof(state));
+    YAAF_MutexInit(&block_state.mutex);
+
+    YAAF_MutexLock(&block_state.mutex);
+    p_block = YAAF_ReadAsync(pArchive, g_files[3].name, 0, sizeof(buffer), buffer,
+                             async_block_callback, &block_state, pPool);
+    if (p_block)
+    {
+        while (!YAAF_AtomicLoad32(&block_state.started))
+        {
+        }
+        p_request = YAAF_ReadAsync(pArchive, g_files[1].name, 0, BIG_FILE_SIZE, p_buffer,
+                                   async_callback, &state, pPool);
+        if (p_request)
+        {
+            YAAF_ReadCancel(p_request);
+            if (YAAF_ReadPoll(p_request) == YAAF_READ_PENDING)
+            {
+                result = YAAF_SUCCESS;
+            }
+        }
+    }
+    YAAF_MutexUnlock(&block_state.mutex);
+
+    if (result == YAAF_SUCCESS &&
+            (YAAF_ReadWait(p_request, &bytes_read) != YAAF_READ_CANCELLED || bytes_read != 0 ||
+             state.nCalls != 1 || state.status != YAAF_READ_CANCELLED))
+    {
+        result = YAAF_FAIL;
+    }
+    YAAF_ReadRelease(p_request);
+    YAAF_ReadRelease(p_block);
+    YAAF_MutexDestroy(&block_state.mutex);
+    free(p_buffer);
+    return result;
+}
+
+static int
+test_async()
+{
+    const uint32_t flags = YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 |
+            YAAF_ARCHIVE_FLAG_32_BIT;
+    YAAF_ThreadPool* p_pool = NULL;
+    YAAF_ReadRequest* p_request;
+    YAAF_Archive* p_archive;
+    AsyncState state;
+    char buffer[16];
+    int result = YAAF_FAIL;
+
+    if (write_archive(g_files, FILE_COUNT, flags) != YAAF_SUCCESS)
+    {
+        return YAAF_FAIL;
+    }
+    p_archive = open_archive(YAAF_VALIDATION_FULL);
+    if (!p_archive)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* the pool used for the cancellation has a single worker to block */
+    p_pool = YAAF_ThreadPoolCreate(1);
+    if (!p_pool || check_async_read(p_archive, NULL) != YAAF_SUCCESS ||
+            check_async_read(p_archive, p_pool) != YAAF_SUCCESS ||
+            check_async_cancel(p_archive, p_pool) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+
+    /* names are looked up when queued, ids are checked by the worker and its
+     * error is reported to the waiting thread */
+    if (YAAF_ReadAsync(p_archive, "Missing", 0, sizeof(buffer), buffer, NULL, NULL, p_pool))
+    {
+        goto cleanup;
+    }
+    memset(&state, 0, sizeof(state));
+    p_request = YAAF_ReadAsyncById(p_archive, (YAAF_EntryId)FILE_COUNT, 0, sizeof(buffer), buffer,
+                                   async_callback, &state, p_pool);
+    YAAF_SetError(NULL);
+    if (p_request && YAAF_ReadWait(p_request, NULL) == YAAF_READ_FAILED &&
+            state.nCalls == 1 && state.status == YAAF_READ_FAILED &&
+            YAAF_GetError() && strstr(YAAF_GetError(), "Failed to open file"))
+    {
+        result = YAAF_SUCCESS;
+    }
+    YAAF_ReadRelease(p_request);
+
+cleanup:
+    if (p_pool)
+    {
+        YAAF_ThreadPoolDestroy(p_pool);
+    }
+    YAAF_ArchiveClose(p_archive);
+    return result;
+}
+
+int main()
+{
+    static const uint32_t s_flags[] =
+    {
+        /* lookup index */
+        YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 | YAAF_ARCHIVE_FLAG_32_BIT,
+        /* 64 bit entries */
+        YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 | YAAF_ARCHIVE_FLAG_64_BIT,
+        /* XXH64 hashes */
+        YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 | YAAF_ARCHIVE_FLAG_64_BIT |
+        YAAF_ARCHIVE_FLAG_HASH_XXH64,
+        /* no index, looked up with the hashmap */
+        YAAF_ARCHIVE_FLAG_NAME_HASH_V2 | YAAF_ARCHIVE_FLAG_32_BIT,
+        /* archives built before the new name hash */
+        YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_32_BIT,
+        0
+    };
+    /* blocks are found by entry id, with and without the lookup index */
+    static const uint32_t s_verify_flags[] =
+    {
+        YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2 | YAAF_ARCHIVE_FLAG_32_BIT,
+        YAAF_ARCHIVE_FLAG_NAME_HASH_V2 | YAAF_ARCHIVE_FLAG_32_BIT
+    };
+    int exit_status = EXIT_FAILURE;
+    uint32_t i;
+
+    YAAF_Init(NULL);
+
+    g_big_data = (char*) malloc(BIG_FILE_SIZE);
+    if (!g_big_data)
+    {
+        goto exit;
+    }
+    for (i = 0; i < BIG_FILE_SIZE; ++i)
+    {
+        g_big_data[i] = (char)((i * 7) ^ (i >> 9));
+    }
+
+    for (i = 0; i < sizeof(s_flags) / sizeof(s_flags[0]); ++i)
+    {
+        if (test_lookups(s_flags[i]) != YAAF_SUCCESS)
+        {
+            fprintf(stderr, "test_lookups() failed\n");
+            goto exit;
+        }
+    }
+
+    if (test_case_sensitive() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_case_sensitive() failed\n");
+        goto exit;
+    }
+
+    if (test_unsorted() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_unsorted() failed\n");
+        goto exit;
+    }
+
+    if (test_corrupt_index() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_corrupt_index() failed\n");
+        goto exit;
+    }
+
+    for (i = 0; i < sizeof(s_verify_flags) / sizeof(s_verify_flags[0]); ++i)
+    {
+        if (test_verify_on_read(s_verify_flags[i]) != YAAF_SUCCESS)
+        {
+            fprintf(stderr, "test_verify_on_read() failed for flags 0x%x\n", s_verify_flags[i]);
+            goto exit;
+        }
+    }
+
+    if (test_check() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_check() failed\n");
+        goto exit;
+    }
+
+    if (test_async() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_async() failed\n");
+        goto exit;
+    }
+
+    exit_status = EXIT_SUCCESS;
+exit:
+    free(g_big_data);
+    remove(s_output_file);
+    YAAF_Shutdown();
+    return exit_status;
+}
@@ -60,6 +60,198 @@ Test_CompressBlock(YAAF_Compressor* pCompressor,
     }
 }
 
+static int
+Test_RandomSeek(YAAF_File* pYFile,
+                FILE* pFile,
+                const uint32_t fileSize)
+{
+    uint32_t i;
+    for(i = 0; i < 10; ++i)
+    {
+        static char tmp_in[YAAF_BLOCK_SIZE];
+        static char tmp_buffer[YAAF_BLOCK_SIZE];
+        uint32_t random_seek = rand() % fileSize;
+        uint32_t input_size = ((fileSize - random_seek) < YAAF_BLOCK_SIZE) ? (fileSize - random_seek) : YAAF_BLOCK_SIZE;
+        uint32_t bytes_read = 0;
+        int seek_mode = i % 3;
+
+
+        /* seek back to begining on input file */
+        if (fseek(pFile, random_seek, SEEK_SET) != 0)
+        {
+            fprintf(stderr, "Failed to seek back to %u on input\n", random_seek);
+            return YAAF_FAIL;
+        }
+
+        /* seek with the different modes */
+        if ((seek_mode == 0 && YAAF_FileSeek(pYFile, random_seek, SEEK_SET) != YAAF_SUCCESS) ||
+                (seek_mode == 1 && YAAF_FileSeek(pYFile, (int64_t)random_seek - (int64_t)YAAF_FileTell(pYFile), SEEK_CUR) != YAAF_SUCCESS) ||
+                (seek_mode == 2 && YAAF_FileSeek(pYFile, (int64_t)random_seek - (int64_t)fileSize, SEEK_END) != YAAF_SUCCESS))
+        {
+            fprintf(stderr, "Failed to seek back to %u on output (mode %d)\n", random_seek, seek_mode);
+            return YAAF_FAIL;
+        }
+
+        /* test seek & recorded ftell */
+        if (random_seek != YAAF_FileTell(pYFile))
+        {
+            fprintf(stderr," Seek position and internal tell do not match (%u vs %"PRIu64")\n", random_seek,
+                YAAF_FileTell(pYFile));
+            return YAAF_FAIL;
+        }
+
+        /* read into tmp in */
+        if (fread(tmp_in, 1, input_size, pFile) != input_size)
+        {
+            fprintf(stderr, "Failed read input file into buffer\n");
+            return YAAF_FAIL;
+        }
+
+         /* decompress into tmp buffer*/
+        bytes_read = YAAF_FileRead(pYFile, tmp_buffer, input_size);
+        if (bytes_read != input_size)
+        {
+            fprintf(stderr," Failed to read yaaf file: %s\n", YAAF_GetError());
+            return YAAF_FAIL;
+        }
+
+        /* compare memory */
+        if (memcmp(tmp_buffer, tmp_in, input_size) != 0)
+        {
+            fprintf(stderr," Data does not match for offset (random seek(%d) at %u)\n", i, random_seek);
+            return YAAF_FAIL;
+        }
+
+    }
+    return YAAF_SUCCESS;
+}
+
+static int
+Test_NextBlock(YAAF_File* pYFile,
+               FILE* pFile,
+               const uint32_t fileSize)
+{
+    static char tmp_in[YAAF_BLOCK_SIZE];
+    const uint32_t start = fileSize / 3;
+    uint32_t total = start;
+    const void* p_block = NULL;
+    uint32_t block_size = 0;
+
+    /* start in the middle of a block */
+    if (fseek(pFile, start, SEEK_SET) != 0 ||
+            YAAF_FileSeek(pYFile, start, SEEK_SET) != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "Failed to seek to %u\n", start);
+        return YAAF_FAIL;
+    }
+
+    do
+    {
+        if (YAAF_FileNextBlock(pYFile, &p_block, &block_size) != YAAF_SUCCESS)
+        {
+            fprintf(stderr," Failed to get next block: %s\n", YAAF_GetError());
+            return YAAF_FAIL;
+        }
+
+        if (fread(tmp_in, 1, block_size, pFile) != block_size ||
+                memcmp(p_block, tmp_in, block_size) != 0)
+        {
+            fprintf(stderr," Block data does not match for offset %u\n", total);
+            return YAAF_FAIL;
+        }
+        total += block_size;
+    } while (block_size);
+
+    if (total != fileSize || !YAAF_FileEOF(pYFile))
+    {
+        fprintf(stderr," Blocks do not cover the file (%u vs %u)\n", total, fileSize);
+        return YAAF_FAIL;
+    }
+    return YAAF_SUCCESS;
+}
+
+static int
+Test_ReadAll(YAAF_File* pYFile,
+             FILE* pFile,
+             const uint32_t fileSize)
+{
+    int result = YAAF_FAIL;
+    char* p_in = (char*) malloc(fileSize);
+    char* p_out = (char*) malloc(fileSize);
+    const uint32_t chunk = YAAF_BLOCK_SIZE + YAAF_BLOCK_SIZE / 3;
+    YAAF_ThreadPool* p_pool = NULL;
+    uint32_t i;
+
+    if (!p_in || !p_out)
+    {
+        fprintf(stderr, "Failed to allocate read buffers\n");
+        goto cleanup;
+    }
+
+    if (fseek(pFile, 0, SEEK_SET) != 0 || fread(p_in, 1, fileSize, pFile) != fileSize)
+    {
+        fprintf(stderr, "Failed read input file into buffer\n");
+        goto cleanup;
+    }
+
+    if (YAAF_FileReadAll(pYFile, p_out) != YAAF_SUCCESS || !YAAF_FileEOF(pYFile) ||
+            memcmp(p_in, p_out, fileSize) != 0)
+    {
+        fprintf(stderr," Failed to read whole yaaf file: %s\n", YAAF_GetError());
+        goto cleanup;
+    }
+
+    /* reads not aligned to the blocks mix cached and direct decoding */
+    memset(p_out, 0, fileSize);
+    YAAF_FileSeek(pYFile, 0, SEEK_SET);
+    for (i = 0; i < fileSize; i += chunk)
+    {
+        const uint32_t size = (fileSize - i < chunk) ? fileSize - i : chunk;
+        if (YAAF_FileRead(pYFile, p_out + i, size) != size)
+        {
+            fprintf(stderr," Failed to read yaaf file: %s\n", YAAF_GetError());
+            goto cleanup;
+        }
+    }
+
+    if (memcmp(p_in, p_out, fileSize) != 0)
+    {
+        fprintf(stderr," Data does not match for unaligned reads\n");
+        goto cleanup;
+    }
+
+    /* parallel reads from the default pool and from an unaligned position */
+    memset(p_out, 0, fileSize);
+    YAAF_FileSeek(pYFile, 0, SEEK_SET);
+    if (YAAF_FileReadParallel(pYFile, p_out, fileSize, NULL) != fileSize ||
+            !YAAF_FileEOF(pYFile) || memcmp(p_in, p_out, fileSize) != 0)
+    {
+        fprintf(stderr," Failed to read yaaf file in parallel: %s\n", YAAF_GetError());
+        goto cleanup;
+    }
+
+    p_pool = YAAF_ThreadPoolCreate(3);
+    memset(p_out, 0, fileSize);
+    YAAF_FileSeek(pYFile, fileSize / 7, SEEK_SET);
+    i = fileSize - fileSize / 7 - fileSize / 5;
+    if (!p_pool || YAAF_FileReadParallel(pYFile, p_out, i, p_pool) != i ||
+            YAAF_FileTell(pYFile) != (uint64_t)fileSize / 7 + i ||
+            memcmp(p_in + fileSize / 7, p_out, i) != 0)
+    {
+        fprintf(stderr," Failed to read yaaf file in parallel from offset: %s\n", YAAF_GetError());
+        goto cleanup;
+    }
+    result = YAAF_SUCCESS;
+cleanup:
+    if (p_pool)
+    {
+        YAAF_ThreadPoolDestroy(p_pool);
+    }
+    free(p_in);
+    free(p_out);
+    return result;
+}
+
 static const char* s_output_file = "compressed_data.tmp";
 static int
 Test_CompressFile(const char* path)
@@ -73,8 +265,16 @@ Test_CompressFile(const char* path)
     uint32_t compressed_size = 0;
     uint32_t i = 0;
     YAAF_MemFile mem_file;
+    YAAF_MemFile mem_file_pread;
+    int pread_open = 0;
+    YAAF_BlockCache* p_block_cache = NULL;
+    YAAF_FilePool* p_pool = NULL;
+    YAAF_File* p_recycled = NULL;
+    void* p_storage = NULL;
     YAAF_ManifestEntry entry_hdr;
     YAAF_BlockHeader end_block;
+    uint32_t* p_block_table = NULL;
+    uint32_t n_blocks = 0;
 
     memset(&mem_file, 0, sizeof(mem_file));
     memset(&end_block, 0, sizeof(end_block));
@@ -94,6 +294,14 @@ Test_CompressFile(const char* path)
 
     memset(&c, 0, sizeof(c));
 
+    n_blocks = (file_size + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
+    p_block_table = (uint32_t*) malloc(sizeof(uint32_t) * n_blocks);
+    if (!p_block_table)
+    {
+        fprintf(stderr, "Failed to allocate block offset table\n");
+        goto cleanup;
+    }
+
     if (YAAF_CompressorCreate(&c, YAAF_COMPRESSION_LZ4_BIT) != YAAF_SUCCESS)
     {
         fprintf(stderr, "Failed to create compressor\n");
@@ -139,6 +347,7 @@ Test_CompressFile(const char* path)
             goto cleanup;
         }
 
+        p_block_table[i / YAAF_BLOCK_SIZE] = compressed_size;
         bytes_written = Test_CompressBlock(&c, tmp_in, input_size,
                                            tmp_out);
         if (bytes_written == 0xFFFFFFFF)
@@ -161,6 +370,13 @@ Test_CompressFile(const char* path)
         goto cleanup;
     }
 
+    /* write block offset table */
+    if (fwrite(p_block_table, sizeof(uint32_t), n_blocks, p_output) != n_blocks)
+    {
+        fprintf(stderr, "Failed to write block offset table to output file \n");
+        goto cleanup;
+    }
+
     fflush(p_output);
     fclose(p_output);
     p_output = NULL;
@@ -180,7 +396,7 @@ Test_CompressFile(const char* path)
     entry_hdr.sizeUncompressed = file_size;
     entry_hdr.offset = 0;
     entry_hdr.flags = YAAF_COMPRESSION_LZ4_BIT;
-    p_yfile = YAAF_FileCreate(mem_file.ptr, &entry_hdr);
+    p_yfile = YAAF_FileCreate(&mem_file, &entry_hdr);
 
     if (!p_yfile)
     {
@@ -229,63 +445,144 @@ Test_CompressFile(const char* path)
 
     }
 
-    for(i = 0; i < 10; ++i)
+    if (Test_RandomSeek(p_yfile, p_file, file_size) != YAAF_SUCCESS)
     {
-        static char tmp_in[YAAF_BLOCK_SIZE];
-        static char tmp_buffer[YAAF_BLOCK_SIZE];
-        uint32_t random_seek = rand() % file_size;
-        uint32_t input_size = ((file_size - random_seek) < YAAF_BLOCK_SIZE) ? (file_size - random_seek) : YAAF_BLOCK_SIZE;
-        uint32_t bytes_read = 0;
+        goto cleanup;
+    }
+
+    /* repeat with the block offset table */
+    YAAF_FileDestroy(p_yfile);
+    entry_hdr.flags |= YAAF_ENTRY_FLAG_BLOCK_TABLE;
+    p_yfile = YAAF_FileCreate(&mem_file, &entry_hdr);
+    if (!p_yfile)
+    {
+        fprintf(stderr," Failed to create yaaf file: %s\n", YAAF_GetError());
+        goto cleanup;
+    }
+
+    if (Test_RandomSeek(p_yfile, p_file, file_size) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
 
+    if (Test_NextBlock(p_yfile, p_file, file_size) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
 
-        /* seek back to begining on input file */
-        if (fseek(p_file, random_seek, SEEK_SET) != 0)
+    if (Test_ReadAll(p_yfile, p_file, file_size) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
+
+    /* repeat reading through pread, mapped windows and direct reads */
+    for (i = 0; i < 3; ++i)
+    {
+        static const uint32_t s_map_flags[] = {YAAF_MAP_PREAD, YAAF_MAP_WINDOWED, YAAF_MAP_DIRECT};
+        const uint32_t map_flags = s_map_flags[i];
+
+        YAAF_FileDestroy(p_yfile);
+        p_yfile = NULL;
+        if (pread_open)
         {
-            fprintf(stderr, "Failed to seek back to %u on input\n", random_seek);
+            YAAF_MemFileClose(&mem_file_pread);
+            pread_open = 0;
+        }
+
+        if (YAAF_MemFileOpenEx(&mem_file_pread, s_output_file, map_flags, 0) != YAAF_SUCCESS)
+        {
+            fprintf(stderr, "Failed to open temporary output file with flags %u\n", map_flags);
             goto cleanup;
         }
+        pread_open = 1;
 
-        /* seek back to begining on input file */
-        if (YAAF_FileSeek(p_yfile, random_seek, SEEK_SET) != YAAF_SUCCESS)
+        p_yfile = YAAF_FileCreate(&mem_file_pread, &entry_hdr);
+        if (!p_yfile)
         {
-            fprintf(stderr, "Failed to seek back to %u on output\n", random_seek);
+            fprintf(stderr," Failed to create yaaf file: %s\n", YAAF_GetError());
             goto cleanup;
         }
 
-        /* test seek & recorded ftell */
-        if (random_seek != YAAF_FileTell(p_yfile))
+        if (Test_RandomSeek(p_yfile, p_file, file_size) != YAAF_SUCCESS)
         {
-            fprintf(stderr," Seek position and internal tell do not match (%d vs %d)\n", random_seek,
-                YAAF_FileTell(p_yfile));
             goto cleanup;
         }
-        
-        /* read into tmp in */
-        if (fread(tmp_in, 1, input_size, p_file) != input_size)
+
+        if (Test_NextBlock(p_yfile, p_file, file_size) != YAAF_SUCCESS)
         {
-            fprintf(stderr, "Failed read input file into buffer\n");
             goto cleanup;
         }
 
-         /* decompress into tmp buffer*/
-        bytes_read = YAAF_FileRead(p_yfile, tmp_buffer, input_size);
-        if (bytes_read != input_size)
+        if (Test_ReadAll(p_yfile, p_file, file_size) != YAAF_SUCCESS)
         {
-            fprintf(stderr," Failed to read yaaf file: %s\n", YAAF_GetError());
             goto cleanup;
         }
+    }
 
-        /* compare memory */
-        if (memcmp(tmp_buffer, tmp_in, input_size) != 0)
+    /* repeat with a file recycled by a pool and in caller storage */
+    YAAF_FileDestroy(p_yfile);
+    p_yfile = NULL;
+    p_pool = YAAF_FilePoolCreate(1);
+    if (!p_pool)
+    {
+        fprintf(stderr," Failed to create file pool: %s\n", YAAF_GetError());
+        goto cleanup;
+    }
+
+    for (i = 0; i < 2; ++i)
+    {
+        YAAF_File* p_pooled = YAAF_FileCreatePooled(p_pool, &mem_file_pread, &entry_hdr);
+        if (!p_pooled || (p_recycled && p_pooled != p_recycled))
         {
-            fprintf(stderr," Data does not match for offset (random seek(%d) at %u)\n", i, random_seek);
+            fprintf(stderr," Failed to reuse pooled yaaf file: %s\n", YAAF_GetError());
             goto cleanup;
         }
+        p_yfile = p_pooled;
+
+        if (Test_RandomSeek(p_yfile, p_file, file_size) != YAAF_SUCCESS ||
+                Test_ReadAll(p_yfile, p_file, file_size) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+        p_recycled = p_yfile;
+        YAAF_FileDestroy(p_yfile);
+        p_yfile = NULL;
+    }
 
+    p_storage = malloc(sizeof(YAAF_File));
+    p_yfile = (p_storage) ? YAAF_FileCreateInPlace(&mem_file, &entry_hdr, p_storage, sizeof(YAAF_File)) : NULL;
+    if (p_yfile != p_storage || YAAF_FileCreateInPlace(&mem_file, &entry_hdr, p_storage, sizeof(YAAF_File) - 1))
+    {
+        fprintf(stderr," Failed to create yaaf file in place: %s\n", YAAF_GetError());
+        goto cleanup;
     }
 
+    if (Test_RandomSeek(p_yfile, p_file, file_size) != YAAF_SUCCESS ||
+            Test_ReadAll(p_yfile, p_file, file_size) != YAAF_SUCCESS)
+    {
+        goto cleanup;
+    }
 
+    /* repeat twice with a shared block cache, the second pass only hits */
+    YAAF_FileDestroy(p_yfile);
+    p_yfile = YAAF_FileCreate(&mem_file, &entry_hdr);
+    p_block_cache = YAAF_BlockCacheCreate(2 * (uint64_t)file_size);
+    if (!p_yfile || !p_block_cache)
+    {
+        fprintf(stderr," Failed to create yaaf file with block cache: %s\n", YAAF_GetError());
+        goto cleanup;
+    }
+    p_yfile->data.pBlockCache = p_block_cache;
 
+    for (i = 0; i < 2; ++i)
+    {
+        if (Test_RandomSeek(p_yfile, p_file, file_size) != YAAF_SUCCESS ||
+                Test_NextBlock(p_yfile, p_file, file_size) != YAAF_SUCCESS ||
+                Test_ReadAll(p_yfile, p_file, file_size) != YAAF_SUCCESS)
+        {
+            goto cleanup;
+        }
+    }
 
     printf("File Size: %lu kb Compression Size: %d kb\n", file_size/ 1024, compressed_size/1024);
     result = YAAF_SUCCESS;
@@ -306,11 +603,28 @@ cleanup:
         YAAF_FileDestroy(p_yfile);
     }
 
+    if (p_pool)
+    {
+        YAAF_FilePoolDestroy(p_pool);
+    }
+    free(p_storage);
+
+    if (p_block_cache)
+    {
+        YAAF_BlockCacheDestroy(p_block_cache);
+    }
+
     if (mem_file.ptr)
     {
         YAAF_MemFileClose(&mem_file);
     }
+
+    if (pread_open)
+    {
+        YAAF_MemFileClose(&mem_file_pread);
+    }
     YAAF_CompressorDestroy(&c);
+    free(p_block_table);
 
     return result;
 }
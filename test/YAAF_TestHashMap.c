@@ -22,6 +22,9 @@
 
 #include "YAAF.h"
 #include "YAAF_HashMap.h"
+#include "YAAF_Hash.h"
+#include "YAAF_Internal.h"
+#include <time.h>
 
 #define DATA_COUNT 11
 #define DUPLICATE_KEY_IDX 4
@@ -168,11 +171,348 @@ test_iter()
     return res;
 }
 
-int main()
+/* The name hash is stored in archives, it must not change */
+#define NAME_HASH_KEY "Textures/Characters/Hero_Diffuse.DDS"
+#define NAME_HASH_VALUE 3659792994u
+
+static int
+test_name_hash()
+{
+    char lower[64], upper[64];
+    size_t len, i;
+
+    if (YAAF_NameHash(NAME_HASH_KEY, strlen(NAME_HASH_KEY)) != NAME_HASH_VALUE)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* every length through the 16 and 8 byte steps and the tail */
+    for (len = 0; len < sizeof(lower); ++len)
+    {
+        for (i = 0; i < len; ++i)
+        {
+            lower[i] = (char)('a' + (i * 7) % 26);
+            upper[i] = (char)('A' + (i * 7) % 26);
+        }
+        if (len && (len % 5) == 0)
+        {
+            /* characters around the letters must not be folded */
+            lower[len - 1] = '@';
+            upper[len - 1] = '@';
+        }
+
+        if (YAAF_NameHash(lower, len) != YAAF_NameHash(upper, len) ||
+                !YAAF_StrEqualNoCaseN(lower, upper, len))
+        {
+            return YAAF_FAIL;
+        }
+
+        if (len)
+        {
+            /* '[' and '{' only differ by the case bit */
+            upper[len - 1] = '[';
+            lower[len - 1] = '{';
+            if (YAAF_StrEqualNoCaseN(lower, upper, len) ||
+                    YAAF_NameHash(lower, len) == YAAF_NameHash(upper, len))
+            {
+                return YAAF_FAIL;
+            }
+        }
+    }
+    return YAAF_SUCCESS;
+}
+
+#define MANY_COUNT 5000
+
+#define KEY_STRIDE 128
+
+static char*
+make_keys(const uint32_t count,
+          const char* prefix)
+{
+    char* p_keys = (char*) malloc((size_t)count * KEY_STRIDE);
+    uint32_t i;
+    if (p_keys)
+    {
+        for (i = 0; i < count; ++i)
+        {
+            snprintf(p_keys + (size_t)i * KEY_STRIDE, KEY_STRIDE, "%sDir%u/File%u.dat", prefix, i % 97, i);
+        }
+    }
+    return p_keys;
+}
+
+static int
+test_many()
+{
+    YAAF_HashMap hm;
+    int res = YAAF_SUCCESS;
+    uint32_t i;
+    char* p_keys = make_keys(MANY_COUNT, "");
+    if (!p_keys)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* start empty so the map has to grow */
+    YAAF_HashMapInitNoAlloc(&hm);
+    for (i = 0; i < MANY_COUNT && res == YAAF_SUCCESS; ++i)
+    {
+        res = YAAF_HashMapPut(&hm, p_keys + i * KEY_STRIDE, p_keys + i * KEY_STRIDE);
+    }
+
+    /* remove every other key, the others must still be found */
+    for (i = 0; i < MANY_COUNT && res == YAAF_SUCCESS; i += 2)
+    {
+        res = YAAF_HashMapRemove(&hm, p_keys + i * KEY_STRIDE);
+    }
+
+    for (i = 0; i < MANY_COUNT && res == YAAF_SUCCESS; ++i)
+    {
+        const void* ptr = YAAF_HashMapGet(&hm, p_keys + i * KEY_STRIDE);
+        res = ((i & 1) ? ptr == p_keys + i * KEY_STRIDE : ptr == NULL) ? YAAF_SUCCESS : YAAF_FAIL;
+    }
+
+    /* lookups ignore the case */
+    if (res == YAAF_SUCCESS)
+    {
+        res = (YAAF_HashMapGet(&hm, "dir1/file1.DAT") == p_keys + KEY_STRIDE) ? YAAF_SUCCESS : YAAF_FAIL;
+    }
+
+    /* reinsert the removed keys over the deleted slots */
+    for (i = 0; i < MANY_COUNT && res == YAAF_SUCCESS; i += 2)
+    {
+        res = YAAF_HashMapPut(&hm, p_keys + i * KEY_STRIDE, p_keys + i * KEY_STRIDE);
+    }
+
+    if (res == YAAF_SUCCESS && hm.count != MANY_COUNT)
+    {
+        res = YAAF_FAIL;
+    }
+
+    YAAF_HashMapDestroy(&hm);
+    free(p_keys);
+    return res;
+}
+
+static int
+test_case_sensitive()
+{
+    YAAF_HashMap hm;
+    int res = YAAF_SUCCESS;
+    uint32_t i;
+    char* p_keys = make_keys(MANY_COUNT, "");
+    if (!p_keys)
+    {
+        return YAAF_FAIL;
+    }
+
+    /* names without upper case letters hash the same in both modes */
+    if (YAAF_NameHashExact("dir1/file1.dat", 14) != YAAF_NameHash("dir1/file1.dat", 14) ||
+            YAAF_NameHashExact(NAME_HASH_KEY, strlen(NAME_HASH_KEY)) == NAME_HASH_VALUE)
+    {
+        free(p_keys);
+        return YAAF_FAIL;
+    }
+
+    YAAF_HashMapInitNoAlloc(&hm);
+    hm.caseSensitive = 1;
+    for (i = 0; i < MANY_COUNT && res == YAAF_SUCCESS; ++i)
+    {
+        res = YAAF_HashMapPut(&hm, p_keys + i * KEY_STRIDE, p_keys + i * KEY_STRIDE);
+    }
+
+    /* keys only differing in case are distinct, also after growing */
+    if (res == YAAF_SUCCESS)
+    {
+        res = YAAF_HashMapPut(&hm, "dir1/file1.dat", p_keys);
+    }
+    if (res == YAAF_SUCCESS &&
+            (!hm.caseSensitive || hm.count != MANY_COUNT + 1 ||
+             YAAF_HashMapGet(&hm, "Dir1/File1.dat") != p_keys + KEY_STRIDE ||
+             YAAF_HashMapGet(&hm, "dir1/file1.dat") != p_keys ||
+             YAAF_HashMapGet(&hm, "DIR1/FILE1.DAT") != NULL))
+    {
+        res = YAAF_FAIL;
+    }
+
+    if (res == YAAF_SUCCESS && (YAAF_HashMapRemove(&hm, "DIR1/FILE1.DAT") == YAAF_SUCCESS ||
+                                YAAF_HashMapRemove(&hm, "dir1/file1.dat") != YAAF_SUCCESS ||
+                                YAAF_HashMapGet(&hm, "Dir1/File1.dat") != p_keys + KEY_STRIDE))
+    {
+        res = YAAF_FAIL;
+    }
+
+    YAAF_HashMapDestroy(&hm);
+    free(p_keys);
+    return res;
+}
+
+/* Linear probing map with the layout used before the control bytes, only
+ * kept as a reference for the benchmark */
+typedef struct
+{
+    const void* pData;
+    const char* key;
+    uint32_t hash;
+} LinearEntry;
+
+static void
+linear_put(LinearEntry* pEntries,
+           const uint32_t capacity,
+           const char* key,
+           const void* pData)
+{
+    const uint32_t hash = YAAF_OnceAtATimeHashNoCase(key);
+    uint32_t i;
+    for (i = 0; i < capacity; ++i)
+    {
+        LinearEntry* p_entry = &pEntries[(hash + i) % capacity];
+        if (!p_entry->pData)
+        {
+            p_entry->pData = pData;
+            p_entry->key = key;
+            p_entry->hash = hash;
+            return;
+        }
+    }
+}
+
+static const void*
+linear_get(const LinearEntry* pEntries,
+           const uint32_t capacity,
+           const char* key)
+{
+    const uint32_t hash = YAAF_OnceAtATimeHashNoCase(key);
+    uint32_t i;
+    for (i = 0; i < capacity; ++i)
+    {
+        const LinearEntry* p_entry = &pEntries[(hash + i) % capacity];
+        if (!p_entry->pData)
+        {
+            break;
+        }
+        if (p_entry->hash == hash && YAAF_StrCompareNoCase(key, p_entry->key) == 0)
+        {
+            return p_entry->pData;
+        }
+    }
+    return NULL;
+}
+
+#define BENCH_ROUNDS 5
+
+/* Look up the keys in the given order, with the linear map when pLinear is
+ * set. Prints the best time of a few rounds, returns the number of hits */
+static uint32_t
+bench_lookups(const char* name,
+              const YAAF_HashMap* pHashMap,
+              const LinearEntry* pLinear,
+              const uint32_t capacity,
+              const char* pKeys,
+              const uint32_t* pOrder,
+              const uint32_t count)
+{
+    double best = 0.0;
+    uint32_t found = 0;
+    int round;
+
+    for (round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        const clock_t start = clock();
+        double elapsed;
+        uint32_t i;
+
+        found = 0;
+        for (i = 0; i < count; ++i)
+        {
+            const char* key = pKeys + (size_t)pOrder[i] * KEY_STRIDE;
+            found += ((pLinear) ? linear_get(pLinear, capacity, key) : YAAF_HashMapGet(pHashMap, key)) != NULL;
+        }
+        elapsed = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / count;
+        if (round == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    printf("%-32s: %8.1f ns\n", name, best);
+    return found;
+}
+
+/* Look up every key of count entries in random order with both maps, then
+ * as many names which are not in the maps */
+static int
+benchmark(const uint32_t count,
+          const char* prefix)
+{
+    YAAF_HashMap hm;
+    const uint32_t capacity = count * 4 / 3 + 1;
+    LinearEntry* p_linear = (LinearEntry*) calloc(capacity, sizeof(LinearEntry));
+    uint32_t* p_order = (uint32_t*) malloc(sizeof(uint32_t) * count);
+    char* p_keys = make_keys(count, prefix);
+    uint32_t i, found = 0;
+    int res = YAAF_FAIL;
+
+    YAAF_HashMapInit(&hm, count);
+    if (!p_linear || !p_order || !p_keys)
+    {
+        goto cleanup;
+    }
+
+    srand(1234);
+    for (i = 0; i < count; ++i)
+    {
+        linear_put(p_linear, capacity, p_keys + (size_t)i * KEY_STRIDE, p_keys + (size_t)i * KEY_STRIDE);
+        YAAF_HashMapPut(&hm, p_keys + (size_t)i * KEY_STRIDE, p_keys + (size_t)i * KEY_STRIDE);
+        p_order[i] = i;
+    }
+    for (i = count - 1; i > 0; --i)
+    {
+        const uint32_t j = (uint32_t)(((uint64_t)rand() * (RAND_MAX + 1u) + rand()) % (i + 1));
+        const uint32_t tmp = p_order[i];
+        p_order[i] = p_order[j];
+        p_order[j] = tmp;
+    }
+
+    printf("%u entries \"%s\", best of %d rounds per lookup\n",
+           count, p_keys, BENCH_ROUNDS);
+    found += bench_lookups("Linear probing hit", &hm, p_linear, capacity, p_keys, p_order, count);
+    found += bench_lookups("YAAF_HashMap hit", &hm, NULL, capacity, p_keys, p_order, count);
+
+    /* names which are not in the maps */
+    for (i = 0; i < count; ++i)
+    {
+        p_keys[(size_t)i * KEY_STRIDE] = 'X';
+    }
+    found += bench_lookups("Linear probing miss", &hm, p_linear, capacity, p_keys, p_order, count);
+    found += bench_lookups("YAAF_HashMap miss", &hm, NULL, capacity, p_keys, p_order, count);
+
+    res = (found == count * 2) ? YAAF_SUCCESS : YAAF_FAIL;
+cleanup:
+    YAAF_HashMapDestroy(&hm);
+    free(p_linear);
+    free(p_order);
+    free(p_keys);
+    return res;
+}
+
+int main(int argc, char** argv)
 {
     int exit_status = EXIT_FAILURE;
     YAAF_Init(NULL);
 
+    /* YAAF_TestHashMap -bench [count] only runs the benchmark */
+    if (argc > 1 && strcmp(argv[1], "-bench") == 0)
+    {
+        const uint32_t count = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 1000000;
+        if (count && benchmark(count, "") == YAAF_SUCCESS &&
+                benchmark(count, "Assets/Textures/Environment/Forest/Trees/") == YAAF_SUCCESS)
+        {
+            exit_status = EXIT_SUCCESS;
+        }
+        goto exit;
+    }
+
 
     if (test_put_remove() != YAAF_SUCCESS)
     {
@@ -198,6 +538,24 @@ int main()
         goto exit;
     }
 
+    if (test_name_hash() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_name_hash() failed\n");
+        goto exit;
+    }
+
+    if (test_many() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_many() failed\n");
+        goto exit;
+    }
+
+    if (test_case_sensitive() != YAAF_SUCCESS)
+    {
+        fprintf(stderr, "test_case_sensitive() failed\n");
+        goto exit;
+    }
+
     exit_status = YAAF_SUCCESS;
 exit:
     YAAF_Shutdown();
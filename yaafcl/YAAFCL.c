@@ -47,6 +47,16 @@ void YAAFCL_LogError(const char* error,...)
     }
 }
 
+YAAF_Archive*
+YAAFCL_ArchiveOpen(const char* path)
+{
+    YAAF_ArchiveOptions options;
+
+    YAAF_ArchiveOptionsInit(&options);
+    options.validation = YAAF_VALIDATION_FULL;
+    return YAAF_ArchiveOpenEx(path, &options);
+}
+
 
 
 
@@ -154,7 +164,7 @@ cleanup:
 
 
     /* compress and write files */
-    result = YAAFCL_JobCompress(p_output, &dir_stack);
+    result = YAAFCL_JobCompress(p_output, &dir_stack, flags);
     fclose(p_output);
 
     result = YAAF_SUCCESS;
@@ -177,10 +187,11 @@ YAAFCL_ListArchive(const int argc,
     {
         YAAF_Archive* p_archive = NULL;
 
-        p_archive = YAAF_ArchiveOpen(argv[i]);
+        result = YAAF_FAIL;
+        p_archive = YAAFCL_ArchiveOpen(argv[i]);
         if (!p_archive)
         {
-            YAAFCL_LogError("[List Archive] Failed to parse archive \"%s\" - %s\n", argv[0], YAAF_GetError());
+            YAAFCL_LogError("[List Archive] Failed to parse archive \"%s\" - %s\n", argv[i], YAAF_GetError());
             goto exit;
         }
 
@@ -208,26 +219,35 @@ exit:
 }
 
 
+static void
+YAAFCL_CheckCallback(const char* file,
+                     const char* error,
+                     void* pUser)
+{
+    YAAFCL_LogError("[Check Archive] File corrupted \"%s\" in \"%s\": %s\n", file, (const char*)pUser, error);
+}
+
 static int
 YAAFCL_CheckArchive(const int argc,
                     char** argv,
                     const int flags)
 {
-    (void) flags;
     int i = 0;
     int result = YAAF_SUCCESS;
     for ( ; i < argc && result == YAAF_SUCCESS; ++ i)
     {
         YAAF_Archive* p_archive = NULL;
 
-        p_archive = YAAF_ArchiveOpen(argv[i]);
+        p_archive = YAAFCL_ArchiveOpen(argv[i]);
         if (!p_archive)
         {
             YAAFCL_LogError("[Check Archive] Failed to parse archive \"%s\" :%s \n", argv[i], YAAF_GetError());
             goto exit;
         }
 
-        result = YAAF_ArchiveCheck(p_archive);
+        result = YAAF_ArchiveCheckEx(p_archive,
+                                     (flags & YAAFCL_SWITCH_CHECK_BLOCKS) ? YAAF_CHECK_BLOCKS : YAAF_CHECK_FULL,
+                                     NULL, YAAFCL_CheckCallback, argv[i]);
         if (result == YAAF_FAIL)
         {
             YAAFCL_LogError("[Check Archive] Archive corrupted \"%s\": %s\n", argv[i], YAAF_GetError());
@@ -259,7 +279,7 @@ YAAFCL_ListArchiveDir(const int argc,
 
     YAAF_Archive* p_archive = NULL;
 
-    p_archive = YAAF_ArchiveOpen(argv[0]);
+    p_archive = YAAFCL_ArchiveOpen(argv[0]);
     if (!p_archive)
     {
         YAAFCL_LogError("[List ArchiveDir] Failed to parse archive \"%s\" - %s\n", argv[0], YAAF_GetError());
@@ -322,7 +342,7 @@ YAAFCL_ExtractFile(const int argc,
         return YAAF_FAIL;
     }
 
-    p_archive = YAAF_ArchiveOpen(argv[0]);
+    p_archive = YAAFCL_ArchiveOpen(argv[0]);
     if (!p_archive)
     {
         YAAFCL_LogError("[Extract File] Failed to parse archive \"%s\" - %s\n", argv[0], YAAF_GetError());
@@ -366,22 +386,24 @@ YAAFCL_ExtractFile(const int argc,
             }
             YAAFCL_StrDestroy(&out_path);
 
-            char buffer[1024];
-            size_t bytes_read, bytes_written;
-            while (!YAAF_FileEOF(p_file))
+            const void* p_block;
+            uint32_t block_size;
+            do
             {
-                bytes_read = YAAF_FileRead(p_file, buffer, 1024);
-                if (bytes_read)
+                if (YAAF_FileNextBlock(p_file, &p_block, &block_size) != YAAF_SUCCESS)
                 {
-                    bytes_written = fwrite(buffer, 1, bytes_read, p_fout);
-                    if (bytes_written != bytes_read)
-                    {
-                        fprintf(stderr,"[Extract File] Failed to write bytes to output:'%s'\n", YAAF_GetError());
-                        result = YAAF_FAIL;
-                        goto exit;
-                    }
+                    YAAFCL_LogError("[Extract File] Failed to read \"%s\" - %s\n", argv[i], YAAF_GetError());
+                    result = YAAF_FAIL;
+                    goto exit;
                 }
-            }
+
+                if (block_size && fwrite(p_block, 1, block_size, p_fout) != block_size)
+                {
+                    fprintf(stderr,"[Extract File] Failed to write bytes to output:'%s'\n", YAAF_GetError());
+                    result = YAAF_FAIL;
+                    goto exit;
+                }
+            } while (block_size);
             YAAF_FileDestroy(p_file);
             fclose(p_fout);
             p_fout = NULL;
@@ -431,7 +453,7 @@ YAAFCL_FileInfo(const int argc,
         return YAAF_FAIL;
     }
 
-    p_archive = YAAF_ArchiveOpen(argv[0]);
+    p_archive = YAAFCL_ArchiveOpen(argv[0]);
     if (!p_archive)
     {
         YAAFCL_LogError("[File Info] Failed to parse archive \"%s\" - %s\n", argv[0], YAAF_GetError());
@@ -497,7 +519,7 @@ YAAFCL_Contains(const int argc,
         return YAAF_FAIL;
     }
 
-    p_archive = YAAF_ArchiveOpen(argv[0]);
+    p_archive = YAAFCL_ArchiveOpen(argv[0]);
     if (!p_archive)
     {
         YAAFCL_LogError("[Contains] Failed to parse archive \"%s\" - %s\n", argv[0], YAAF_GetError());
@@ -550,6 +572,14 @@ YAAFCL_PrintHelp()
     printf("  -q : Quiet mode, do not log any output\n");
     printf("  -w : Overwrite existing files when creating an archive or extracting\n");
     printf("  -V : Verbose\n");
+    printf("  -x : Create a 64 bit archive, required for archives larger than 4GB.\n");
+    printf("       Enabled automatically when the files exceed the 32 bit limits\n");
+    printf("  -a : Align every file in the archive to 4 KiB, for direct I/O reads\n");
+    printf("  -b : Only check the hashes of the compressed blocks with -C, without\n");
+    printf("       decompressing\n");
+    printf("  -H : Hash blocks and files with XXH64 instead of XXH32, implies -x\n");
+    printf("  -S : Create a case sensitive archive, file names are looked up as\n");
+    printf("       they were added\n");
 
     printf("\n");
 }
@@ -638,6 +668,26 @@ YAAFCL_ParseArgs(const int argc,
         {
             flags |= YAAFCL_SWITCH_ALLOW_FILE_OVERWRITE;
         }
+        else if(strcmp(argv[i], "-x") == 0)
+        {
+            flags |= YAAFCL_SWITCH_64_BIT;
+        }
+        else if(strcmp(argv[i], "-a") == 0)
+        {
+            flags |= YAAFCL_SWITCH_ALIGN;
+        }
+        else if(strcmp(argv[i], "-b") == 0)
+        {
+            flags |= YAAFCL_SWITCH_CHECK_BLOCKS;
+        }
+        else if(strcmp(argv[i], "-H") == 0)
+        {
+            flags |= YAAFCL_SWITCH_HASH_XXH64;
+        }
+        else if(strcmp(argv[i], "-S") == 0)
+        {
+            flags |= YAAFCL_SWITCH_CASE_SENSITIVE;
+        }
         /*
     else if (strcmp(argv[i],"-s") == 0)
     {
@@ -49,8 +49,25 @@ enum YAAFCL_ESwithces
     YAAFCL_SWITCH_VERBOSE_BIT = 1 << 1,
     YAAFCL_SWITCH_QUIET_BIT = 1 << 2,
     YAAFCL_SWITCH_FOLLOW_SYMLINK = 1 << 3,
-    YAAFCL_SWITCH_ALLOW_FILE_OVERWRITE = 1 << 4
+    YAAFCL_SWITCH_ALLOW_FILE_OVERWRITE = 1 << 4,
+    YAAFCL_SWITCH_64_BIT = 1 << 5,
+    YAAFCL_SWITCH_ALIGN = 1 << 6,
+    YAAFCL_SWITCH_CHECK_BLOCKS = 1 << 7,
+    YAAFCL_SWITCH_HASH_XXH64 = 1 << 8,
+    YAAFCL_SWITCH_CASE_SENSITIVE = 1 << 9
 };
 
+/* Alignment of the files in the archive with YAAFCL_SWITCH_ALIGN */
+#define YAAFCL_FILE_ALIGNMENT 4096
+
+#if defined(YAAF_OS_WIN)
+#define YAAFCL_ftell(f) _ftelli64(f)
+#else
+#define YAAFCL_ftell(f) ftello(f)
+#endif
+
 void YAAFCL_LogError(const char* error, ...);
+
+/* Open an archive with full validation, yaafcl reports damaged archives */
+YAAF_Archive* YAAFCL_ArchiveOpen(const char* path);
 #endif
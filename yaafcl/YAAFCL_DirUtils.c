@@ -22,8 +22,6 @@
 #include "YAAFCL.h"
 #include "YAAFCL_DirUtils.h"
 
-#include "YAAF_Hash.h"
-
 #if defined(YAAF_OS_UNIX)
 #include <sys/time.h>
 #include <sys/param.h>
@@ -54,6 +52,7 @@ YAAFCL_DirEntryInit(YAAFCL_DirEntry* pEntry)
     YAAFCL_StrInit(&pEntry->fullPath);
     YAAFCL_StrInit(&pEntry->archivePath);
     memset(&pEntry->manifestInfo, 0 , sizeof(pEntry->manifestInfo));
+    memset(&pEntry->manifestExt, 0 , sizeof(pEntry->manifestExt));
     pEntry->manifestInfo.magic = YAAF_MANIFEST_ENTRY_MAGIC;
 }
 
@@ -234,16 +233,9 @@ YAAFCL_AddFileToEntryStack(YAAFCL_DirEntryStack* pStack,
         return YAAF_SUCCESS;
     }
 
-    if (stat_inf.st_size > YAAF_MAX_FILE_SIZE)
-    {
-        /* File is bigger than max addressable file size*/
-        YAAFCL_LogError("File is larger than maximum addressable size: '%s'\n",
-                        p_dir_entry->fullPath.str);
-        goto exit_fail;
-    }
-
-
-    p_dir_entry->manifestInfo.sizeUncompressed = stat_inf.st_size;
+    /* files larger than 4GB require a 64 bit archive */
+    p_dir_entry->manifestInfo.sizeUncompressed = (uint32_t)stat_inf.st_size;
+    p_dir_entry->manifestExt.sizeUncompressedHigh = (uint32_t)((uint64_t)stat_inf.st_size >> 32);
 #if defined(YAAF_OS_APPLE)
     if (YAAF_TimeToArchiveTime(stat_inf.st_mtimespec.tv_sec,
                                &p_dir_entry->manifestInfo.lastModDateTime) != YAAF_SUCCESS)
@@ -269,7 +261,6 @@ YAAFCL_AddFileToEntryStack(YAAFCL_DirEntryStack* pStack,
 
     p_dir_entry->manifestInfo.extraLen = 0;
     p_dir_entry->manifestInfo.nameLen = (uint16_t)p_dir_entry->archivePath.len + 1;
-    p_dir_entry->manifestInfo.nameHash = YAAF_OnceAtATimeHashNoCase(p_dir_entry->archivePath.str);
 
     YAAFCL_DirEntryStackPush(pStack, p_dir_entry);
     return YAAF_SUCCESS;
@@ -38,6 +38,7 @@ typedef struct
     YAAFCL_Str fullPath;
     YAAFCL_Str archivePath;
     YAAF_ManifestEntry manifestInfo;
+    YAAF_ManifestEntryExt64 manifestExt;
 } YAAFCL_DirEntry;
 
 void YAAFCL_DirEntryInit(YAAFCL_DirEntry* pEntry);
@@ -30,28 +30,51 @@
 
 /* --- Single Thread Implementation -----------------------------------------*/
 
+static uint64_t
+YAAFCL_DirEntrySizeUncompressed(const YAAFCL_DirEntry* pEntry)
+{
+    return ((uint64_t)pEntry->manifestExt.sizeUncompressedHigh << 32) |
+            pEntry->manifestInfo.sizeUncompressed;
+}
+
 static int
 YAAFCL_CompressFile(FILE *pInput,
                     FILE* pOutput,
-                    YAAF_ManifestEntry* pEntry)
+                    YAAFCL_DirEntry* pDirEntry,
+                    const int hashAlgorithm)
 {
     YAAF_Compressor c;
     char tmp_input[YAAF_BLOCK_SIZE];
     char tmp_output[YAAF_BLOCK_CACHE_SIZE_WR];
-    uint32_t file_size = 0, file_size_compressed = 0;
+    YAAF_ManifestEntry* p_entry = &pDirEntry->manifestInfo;
+    const int is_64_bit = (p_entry->flags & YAAF_ENTRY_FLAG_64_BIT) != 0;
+    uint64_t file_size = 0, file_size_compressed = 0;
     int result = YAAF_FAIL;
     YAAF_BlockHeader end_block;
     YAAF_HashState_t hash_state;
+    uint64_t* p_block_table = NULL;
+    size_t n_blocks = 0, max_blocks;
 
     memset(&end_block, 0, sizeof(end_block));
 
-    if(YAAF_CompressorCreate(&c, pEntry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK) == YAAF_FAIL)
+    /* allocate block offset table, the file size may still change while reading */
+    max_blocks = (size_t)((YAAFCL_DirEntrySizeUncompressed(pDirEntry) + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE) + 1;
+    p_block_table = (uint64_t*) YAAF_malloc(sizeof(uint64_t) * max_blocks);
+    if (!p_block_table)
+    {
+        YAAFCL_LogError("[Compress] Failed to allocate block offset table\n");
+        return YAAF_FAIL;
+    }
+
+    if(YAAF_CompressorCreate(&c, p_entry->flags & YAAF_SUPPORTED_COMPRESSIONS_MASK) == YAAF_FAIL)
     {
         YAAFCL_LogError("[Compress] Failed to create compressor\n");
+        YAAF_free(p_block_table);
         return YAAF_FAIL;
     }
+    c.hashAlgorithm = hashAlgorithm;
 
-    YAAF_HashStateReset(&hash_state, 0);
+    YAAF_HashStateReset(&hash_state, hashAlgorithm, 0);
 
 
     while (!feof(pInput))
@@ -73,6 +96,22 @@ YAAFCL_CompressFile(FILE *pInput,
             goto cleanup;
         }
 
+        /* record block offset */
+        if (n_blocks == max_blocks)
+        {
+            uint64_t* p_tmp = (uint64_t*) YAAF_malloc(sizeof(uint64_t) * max_blocks * 2);
+            if (!p_tmp)
+            {
+                YAAFCL_LogError("[Compress] Failed to allocate block offset table\n");
+                goto cleanup;
+            }
+            memcpy(p_tmp, p_block_table, sizeof(uint64_t) * max_blocks);
+            YAAF_free(p_block_table);
+            p_block_table = p_tmp;
+            max_blocks *= 2;
+        }
+        p_block_table[n_blocks++] = file_size_compressed;
+
         /* compress block */
         if (YAAF_CompressBlock(&c, tmp_input, bytes_read, tmp_output,
                                YAAF_BLOCK_CACHE_SIZE_WR, &c_result) != YAAF_COMPRESSION_OK)
@@ -108,6 +147,12 @@ YAAFCL_CompressFile(FILE *pInput,
         file_size_compressed += YAAF_BLOCK_SIZE_GET(c_result.size) + sizeof(YAAF_BlockHeader);
     }
 
+    if (!is_64_bit && (file_size > 0xFFFFFFFF || file_size_compressed > 0xFFFFFFFF))
+    {
+        YAAFCL_LogError("[Compress] File exceeds the 32 bit archive limits\n");
+        goto cleanup;
+    }
+
     /* write end of block */
     if (fwrite(&end_block, 1, sizeof(end_block), pOutput) != sizeof(YAAF_BlockHeader))
     {
@@ -115,19 +160,53 @@ YAAFCL_CompressFile(FILE *pInput,
         goto cleanup;
     }
 
+    /* write block offset table, only useful when there is more than 1 block */
+    if (n_blocks > 1)
+    {
+        size_t i, entry_size;
+        if (is_64_bit)
+        {
+            entry_size = sizeof(uint64_t);
+            for (i = 0; i < n_blocks; ++i)
+            {
+                p_block_table[i] = YAAF_LITTLE_E64(p_block_table[i]);
+            }
+        }
+        else
+        {
+            /* pack the offsets in place, 32 bit entries never overtake the 64 bit ones */
+            uint32_t* p_table32 = (uint32_t*)p_block_table;
+            entry_size = sizeof(uint32_t);
+            for (i = 0; i < n_blocks; ++i)
+            {
+                p_table32[i] = YAAF_LITTLE_E32((uint32_t)p_block_table[i]);
+            }
+        }
+
+        if (fwrite(p_block_table, entry_size, n_blocks, pOutput) != n_blocks)
+        {
+            YAAFCL_LogError("[Compress] Failed to write block offset table\n");
+            goto cleanup;
+        }
+        p_entry->flags |= YAAF_ENTRY_FLAG_BLOCK_TABLE;
+    }
+
     result = YAAF_SUCCESS;
 cleanup:
 
     YAAF_CompressorDestroy(&c);
+    YAAF_free(p_block_table);
 
     if (result == YAAF_SUCCESS)
     {
-        pEntry->fileHash = YAAF_HashStateDigest(&hash_state);
-        pEntry->sizeCompressed = file_size_compressed;
-        if (pEntry->sizeUncompressed != file_size_compressed)
-        {
-            result = YAAF_SUCCESS;
-        }
+        const uint64_t file_hash = YAAF_HashStateDigest(&hash_state);
+        p_entry->fileHash = (uint32_t)file_hash;
+        pDirEntry->manifestExt.fileHashHigh = (uint32_t)(file_hash >> 32);
+        p_entry->sizeCompressed = (uint32_t)file_size_compressed;
+        /* the block offset table relies on the actual size */
+        p_entry->sizeUncompressed = (uint32_t)file_size;
+        pDirEntry->manifestExt.sizeCompressedHigh = (uint32_t)(file_size_compressed >> 32);
+        pDirEntry->manifestExt.sizeUncompressedHigh = (uint32_t)(file_size >> 32);
     }
 
     return result;
@@ -143,8 +222,99 @@ YAAFCL_DirEntryCompareFnc(const void* p1,
     return YAAF_StrCompareNoCase(p_entry1->archivePath.str, p_entry2->archivePath.str);
 }
 
+static int
+YAAFCL_DirEntryCompareExactFnc(const void* p1,
+                               const void* p2)
+{
+    const YAAFCL_DirEntry *p_entry1, *p_entry2;
+    p_entry1 = *(YAAFCL_DirEntry**) p1;
+    p_entry2 = *(YAAFCL_DirEntry**) p2;
+    return strcmp(p_entry1->archivePath.str, p_entry2->archivePath.str);
+}
+
+static int
+YAAFCL_WriteLookupIndex(FILE* pOutput,
+                        YAAFCL_DirEntry** pEntries,
+                        const uint32_t nEntries)
+{
+    YAAF_IndexHeader index_hdr;
+    uint32_t* p_entry_table = NULL;
+    YAAF_IndexSlot* p_slots = NULL;
+    uint32_t n_slots = 1;
+    uint32_t entry_offset = 0;
+    uint32_t i;
+    size_t tables_size;
+    int result = YAAF_FAIL;
+
+    /* keep the load factor at or below 0.5 */
+    while (n_slots / 2 < nEntries)
+    {
+        n_slots <<= 1;
+        if (!n_slots)
+        {
+            YAAFCL_LogError("[CompressArchive] Too many entries for lookup index\n");
+            return YAAF_FAIL;
+        }
+    }
+
+    tables_size = sizeof(uint32_t) * nEntries + sizeof(YAAF_IndexSlot) * n_slots;
+    if (tables_size > 0xFFFFFFFF)
+    {
+        YAAFCL_LogError("[CompressArchive] Lookup index exceeds addressable limits\n");
+        return YAAF_FAIL;
+    }
+
+    p_entry_table = (uint32_t*) YAAF_malloc(tables_size);
+    if (!p_entry_table)
+    {
+        YAAFCL_LogError("[CompressArchive] Failed to allocate lookup index\n");
+        return YAAF_FAIL;
+    }
+    p_slots = (YAAF_IndexSlot*)(p_entry_table + nEntries);
+    memset(p_slots, 0xFF, sizeof(YAAF_IndexSlot) * n_slots);
+
+    for (i = 0; i < nEntries; ++i)
+    {
+        const YAAF_ManifestEntry* p_info = &pEntries[i]->manifestInfo;
+        uint32_t idx = p_info->nameHash & (n_slots - 1);
+
+        /* linear probing, there is always an empty slot */
+        while (p_slots[idx].entry != YAAF_INDEX_SLOT_EMPTY)
+        {
+            idx = (idx + 1) & (n_slots - 1);
+        }
+        p_slots[idx].nameHash = YAAF_LITTLE_E32(p_info->nameHash);
+        p_slots[idx].entry = YAAF_LITTLE_E32(i);
+
+        p_entry_table[i] = YAAF_LITTLE_E32(entry_offset);
+        entry_offset += (uint32_t)YAAF_ManifestEntryHeaderSize(p_info) + p_info->extraLen + p_info->nameLen;
+    }
+
+    if (fwrite(p_entry_table, 1, tables_size, pOutput) != tables_size)
+    {
+        YAAFCL_LogError("[CompressArchive] Failed to write lookup index\n");
+        goto fail;
+    }
+
+    index_hdr.magic = YAAF_LITTLE_E32(YAAF_INDEX_MAGIC);
+    index_hdr.nSlots = YAAF_LITTLE_E32(n_slots);
+    index_hdr.indexSize = YAAF_LITTLE_E32((uint32_t)tables_size);
+    index_hdr.indexHash = YAAF_LITTLE_E32(YAAF_Hash(p_entry_table, (uint32_t)tables_size, 0));
+
+    if (fwrite(&index_hdr, 1, sizeof(index_hdr), pOutput) != sizeof(index_hdr))
+    {
+        YAAFCL_LogError("[CompressArchive] Failed to write lookup index header\n");
+        goto fail;
+    }
+    result = YAAF_SUCCESS;
+fail:
+    YAAF_free(p_entry_table);
+    return result;
+}
+
 int YAAFCL_JobCompress(FILE* pOutput,
-                       YAAFCL_DirEntryStack* pFiles)
+                       YAAFCL_DirEntryStack* pFiles,
+                       const int flags)
 {
     YAAFCL_DirEntry** p_manifest_entries = NULL;
     YAAFCL_DirEntryStackNode* p_cur_node = pFiles->pNodes;
@@ -153,7 +323,13 @@ int YAAFCL_JobCompress(FILE* pOutput,
     uint32_t total_manifest_entries_size = 0;
     YAAF_Manifest manifest;
     int result = YAAF_FAIL;
-    size_t total_size = sizeof(YAAF_Manifest);
+    uint64_t total_size = sizeof(YAAF_Manifest);
+    uint64_t total_manifest_size = 0;
+    /* the upper half of the XXH64 file hash is kept in the 64 bit entries */
+    const int hash_algorithm = (flags & YAAFCL_SWITCH_HASH_XXH64) ? YAAF_HASH_XXH64 : YAAF_HASH_XXH32;
+    int is_64_bit = (flags & (YAAFCL_SWITCH_64_BIT | YAAFCL_SWITCH_HASH_XXH64)) != 0;
+    /* names are stored as given, case sensitive archives hash them as is */
+    const int case_sensitive = (flags & YAAFCL_SWITCH_CASE_SENSITIVE) != 0;
     YAAF_HashState_t hash_state;
 
     YAAF_ASSERT(pOutput);
@@ -162,31 +338,61 @@ int YAAFCL_JobCompress(FILE* pOutput,
 
 
 
-    /* perform size check */
-
+    /* perform size check, blocks are never stored larger than their input */
     while(p_cur_node)
     {
+        const uint64_t file_size = YAAFCL_DirEntrySizeUncompressed(p_cur_node->pEntry);
+        const uint64_t n_blocks = (file_size + YAAF_BLOCK_SIZE - 1) / YAAF_BLOCK_SIZE;
 
-        total_size += sizeof(YAAF_ManifestEntry);
-        total_size += p_cur_node->pEntry->manifestInfo.extraLen;
-        total_size += p_cur_node->pEntry->manifestInfo.nameLen;
-        total_size += p_cur_node->pEntry->manifestInfo.sizeCompressed;
+        total_manifest_size += sizeof(YAAF_ManifestEntry) + sizeof(YAAF_ManifestEntryExt64);
+        total_manifest_size += p_cur_node->pEntry->manifestInfo.extraLen;
+        total_manifest_size += p_cur_node->pEntry->manifestInfo.nameLen;
 
-        if (total_size > YAAF_MAX_ARCHIVE_SIZE)
+        total_size += sizeof(YAAF_FileHeader) + sizeof(YAAF_BlockHeader) + file_size;
+        total_size += n_blocks * (sizeof(YAAF_BlockHeader) + sizeof(uint64_t));
+        if (flags & YAAFCL_SWITCH_ALIGN)
         {
-            YAAFCL_LogError("[CompressArchive] Archive size exceed addressable limits\n");
-            return result;
+            total_size += YAAFCL_FILE_ALIGNMENT;
         }
         p_cur_node = p_cur_node->pNext;
     }
+    total_size += total_manifest_size;
 
+    if (total_manifest_size > 0xFFFFFFFF)
+    {
+        YAAFCL_LogError("[CompressArchive] Manifest size exceed addressable limits\n");
+        return result;
+    }
 
+    if (!is_64_bit && total_size > YAAF_MAX_ARCHIVE_SIZE)
+    {
+        is_64_bit = 1;
+        if (flags & YAAFCL_SWITCH_VERBOSE_BIT)
+        {
+            printf("[CompressArchive] Archive exceeds 32 bit limits, creating a 64 bit archive\n");
+        }
+    }
+
+
+    memset(&manifest, 0, sizeof(manifest));
     file_hdr.magic = YAAF_LITTLE_E32(YAAF_FILE_HEADER_MAGIC);
     manifest.magic = YAAF_LITTLE_E32(YAAF_MANIFEST_MAGIC);
     manifest.versionBuilt = YAAF_LITTLE_E16(YAAF_VERSION);
-    /* TODO: Add different specs */
-    manifest.versionRequired = YAAF_LITTLE_E16(YAAF_VERSION_MK(1,1,0));
     manifest.nEntries = YAAF_LITTLE_E32(pFiles->count);
+    /* older versions can not read the extended entries nor the names hashed
+     * with YAAF_NameHash() */
+    manifest.versionRequired = YAAF_LITTLE_E16(YAAF_NAME_HASH_V2_VERSION);
+    manifest.flags = YAAF_ARCHIVE_FLAG_LOOKUP_INDEX | YAAF_ARCHIVE_FLAG_NAME_HASH_V2;
+    manifest.flags |= (is_64_bit) ? YAAF_ARCHIVE_FLAG_64_BIT : YAAF_ARCHIVE_FLAG_32_BIT;
+    if (hash_algorithm == YAAF_HASH_XXH64)
+    {
+        manifest.flags |= YAAF_ARCHIVE_FLAG_HASH_XXH64;
+    }
+    if (case_sensitive)
+    {
+        manifest.flags |= YAAF_ARCHIVE_FLAG_CASE_SENSITIVE;
+    }
+    manifest.flags = YAAF_LITTLE_E32(manifest.flags);
 
     if (!pFiles->count)
     {
@@ -203,13 +409,42 @@ int YAAFCL_JobCompress(FILE* pOutput,
     p_cur_node = pFiles->pNodes;
     while(p_cur_node)
     {
-        const YAAFCL_DirEntry* p_entry = p_cur_node->pEntry;
+        YAAFCL_DirEntry* p_entry = p_cur_node->pEntry;
+        uint64_t offset = (uint64_t)YAAFCL_ftell(pOutput);
         FILE* p_input = NULL;
 
+        /* pad up to the alignment, readers only follow the entry offsets */
+        if ((flags & YAAFCL_SWITCH_ALIGN) && (offset % YAAFCL_FILE_ALIGNMENT) != 0)
+        {
+            static const char s_padding[YAAFCL_FILE_ALIGNMENT] = {0};
+            const size_t padding = (size_t)(YAAFCL_FILE_ALIGNMENT - (offset % YAAFCL_FILE_ALIGNMENT));
+
+            if (fwrite(s_padding, 1, padding, pOutput) != padding)
+            {
+                YAAFCL_LogError("[CompressArchive] Failed to write alignment padding\n");
+                goto fail;
+            }
+            offset += padding;
+        }
+
+        if (!is_64_bit && offset > 0xFFFFFFFF)
+        {
+            YAAFCL_LogError("[CompressArchive] Archive size exceed addressable limits\n");
+            goto fail;
+        }
+
         /* update manifest ptr */
-        p_manifest_entries[index] = p_cur_node->pEntry;
-        p_manifest_entries[index]->manifestInfo.offset = ftell(pOutput);
-        p_manifest_entries[index]->manifestInfo.flags |= YAAF_DEFAULT_COMPRESSION_BIT;
+        p_manifest_entries[index] = p_entry;
+        p_entry->manifestInfo.offset = (uint32_t)offset;
+        p_entry->manifestExt.offsetHigh = (uint32_t)(offset >> 32);
+        p_entry->manifestInfo.flags |= YAAF_DEFAULT_COMPRESSION_BIT;
+        p_entry->manifestInfo.nameHash = (case_sensitive) ?
+                    YAAF_NameHashExact(p_entry->archivePath.str, p_entry->archivePath.len) :
+                    YAAF_NameHash(p_entry->archivePath.str, p_entry->archivePath.len);
+        if (is_64_bit)
+        {
+            p_entry->manifestInfo.flags |= YAAF_ENTRY_FLAG_64_BIT;
+        }
         /* write file header */
         bytes_written = fwrite(&file_hdr,1, sizeof(file_hdr), pOutput);
         if (bytes_written != sizeof(file_hdr))
@@ -227,7 +462,7 @@ int YAAFCL_JobCompress(FILE* pOutput,
             goto fail;
         }
         /* compress file into archive */
-        if (YAAFCL_CompressFile(p_input, pOutput, &p_manifest_entries[index]->manifestInfo)
+        if (YAAFCL_CompressFile(p_input, pOutput, p_entry, hash_algorithm)
                 != YAAF_SUCCESS)
         {
             YAAFCL_LogError("[CompressArchive] Failed to compress file \"%s\"\n",p_entry->fullPath.str);
@@ -241,9 +476,16 @@ int YAAFCL_JobCompress(FILE* pOutput,
     }
 
     /* sort manifest entries */
-    qsort(p_manifest_entries,pFiles->count, sizeof(YAAFCL_DirEntry*), YAAFCL_DirEntryCompareFnc);
+    qsort(p_manifest_entries,pFiles->count, sizeof(YAAFCL_DirEntry*),
+          (case_sensitive) ? YAAFCL_DirEntryCompareExactFnc : YAAFCL_DirEntryCompareFnc);
 
-    YAAF_HashStateReset(&hash_state, 0);
+    /* write lookup index in front of the manifest entries */
+    if (YAAFCL_WriteLookupIndex(pOutput, p_manifest_entries, (uint32_t)pFiles->count) != YAAF_SUCCESS)
+    {
+        goto fail;
+    }
+
+    YAAF_HashStateReset(&hash_state, YAAF_HASH_XXH32, 0);
     /* for each manifest entry */
     for(index = 0; index < pFiles->count; ++index)
     {
@@ -256,6 +498,14 @@ int YAAFCL_JobCompress(FILE* pOutput,
             goto fail;
         }
 
+        if(is_64_bit &&
+                YAAF_HashStateUpdate(&hash_state, &p_manifest_entries[index]->manifestExt, sizeof(YAAF_ManifestEntryExt64)) != YAAF_SUCCESS)
+        {
+            YAAFCL_LogError("[CompressArchive] Failed calculate hash for entry \"%s\"\n.",
+                            p_manifest_entries[index]->archivePath.str);
+            goto fail;
+        }
+
         if(YAAF_HashStateUpdate(&hash_state, p_manifest_entries[index]->archivePath.str,
                                 p_manifest_entries[index]->archivePath.len + 1) != YAAF_SUCCESS)
         {
@@ -268,9 +518,9 @@ int YAAFCL_JobCompress(FILE* pOutput,
         p_manifest_entries[index]->manifestInfo.fileHash = YAAF_LITTLE_E32(p_manifest_entries[index]->manifestInfo.fileHash);
         p_manifest_entries[index]->manifestInfo.flags = YAAF_LITTLE_E16(p_manifest_entries[index]->manifestInfo.flags);
         p_manifest_entries[index]->manifestInfo.nameLen = YAAF_LITTLE_E16(p_manifest_entries[index]->manifestInfo.nameLen);
-        p_manifest_entries[index]->manifestInfo.sizeCompressed = YAAF_LITTLE_E64(p_manifest_entries[index]->manifestInfo.sizeCompressed);
-        p_manifest_entries[index]->manifestInfo.sizeUncompressed = YAAF_LITTLE_E64(p_manifest_entries[index]->manifestInfo.sizeUncompressed);
-        p_manifest_entries[index]->manifestInfo.offset = YAAF_LITTLE_E64(p_manifest_entries[index]->manifestInfo.offset);
+        p_manifest_entries[index]->manifestInfo.sizeCompressed = YAAF_LITTLE_E32(p_manifest_entries[index]->manifestInfo.sizeCompressed);
+        p_manifest_entries[index]->manifestInfo.sizeUncompressed = YAAF_LITTLE_E32(p_manifest_entries[index]->manifestInfo.sizeUncompressed);
+        p_manifest_entries[index]->manifestInfo.offset = YAAF_LITTLE_E32(p_manifest_entries[index]->manifestInfo.offset);
         p_manifest_entries[index]->manifestInfo.extraLen = YAAF_LITTLE_E16(p_manifest_entries[index]->manifestInfo.extraLen);
 
         /*write manifest entry */
@@ -284,6 +534,26 @@ int YAAFCL_JobCompress(FILE* pOutput,
             goto fail;
         }
 
+        total_manifest_entries_size += sizeof(p_manifest_entries[index]->manifestInfo);
+
+        /*write 64 bit manifest entry extension */
+        if (is_64_bit)
+        {
+            YAAF_ManifestEntryExt64* p_ext = &p_manifest_entries[index]->manifestExt;
+            p_ext->offsetHigh = YAAF_LITTLE_E32(p_ext->offsetHigh);
+            p_ext->sizeCompressedHigh = YAAF_LITTLE_E32(p_ext->sizeCompressedHigh);
+            p_ext->sizeUncompressedHigh = YAAF_LITTLE_E32(p_ext->sizeUncompressedHigh);
+            p_ext->fileHashHigh = YAAF_LITTLE_E32(p_ext->fileHashHigh);
+            bytes_written = fwrite(p_ext, 1, sizeof(YAAF_ManifestEntryExt64), pOutput);
+            if (bytes_written != sizeof(YAAF_ManifestEntryExt64))
+            {
+                YAAFCL_LogError("[CompressArchive] Failed to write manifest entry for entry \"%s\"\n.",
+                                p_manifest_entries[index]->archivePath.str);
+                goto fail;
+            }
+            total_manifest_entries_size += sizeof(YAAF_ManifestEntryExt64);
+        }
+
         /*write manifest entry extra - Nothing at this point*/
 
         /*write manifest entry name */
@@ -296,13 +566,12 @@ int YAAFCL_JobCompress(FILE* pOutput,
             goto fail;
         }
 
-        total_manifest_entries_size += bytes_written +
-                sizeof(p_manifest_entries[index]->manifestInfo);
+        total_manifest_entries_size += bytes_written;
     }
 
     /* write manifest */
     manifest.manifestEntriesSize = YAAF_LITTLE_E32(total_manifest_entries_size);
-    manifest.entriesHash = YAAF_HashStateDigest(&hash_state);
+    manifest.entriesHash = (uint32_t)YAAF_HashStateDigest(&hash_state);
     bytes_written = fwrite(&manifest, 1, sizeof(manifest), pOutput);
     if (bytes_written != sizeof(manifest))
     {
@@ -318,9 +587,9 @@ fail:
 static int YAAFCL_DecompressFile(YAAF_File* pFile,
                                  const char* outPath)
 {
-    char buffer[1024];
+    const void* p_block = NULL;
+    uint32_t block_size = 0;
     int result = YAAF_FAIL;
-    size_t bytes_read, bytes_written;
     FILE* p_fout = NULL;
 
     p_fout = fopen(outPath, "wb");
@@ -330,19 +599,21 @@ static int YAAFCL_DecompressFile(YAAF_File* pFile,
         goto fail;
     }
 
-    while (!YAAF_FileEOF(pFile))
+    /* write the blocks straight from the archive */
+    do
     {
-        bytes_read = YAAF_FileRead(pFile, buffer, 1024);
-        if (bytes_read)
+        if (YAAF_FileNextBlock(pFile, &p_block, &block_size) != YAAF_SUCCESS)
         {
-            bytes_written = fwrite(buffer, 1, bytes_read, p_fout);
-            if (bytes_written != bytes_read)
-            {
-                YAAFCL_LogError("[DecompressFile] Failed to write contents to \"%s\" \n", outPath);
-                goto fail;
-            }
+            YAAFCL_LogError("[DecompressFile] Failed to read contents for \"%s\" - %s\n", outPath, YAAF_GetError());
+            goto fail;
         }
-    }
+
+        if (block_size && fwrite(p_block, 1, block_size, p_fout) != block_size)
+        {
+            YAAFCL_LogError("[DecompressFile] Failed to write contents to \"%s\" \n", outPath);
+            goto fail;
+        }
+    } while (block_size);
 
     result = YAAF_SUCCESS;
 fail:
@@ -370,7 +641,7 @@ YAAFCL_JobDecompressArchive(const char* archive,
     YAAFCL_StrInit(&extract_dir);
 
     /* Open Archive */
-    p_archive = YAAF_ArchiveOpen(archive);
+    p_archive = YAAFCL_ArchiveOpen(archive);
     if (!p_archive)
     {
         YAAFCL_LogError("[DecompressArchive] Failed to parse archive \"%s\" - %s\n", archive, YAAF_GetError());
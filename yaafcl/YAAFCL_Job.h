@@ -24,7 +24,8 @@
 #include "YAAFCL_DirUtils.h"
 
 int YAAFCL_JobCompress(FILE* pOutput,
-                       YAAFCL_DirEntryStack *pFiles);
+                       YAAFCL_DirEntryStack *pFiles,
+                       const int flags);
 
 int YAAFCL_JobDecompressArchive(const char *archive,
                                 const char* outDir,